@@ -9,14 +9,41 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <string.h>
 #include <signal.h>
+#include <sys/wait.h>
+#include "sp-pdb.h"
+#include "sp-hint.h"
+#include "sp-pool.h"
+#include "sp-shared.h"
 
 
-void clientFunction(int *command, int *data);
+void clientFunction(int *command, int *data, struct sharedChannel *channel);
 
-void serverFunction(int *command, int *data);
+void serverFunction(int *command, int *data, struct sharedChannel *channel);
 
-int main() {
+int socketClientFunction(const char *socketPath);
+
+int socketServerFunction(const char *socketPath);
+
+/*
+ * With no arguments the game forks into a client and a server joined by two pipes and a shared mapping for the replies.
+ * "-s <socket>" runs a server for any number of players instead, "-c <socket>" joins one as a player.
+ */
+int main(int argc, char **argv) {
+    if (argc == 3 && (strcmp(argv[1], "-s") == 0 || strcmp(argv[1], "-c") == 0)) {
+        if (argv[1][1] == 's') {
+            mapPatternDatabases();
+            mapPuzzlePools();
+            createHintTable(0);
+            return socketServerFunction(argv[2]);
+        }
+        return socketClientFunction(argv[2]);
+    }
+    if (argc != 1) {
+        fprintf(stderr, "usage: %s [-s <socket> | -c <socket>]\n", argv[0]);
+        return 1;
+    }
     int commandPipe[2];
     int dataPipe[2];
     pid_t client;
@@ -28,15 +55,23 @@ int main() {
         perror("pipe two failed");
         exit(1);
     }
+    struct sharedChannel *channel = createSharedChannel();
+    if (channel == NULL) {
+        perror("shared channel failed");
+        exit(1);
+    }
+    mapPatternDatabases();//before the fork, so both sides share one read-only mapping
+    mapPuzzlePools();
+    createHintTable(0);
     client = fork();
     if (client == -1) {
         perror("fork one failed");
         exit(EXIT_FAILURE);
     }
     if (client == 0) {
-        clientFunction(commandPipe, dataPipe);//pass the pipes in, globals are bad
+        clientFunction(commandPipe, dataPipe, channel);//pass the pipes in, globals are bad
     } else {
-        serverFunction(commandPipe, dataPipe);//pass the pipes in, globals are bad
+        serverFunction(commandPipe, dataPipe, channel);//pass the pipes in, globals are bad
         wait(NULL);
     }
 }
\ No newline at end of file
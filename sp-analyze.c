@@ -0,0 +1,485 @@
+/*
+ * Representing the board analytics tool of "sliding puzzle" game
+ * Uses C99 standard
+ * Usage: sp-analyze [-j threads] [-s node limit] [-b] [-o output] <save or archive>...
+ * Scores every board in the given files: whether it can be won, its Manhattan distance, its linear conflicts and,
+ * with -s, the length of its optimal solution. A file may hold one save as saveGame() writes it, several of them
+ * back to back, or an archive, "-" reads standard input.
+ * Boards stream through three stages joined by a fixed ring of batches: one reader cuts the input into batches of
+ * records, a pool of workers scores them, and one writer puts the results out in input order. The reader only
+ * reads on once the writer hands a batch back, so memory stays the same however many boards the input holds.
+ * Output is CSV, one line per board, or with -b one struct analysisRecord per board in machine byte order.
+ * The files are numbered from 0 in the order given, a summary of each goes to stderr.
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "sp-engine.h"
+
+#define ANALYZE_BATCH_BOARDS 256
+#define ANALYZE_BATCH_BYTES (1 << 20)//a batch takes boards until either is reached, and always at least one board
+#define ANALYZE_MAX_THREADS 256
+
+/*
+ * Result for one board, also the binary output format.
+ * Fields that could not be worked out are -1, all of them but boardSize and moveCount for a damaged record.
+ */
+struct analysisRecord {
+    uint64_t index;//of the board in its file, 0 first
+    uint32_t file;
+    int32_t boardSize;
+    int32_t moveCount;
+    int32_t solvable;//1 or 0, -1 if the record is damaged
+    int32_t manhattan;
+    int32_t conflicts;
+    int32_t optimal;//-1 without -s, on boards too large for the solver and when the node limit ran out
+    int32_t reserved;
+};
+
+/*
+ * Up to ANALYZE_BATCH_BOARDS records as read, each followed by its result once scored.
+ */
+struct analysisBatch {
+    int count;
+    int isScored;
+    size_t used;
+    size_t capacity;//grows to the largest record seen, never shrinks
+    uint8_t *bytes;
+    size_t offsets[ANALYZE_BATCH_BOARDS];
+    size_t lengths[ANALYZE_BATCH_BOARDS];
+    struct analysisRecord results[ANALYZE_BATCH_BOARDS];
+};
+
+/*
+ * Batch n lives in ring[n % ringSize]. The reader fills batch 'read' once the writer is done with what was there,
+ * workers take them in order through 'claimed', the writer waits for batch 'written' to be scored.
+ */
+struct analysisPipeline {
+    pthread_mutex_t lock;//guards the counters and every batch's isScored
+    pthread_cond_t readable;//a batch was read, or the reader finished
+    pthread_cond_t scored;
+    pthread_cond_t reusable;//the writer handed a batch back
+    struct analysisBatch *ring;
+    uint64_t ringSize;
+    uint64_t read;
+    uint64_t claimed;
+    uint64_t written;
+    int isFinished;//the reader has read everything
+    int solve;
+    uint64_t nodeLimit;
+};
+
+/*
+ * What a worker needs on top of the batch, sized for the largest board once so no board allocates but the game.
+ */
+struct analysisWorker {
+    struct analysisPipeline *pipeline;
+    pthread_t thread;
+    struct game game;
+    uint8_t *visited;//one byte per cell
+    int32_t tails[MAX_BOARD_SIZE];
+};
+
+/*
+ * Tells a file's records apart as it is read, for the summary.
+ */
+struct analysisFile {
+    const char *name;
+    uint64_t boards;
+    int isTruncated;
+};
+
+/*
+ * Whether the board can be won, see isSolvable(), in time linear in the cells so the largest boards take no longer
+ * than reading them.
+ * The inversion parity of all cells is the parity of the permutation, the cell count less its cycles, and the
+ * empty tile, the lowest value, adds one inversion with each tile before it.
+ */
+int isBoardSolvable(const struct game *game, uint8_t *visited) {
+    if (game->boardSize % 2 == 0) {
+        return 1;
+    }
+    long long cellCount = game->maxTileValue + 1;
+    long long cycles = 0;
+    memset(visited, 0, cellCount);
+    for (long long cell = 0; cell < cellCount; cell++) {
+        if (visited[cell] == 0) {
+            cycles++;
+        }
+        for (uint32_t next = cell; visited[next] == 0; next = tileAt(game, next)) {
+            visited[next] = 1;
+        }
+    }
+    long long maxTileValue = game->maxTileValue;
+    long long goalInversions = (maxTileValue * (maxTileValue - 1)) / 2;//descending order inverts every pair
+    return ((cellCount - cycles) + game->emptyIndex) % 2 == goalInversions % 2;
+}
+
+/*
+ * Extra moves one line needs on top of the Manhattan distance, counted the way the solver does, see
+ * lineConflictsFor() in sp-solver.c, but towards a single goal: the empty tile in the last cell, the same for every
+ * board so the column compares across boards. The longest run of goal positions already in order uses patience
+ * sorting, lines of the largest boards hold a thousand tiles.
+ * @param first: board index of the line's first cell.
+ * @param step: 1 for a row, boardSize for a column.
+ * @param line: the row or column the line is.
+ */
+int lineConflictCount(struct analysisWorker *worker, int first, int step, int line) {
+    const struct game *game = &worker->game;
+    int size = game->boardSize;
+    int inLine = 0;
+    int longest = 0;
+    for (int i = 0; i < size; i++) {
+        uint32_t tile = tileAt(game, first + (i * step));
+        if (tile == EMPTY_TILE) {
+            continue;
+        }
+        int goal = game->maxTileValue - (int) tile;
+        int goalLine = (step == 1) ? goal / size : goal % size;
+        if (goalLine != line) {
+            continue;
+        }
+        int32_t order = (step == 1) ? goal % size : goal / size;
+        int low = 0;
+        int high = longest;
+        while (low < high) {
+            int middle = (low + high) / 2;
+            if (worker->tails[middle] < order) {
+                low = middle + 1;
+            } else {
+                high = middle;
+            }
+        }
+        worker->tails[low] = order;
+        longest += (low == longest);
+        inLine++;
+    }
+    return 2 * (inLine - longest);
+}
+
+/*
+ * Scores one record.
+ * @param record: exactly one record, as the reader found it.
+ */
+void scoreBoard(struct analysisWorker *worker, const uint8_t *record, size_t length, struct analysisRecord *result) {
+    struct saveHeader header;
+    struct game *game = &worker->game;
+    memcpy(&header, record, sizeof(header));
+    result->boardSize = header.boardSize;
+    result->moveCount = header.moveCount;
+    result->solvable = -1;
+    result->manhattan = -1;
+    result->conflicts = -1;
+    result->optimal = -1;
+    result->reserved = 0;
+    if (unpackGame(game, record, length) == 0) {
+        return;
+    }
+    int size = game->boardSize;
+    result->solvable = isBoardSolvable(game, worker->visited);
+    result->manhattan = game->manhattanDistance;
+    result->conflicts = 0;
+    for (int line = 0; line < size; line++) {
+        result->conflicts += lineConflictCount(worker, line * size, 1, line);
+        result->conflicts += lineConflictCount(worker, line, size, line);
+    }
+    if (worker->pipeline->solve && result->solvable == 1 && game->board != NULL) {
+        struct solverResult solution;
+        if (solveBoard(game->board, size, worker->pipeline->nodeLimit, &solution)) {
+            result->optimal = solution.length;
+        }
+    }
+}
+
+void *scoreBatches(void *argument) {
+    struct analysisWorker *worker = argument;
+    struct analysisPipeline *pipeline = worker->pipeline;
+    pthread_mutex_lock(&pipeline->lock);
+    while (1) {
+        while (pipeline->claimed == pipeline->read && pipeline->isFinished == 0) {
+            pthread_cond_wait(&pipeline->readable, &pipeline->lock);
+        }
+        if (pipeline->claimed == pipeline->read) {
+            break;
+        }
+        uint64_t sequence = pipeline->claimed++;
+        struct analysisBatch *batch = &pipeline->ring[sequence % pipeline->ringSize];
+        pthread_mutex_unlock(&pipeline->lock);
+        for (int i = 0; i < batch->count; i++) {
+            scoreBoard(worker, batch->bytes + batch->offsets[i], batch->lengths[i], &batch->results[i]);
+        }
+        pthread_mutex_lock(&pipeline->lock);
+        batch->isScored = 1;
+        pthread_cond_signal(&pipeline->scored);
+    }
+    pthread_mutex_unlock(&pipeline->lock);
+    return NULL;
+}
+
+/*
+ * Passes a full batch on to the workers and waits for the next one in the ring to be free.
+ * @return: the batch to fill next.
+ */
+struct analysisBatch *passBatch(struct analysisPipeline *pipeline, struct analysisBatch *batch) {
+    pthread_mutex_lock(&pipeline->lock);
+    if (batch->count > 0) {
+        pipeline->read++;
+        pthread_cond_signal(&pipeline->readable);
+    }
+    while (pipeline->read - pipeline->written == pipeline->ringSize) {
+        pthread_cond_wait(&pipeline->reusable, &pipeline->lock);
+    }
+    batch = &pipeline->ring[pipeline->read % pipeline->ringSize];
+    batch->count = 0;
+    batch->isScored = 0;
+    batch->used = 0;
+    pthread_mutex_unlock(&pipeline->lock);
+    return batch;
+}
+
+/*
+ * Reads the records of one file into batches, the header of an archive is skipped and its count trusted, the
+ * index at its end never read. Records follow each other in either case, a header that does not give the length of
+ * its record ends the file, since the next record cannot be found.
+ * @param number: the file's position on the command line.
+ * @return: the batch being filled, with room for another record.
+ */
+struct analysisBatch *readFile(struct analysisPipeline *pipeline, struct analysisBatch *batch, FILE *input,
+                               struct analysisFile *file, uint32_t number) {
+    struct archiveHeader archive;
+    struct saveHeader header;
+    uint64_t remaining = 0;
+    char magic[sizeof(archive.magic)];
+    if (fread(magic, 1, sizeof(magic), input) != sizeof(magic)) {
+        file->isTruncated = 1;
+        return batch;
+    }
+    int isArchive = memcmp(magic, ARCHIVE_MAGIC, sizeof(magic)) == 0;
+    if (isArchive) {
+        memcpy(&archive, magic, sizeof(magic));
+        if (fread((uint8_t *) &archive + sizeof(magic), sizeof(archive) - sizeof(magic), 1, input) != 1
+            || archive.version != ARCHIVE_VERSION) {
+            file->isTruncated = 1;
+            return batch;
+        }
+        remaining = archive.count;
+    }
+    for (int isFirst = 1; isArchive == 0 || remaining > 0; isFirst = 0, remaining--) {
+        if (isFirst && isArchive == 0) {
+            memcpy(&header, magic, sizeof(magic));//a save, its magic is already in
+            if (fread((uint8_t *) &header + sizeof(magic), sizeof(header) - sizeof(magic), 1, input) != 1) {
+                file->isTruncated = 1;
+                break;
+            }
+        } else if (fread(&header, sizeof(header), 1, input) != 1) {
+            file->isTruncated = isArchive || ferror(input);//a run of saves simply ends
+            break;
+        }
+        uint64_t length = recordLength(header.boardSize);
+        if (length == 0 || memcmp(header.magic, SAVE_MAGIC, sizeof(header.magic)) != 0) {
+            file->isTruncated = 1;
+            break;
+        }
+        if (batch->count == ANALYZE_BATCH_BOARDS || (batch->count > 0 && batch->used + length > batch->capacity)) {
+            batch = passBatch(pipeline, batch);
+        }
+        if (length > batch->capacity) {
+            uint8_t *bytes = realloc(batch->bytes, length);
+            if (bytes == NULL) {
+                file->isTruncated = 1;
+                break;
+            }
+            batch->bytes = bytes;
+            batch->capacity = length;
+        }
+        uint8_t *record = batch->bytes + batch->used;
+        memcpy(record, &header, sizeof(header));
+        if (fread(record + sizeof(header), length - sizeof(header), 1, input) != 1) {
+            file->isTruncated = 1;
+            break;
+        }
+        batch->offsets[batch->count] = batch->used;
+        batch->lengths[batch->count] = length;
+        batch->results[batch->count].index = file->boards++;
+        batch->results[batch->count].file = number;
+        batch->count++;
+        batch->used += length;
+    }
+    return batch;
+}
+
+struct readerArguments {
+    struct analysisPipeline *pipeline;
+    struct analysisFile *files;
+    int fileCount;
+};
+
+void *readFiles(void *argument) {
+    struct readerArguments *arguments = argument;
+    struct analysisPipeline *pipeline = arguments->pipeline;
+    struct analysisBatch *batch = passBatch(pipeline, &pipeline->ring[0]);
+    for (int number = 0; number < arguments->fileCount; number++) {
+        struct analysisFile *file = &arguments->files[number];
+        int isStandardInput = strcmp(file->name, "-") == 0;
+        FILE *input = isStandardInput ? stdin : fopen(file->name, "rb");
+        if (input == NULL) {
+            file->isTruncated = 1;
+            continue;
+        }
+        setvbuf(input, NULL, _IOFBF, SAVE_CHUNK_BYTES);
+        batch = readFile(pipeline, batch, input, file, number);
+        if (isStandardInput == 0) {
+            fclose(input);
+        }
+    }
+    pthread_mutex_lock(&pipeline->lock);
+    if (batch->count > 0) {
+        pipeline->read++;
+    }
+    pipeline->isFinished = 1;
+    pthread_cond_broadcast(&pipeline->readable);
+    pthread_cond_signal(&pipeline->scored);
+    pthread_mutex_unlock(&pipeline->lock);
+    return NULL;
+}
+
+void writeResults(const struct analysisBatch *batch, FILE *output, int isBinary) {
+    if (isBinary) {
+        fwrite(batch->results, sizeof(struct analysisRecord), batch->count, output);
+        return;
+    }
+    for (int i = 0; i < batch->count; i++) {
+        const struct analysisRecord *result = &batch->results[i];
+        fprintf(output, "%u,%llu,%d,%d,%d,%d,%d,%d\n", result->file, (unsigned long long) result->index,
+                result->boardSize, result->moveCount, result->solvable, result->manhattan, result->conflicts,
+                result->optimal);
+    }
+}
+
+/*
+ * The writer stage, run on the main thread: takes the batches in the order they were read as soon as each is
+ * scored, writes them out and hands them back to the reader.
+ * @return: number of boards written.
+ */
+uint64_t writeBatches(struct analysisPipeline *pipeline, FILE *output, int isBinary) {
+    uint64_t boards = 0;
+    pthread_mutex_lock(&pipeline->lock);
+    while (1) {
+        struct analysisBatch *batch = &pipeline->ring[pipeline->written % pipeline->ringSize];
+        while ((pipeline->written == pipeline->read || batch->isScored == 0)
+               && (pipeline->written < pipeline->read || pipeline->isFinished == 0)) {
+            pthread_cond_wait(&pipeline->scored, &pipeline->lock);
+        }
+        if (pipeline->written == pipeline->read) {
+            break;
+        }
+        pthread_mutex_unlock(&pipeline->lock);
+        writeResults(batch, output, isBinary);
+        boards += batch->count;
+        pthread_mutex_lock(&pipeline->lock);
+        pipeline->written++;
+        pthread_cond_signal(&pipeline->reusable);
+    }
+    pthread_mutex_unlock(&pipeline->lock);
+    return boards;
+}
+
+int main(int argc, char **argv) {
+    struct analysisPipeline pipeline;
+    struct readerArguments reader;
+    const char *outputName = NULL;
+    int threadCount = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    int isBinary = 0;
+    int option;
+    memset(&pipeline, 0, sizeof(pipeline));
+    while ((option = getopt(argc, argv, "j:s:bo:")) != -1) {
+        if (option == 'j') {
+            threadCount = atoi(optarg);
+        } else if (option == 's') {
+            pipeline.solve = 1;
+            pipeline.nodeLimit = strtoull(optarg, NULL, 10);
+        } else if (option == 'b') {
+            isBinary = 1;
+        } else if (option == 'o') {
+            outputName = optarg;
+        } else {
+            threadCount = 0;
+        }
+    }
+    if (threadCount < 1 || threadCount > ANALYZE_MAX_THREADS || optind == argc
+        || (pipeline.solve && pipeline.nodeLimit == 0)) {
+        fprintf(stderr, "usage: %s [-j threads, 1..%d] [-s solver node limit] [-b] [-o output] "
+                        "<save or archive, - for stdin>...\n", argv[0], ANALYZE_MAX_THREADS);
+        return 1;
+    }
+    FILE *output = (outputName == NULL) ? stdout : fopen(outputName, isBinary ? "wb" : "w");
+    if (output == NULL) {
+        perror("cannot create output file");
+        return 1;
+    }
+    setvbuf(output, NULL, _IOFBF, SAVE_CHUNK_BYTES);
+    if (pipeline.solve) {
+        mapPatternDatabases();
+        setSolverThreads(1);//the boards already keep every core busy
+    }
+    pipeline.ringSize = (2 * (uint64_t) threadCount) + 2;//every worker busy with one and one waiting, plus the ends
+    pipeline.ring = calloc(pipeline.ringSize, sizeof(struct analysisBatch));
+    struct analysisWorker *workers = calloc(threadCount, sizeof(struct analysisWorker));
+    if (pipeline.ring == NULL || workers == NULL) {
+        fprintf(stderr, "not enough memory for %d workers\n", threadCount);
+        return 1;
+    }
+    for (uint64_t i = 0; i < pipeline.ringSize; i++) {
+        pipeline.ring[i].bytes = malloc(ANALYZE_BATCH_BYTES);
+        pipeline.ring[i].capacity = (pipeline.ring[i].bytes == NULL) ? 0 : ANALYZE_BATCH_BYTES;
+    }
+    pthread_mutex_init(&pipeline.lock, NULL);
+    pthread_cond_init(&pipeline.readable, NULL);
+    pthread_cond_init(&pipeline.scored, NULL);
+    pthread_cond_init(&pipeline.reusable, NULL);
+    reader.pipeline = &pipeline;
+    reader.fileCount = argc - optind;
+    reader.files = calloc(reader.fileCount, sizeof(struct analysisFile));
+    for (int i = 0; i < reader.fileCount; i++) {
+        reader.files[i].name = argv[optind + i];
+    }
+    if (isBinary == 0) {
+        fprintf(output, "file,index,size,moves,solvable,manhattan,conflicts,optimal\n");
+    }
+    pthread_t readerThread;
+    pthread_create(&readerThread, NULL, readFiles, &reader);
+    for (int i = 0; i < threadCount; i++) {
+        workers[i].pipeline = &pipeline;
+        workers[i].visited = malloc((size_t) MAX_BOARD_SIZE * MAX_BOARD_SIZE);
+        if (workers[i].visited == NULL) {
+            fprintf(stderr, "not enough memory for %d workers\n", threadCount);
+            exit(1);
+        }
+        pthread_create(&workers[i].thread, NULL, scoreBatches, &workers[i]);
+    }
+    uint64_t boards = writeBatches(&pipeline, output, isBinary);
+    pthread_join(readerThread, NULL);
+    for (int i = 0; i < threadCount; i++) {
+        pthread_join(workers[i].thread, NULL);
+        tearDown(&workers[i].game);
+        free(workers[i].visited);
+    }
+    int wasSuccessful = (fclose(output) == 0);
+    for (int i = 0; i < reader.fileCount; i++) {
+        fprintf(stderr, "file %d (%s): %llu boards%s\n", i, reader.files[i].name,
+                (unsigned long long) reader.files[i].boards, reader.files[i].isTruncated ? ", cut short" : "");
+        wasSuccessful = wasSuccessful && reader.files[i].isTruncated == 0;
+    }
+    fprintf(stderr, "%llu boards scored on %d threads\n", (unsigned long long) boards, threadCount);
+    for (uint64_t i = 0; i < pipeline.ringSize; i++) {
+        free(pipeline.ring[i].bytes);
+    }
+    free(pipeline.ring);
+    free(workers);
+    free(reader.files);
+    return wasSuccessful ? 0 : 1;
+}
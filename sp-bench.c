@@ -0,0 +1,332 @@
+/*
+ * Representing the benchmarks of "sliding puzzle" game
+ * Uses C99 standard
+ * Usage: sp-bench [seed], results go to stdout as one JSON document so runs of different releases can be compared.
+ * Every game is seeded from the given seed, so the same seed replays the same boards and the same moves.
+ * Each benchmark runs a fixed number of iterations several times over and reports the fastest and the median run,
+ * the fastest being the one least disturbed by whatever else the machine was doing.
+ * Every board size up to MAX_PACKED_BOARD_SIZE is measured, and MAX_BOARD_SIZE as well, where everything but
+ * dealing, saving and loading should cost what it does on the small boards.
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "sp-engine.h"
+#include "sp-session.h"
+#include "sp-shared.h"
+
+#define BENCH_REPETITIONS 5
+#define BENCH_MOVE_STEPS 4096//length of the precomputed direction sequence, a power of two
+#define BENCH_PIPELINE_DEPTH 64//moves on the way at once in the pipelined round trip
+#define BENCH_SAVE_FILE "sp-bench.sav"
+#define DEFAULT_BENCH_SEED 20210101ULL
+
+void serverFunction(int *command, int *data, struct sharedChannel *channel);
+
+volatile uint64_t benchSink;//results are added here so the compiler cannot drop the work being timed
+int benchCount = 0;
+
+double nowSeconds(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + (now.tv_nsec / 1e9);
+}
+
+int compareDoubles(const void *first, const void *second) {
+    double a = *(const double *) first;
+    double b = *(const double *) second;
+    return (a > b) - (a < b);
+}
+
+/*
+ * Prints one result as a JSON object, runs are sorted in place.
+ * @param runs: seconds taken by each of the BENCH_REPETITIONS runs.
+ * @param iterations: operations in one run.
+ */
+void reportBenchmark(const char *name, int boardSize, long iterations, double *runs) {
+    qsort(runs, BENCH_REPETITIONS, sizeof(double), compareDoubles);
+    double best = runs[0] * 1e9 / iterations;
+    double median = runs[BENCH_REPETITIONS / 2] * 1e9 / iterations;
+    printf("%s    {\"name\": \"%s\", \"boardSize\": %d, \"iterations\": %ld, \"repetitions\": %d, "
+           "\"nsPerOpMin\": %.2f, \"nsPerOpMedian\": %.2f, \"opsPerSecond\": %.0f}",
+           benchCount++ == 0 ? "" : ",\n", name, boardSize, iterations, BENCH_REPETITIONS, best, median, 1e9 / best);
+    fflush(stdout);
+}
+
+/*
+ * A new game of the given size whose boards all follow from the seed.
+ */
+void seededGame(struct game *game, int size, uint64_t seed) {
+    memset(game, 0, sizeof(*game));
+    game->randomState = seed * 0x9e3779b97f4a7c15ULL + size;
+    game->randomState = (game->randomState == 0) ? 1 : game->randomState;
+    initialize(game, size);
+}
+
+/*
+ * A random walk of directions, the same for every run with the same seed.
+ */
+void fillDirections(int32_t *directions, uint64_t seed) {
+    const int32_t choices[4] = {moveUp, moveDown, moveLeft, moveRight};
+    uint64_t state = seed | 1;
+    for (int i = 0; i < BENCH_MOVE_STEPS; i++) {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        directions[i] = choices[(state * 0x2545f4914f6cdd1dULL) >> 62];
+    }
+}
+
+/*
+ * moveTile() along a random walk, directions that would leave the board cost a failed move just as in play.
+ */
+void benchMoveTile(int size, uint64_t seed) {
+    struct game game;
+    int32_t directions[BENCH_MOVE_STEPS];
+    double runs[BENCH_REPETITIONS];
+    long iterations = 1L << 21;
+    fillDirections(directions, seed + size);
+    for (int run = 0; run < BENCH_REPETITIONS; run++) {
+        seededGame(&game, size, seed);
+        uint64_t moved = 0;
+        double start = nowSeconds();
+        for (long i = 0; i < iterations; i++) {
+            moved += moveTile(&game, resolveMove(&game, directions[i & (BENCH_MOVE_STEPS - 1)]));
+        }
+        runs[run] = nowSeconds() - start;
+        benchSink += moved;
+        tearDown(&game);
+    }
+    reportBenchmark("moveTile", size, iterations, runs);
+}
+
+/*
+ * isMoveValid() for every tile of the board in turn.
+ */
+void benchIsMoveValid(int size, uint64_t seed) {
+    struct game game;
+    double runs[BENCH_REPETITIONS];
+    long iterations = 1L << 22;
+    seededGame(&game, size, seed);
+    for (int run = 0; run < BENCH_REPETITIONS; run++) {
+        uint64_t valid = 0;
+        int tile = 1;
+        double start = nowSeconds();
+        for (long i = 0; i < iterations; i++) {
+            valid += isMoveValid(&game, tile);
+            tile = (tile == game.maxTileValue) ? 1 : tile + 1;
+        }
+        runs[run] = nowSeconds() - start;
+        benchSink += valid;
+    }
+    tearDown(&game);
+    reportBenchmark("isMoveValid", size, iterations, runs);
+}
+
+/*
+ * isWon() on a dealt board and on a won one.
+ */
+void benchIsWon(int size, uint64_t seed) {
+    struct game game;
+    double runs[BENCH_REPETITIONS];
+    long iterations = 1L << 22;
+    for (int won = 0; won <= 1; won++) {
+        seededGame(&game, size, seed);
+        if (won == 1) {
+            int cellCount = size * size;
+            game.isLoadingGame = 1;
+            initialize(&game, size);
+            for (int index = 0; index < cellCount; index++) {
+                setOneTile(&game, index, cellCount - 1 - index);
+            }
+            measureBoard(&game);
+        }
+        for (int run = 0; run < BENCH_REPETITIONS; run++) {
+            uint64_t wins = 0;
+            double start = nowSeconds();
+            for (long i = 0; i < iterations; i++) {
+                wins += isWon(&game);
+                __asm__ volatile("" : : "r"(&game) : "memory");//isWon() must read the game every time
+            }
+            runs[run] = nowSeconds() - start;
+            benchSink += wins;
+        }
+        tearDown(&game);
+        reportBenchmark(won ? "isWon.solved" : "isWon.dealt", size, iterations, runs);
+    }
+}
+
+/*
+ * Dealing a new board, setAllTiles() including its solvability fix-up.
+ */
+void benchSetAllTiles(int size, uint64_t seed) {
+    struct game game;
+    double runs[BENCH_REPETITIONS];
+    long iterations = (size <= MAX_PACKED_BOARD_SIZE) ? 1L << 17 : 1L << 2;
+    for (int run = 0; run < BENCH_REPETITIONS; run++) {
+        seededGame(&game, size, seed);
+        double start = nowSeconds();
+        for (long i = 0; i < iterations; i++) {
+            setAllTiles(&game);
+        }
+        runs[run] = nowSeconds() - start;
+        benchSink += tileAt(&game, 0);
+        tearDown(&game);
+    }
+    reportBenchmark("setAllTiles", size, iterations, runs);
+}
+
+/*
+ * saveGame() and loadGame() of one file, mostly the cost of the system calls behind them.
+ */
+void benchSaveLoad(int size, uint64_t seed) {
+    struct game game;
+    double saveRuns[BENCH_REPETITIONS];
+    double loadRuns[BENCH_REPETITIONS];
+    long iterations = (size <= MAX_PACKED_BOARD_SIZE) ? 1L << 12 : 1L << 2;
+    char fileName[] = BENCH_SAVE_FILE;
+    seededGame(&game, size, seed);
+    for (int run = 0; run < BENCH_REPETITIONS; run++) {
+        uint64_t done = 0;
+        double start = nowSeconds();
+        for (long i = 0; i < iterations; i++) {
+            done += saveGame(&game, fileName);
+        }
+        saveRuns[run] = nowSeconds() - start;
+        start = nowSeconds();
+        for (long i = 0; i < iterations; i++) {
+            done += loadGame(&game, fileName);
+        }
+        loadRuns[run] = nowSeconds() - start;
+        benchSink += done;
+    }
+    tearDown(&game);
+    unlink(fileName);
+    reportBenchmark("saveGame", size, iterations, saveRuns);
+    reportBenchmark("loadGame", size, iterations, loadRuns);
+}
+
+/*
+ * The whole way a player's request goes: client writes, the forked server reads, answers and the client reads it all.
+ * Moves take the tile next to the empty one and put it back with the next move, so every move is a valid one.
+ * The pipelined moves send BENCH_PIPELINE_DEPTH of them before reading any reply, the rest go one at a time.
+ * With a shared channel replies come back through it and print only reads the published board.
+ */
+void benchRoundTrip(uint64_t seed, struct sharedChannel *channel) {
+    int commandPipe[2];
+    int dataPipe[2];
+    uint8_t reply[MAX_REPLY_LENGTH + (DEFAULT_BOARD_SIZE * DEFAULT_BOARD_SIZE * sizeof(uint32_t))];
+    double printRuns[BENCH_REPETITIONS];
+    double moveRuns[BENCH_REPETITIONS];
+    double pipelinedRuns[BENCH_REPETITIONS];
+    uint8_t pipelinedReplies[BENCH_PIPELINE_DEPTH * MAX_REPLY_LENGTH];
+    long iterations = 1L << 14;
+    struct snapshotHeader header;
+    int tileWidth = (channel != NULL) ? (int) sizeof(uint32_t) : TILE_WIDTH(DEFAULT_BOARD_SIZE);//channels stay wide
+    size_t tileBytes = DEFAULT_BOARD_SIZE * DEFAULT_BOARD_SIZE * tileWidth;
+    if (pipe(commandPipe) || pipe(dataPipe)) {
+        perror("pipe failed");
+        exit(1);
+    }
+    pid_t server = fork();
+    if (server == -1) {
+        perror("fork failed");
+        exit(1);
+    }
+    if (server == 0) {
+        serverFunction(commandPipe, dataPipe, channel);
+        _exit(0);
+    }
+    close(commandPipe[0]);
+    close(dataPipe[1]);
+    struct replyReader reader = {.fd = dataPipe[0], .channel = channel, .server = server};
+    size_t frameBytes = sizeof(struct frameHeader);
+    int32_t request[4] = {2 * sizeof(int32_t), 1, new, DEFAULT_BOARD_SIZE};//frame length and id, then the request
+    write(commandPipe[1], request, sizeof(request));
+    readReply(&reader, reply, frameBytes + (2 * sizeof(int32_t)));
+    int32_t printRequest[6] = {4 * sizeof(int32_t), 2, print, -1, 0, 0};//no board of its own, the whole one each time
+    for (int run = 0; run < BENCH_REPETITIONS; run++) {
+        double start = nowSeconds();
+        for (long i = 0; i < iterations; i++) {
+            if (channel != NULL) {
+                readBoardHeader(channel, (struct snapshotHeader *) (reply + frameBytes));
+                memcpy(reply + frameBytes + sizeof(header), channel->tiles, tileBytes);
+                continue;
+            }
+            write(commandPipe[1], printRequest, sizeof(printRequest));
+            readReply(&reader, reply, frameBytes + sizeof(header) + tileBytes + sizeof(int32_t));
+        }
+        printRuns[run] = nowSeconds() - start;
+        memcpy(&header, reply + frameBytes, sizeof(header));
+        int size = header.boardSize;
+        int empty = header.emptyIndex;
+        int neighbour = (empty % size > 0) ? empty - 1 : empty + 1;
+        const uint8_t *tiles = reply + frameBytes + sizeof(header);
+        uint32_t tile = tiles[neighbour];
+        if (tileWidth != 1) {
+            memcpy(&tile, tiles + (neighbour * sizeof(uint32_t)), sizeof(tile));
+        }
+        request[2] = move;
+        request[3] = (int32_t) tile;
+        start = nowSeconds();
+        for (long i = 0; i < iterations; i++) {
+            write(commandPipe[1], request, sizeof(request));
+            readReply(&reader, reply, frameBytes + (2 * sizeof(int32_t)));
+        }
+        moveRuns[run] = nowSeconds() - start;
+        int32_t pipeline[BENCH_PIPELINE_DEPTH][4];
+        for (int i = 0; i < BENCH_PIPELINE_DEPTH; i++) {
+            memcpy(pipeline[i], request, sizeof(request));
+        }
+        size_t replies = (channel != NULL) ? 1 : BENCH_PIPELINE_DEPTH;//a shared reply is taken in one at a time
+        start = nowSeconds();
+        for (long i = 0; i < iterations; i += BENCH_PIPELINE_DEPTH) {
+            write(commandPipe[1], pipeline, sizeof(pipeline));
+            for (int j = 0; j < BENCH_PIPELINE_DEPTH; j += replies) {
+                readReply(&reader, pipelinedReplies, replies * (frameBytes + (2 * sizeof(int32_t))));
+            }
+        }
+        pipelinedRuns[run] = nowSeconds() - start;
+    }
+    close(commandPipe[1]);//tells the server to stop
+    close(dataPipe[0]);
+    waitpid(server, NULL, 0);
+    benchSink += seed;
+    const char *printName = (channel != NULL) ? "sharedRoundTrip.print" : "pipeRoundTrip.print";
+    const char *moveName = (channel != NULL) ? "sharedRoundTrip.move" : "pipeRoundTrip.move";
+    const char *pipelinedName = (channel != NULL) ? "sharedRoundTrip.pipelinedMove" : "pipeRoundTrip.pipelinedMove";
+    reportBenchmark(printName, DEFAULT_BOARD_SIZE, iterations, printRuns);
+    reportBenchmark(moveName, DEFAULT_BOARD_SIZE, iterations, moveRuns);
+    reportBenchmark(pipelinedName, DEFAULT_BOARD_SIZE, iterations, pipelinedRuns);
+}
+
+int main(int argc, char **argv) {
+    uint64_t seed = (argc > 1) ? strtoull(argv[1], NULL, 10) : DEFAULT_BENCH_SEED;
+    if (argc > 2) {
+        fprintf(stderr, "usage: %s [seed]\n", argv[0]);
+        return 1;
+    }
+    printf("{\n  \"seed\": %llu,\n  \"benchmarks\": [\n", (unsigned long long) seed);
+    for (int size = MIN_BOARD_SIZE; size <= MAX_BOARD_SIZE; size++) {
+        if (size == MAX_PACKED_BOARD_SIZE + 1) {
+            size = MAX_BOARD_SIZE;
+        }
+        benchMoveTile(size, seed);
+        benchIsMoveValid(size, seed);
+        benchIsWon(size, seed);
+        benchSetAllTiles(size, seed);
+        benchSaveLoad(size, seed);
+    }
+    benchRoundTrip(seed, NULL);
+    struct sharedChannel *channel = createSharedChannel();
+    if (channel != NULL) {
+        benchRoundTrip(seed, channel);
+    }
+    printf("\n  ]\n}\n");
+    return 0;
+}
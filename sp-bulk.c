@@ -0,0 +1,138 @@
+/*
+ * Representing the bulk board API of "sliding puzzle" game
+ * Uses C99 standard
+ * The rules are the ones of sp-game.c, written once more over the structure-of-arrays layout of a boardSet.
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#include <stdlib.h>
+#include "sp-bulk.h"
+
+/*
+ * Allocates room for 'count' boards, all of them empty until setBoard() fills them.
+ * @return: 1 on success, 0 if the size is not playable or memory ran out.
+ */
+int allocateBoardSet(struct boardSet *set, int boardSize, size_t count) {
+    set->boardSize = boardSize;
+    set->count = count;
+    set->tiles = NULL;
+    set->emptyIndex = NULL;
+    set->moveCount = NULL;
+    if (boardSize < MIN_BOARD_SIZE || boardSize > MAX_PACKED_BOARD_SIZE || count == 0) {
+        return 0;
+    }
+    set->tiles = malloc((size_t) boardSize * boardSize * count);
+    set->emptyIndex = calloc(count, sizeof(int32_t));
+    set->moveCount = calloc(count, sizeof(int32_t));
+    if (set->tiles == NULL || set->emptyIndex == NULL || set->moveCount == NULL) {
+        freeBoardSet(set);
+        return 0;
+    }
+    return 1;
+}
+
+void freeBoardSet(struct boardSet *set) {
+    free(set->tiles);
+    free(set->emptyIndex);
+    free(set->moveCount);
+    set->tiles = NULL;
+    set->emptyIndex = NULL;
+    set->moveCount = NULL;
+}
+
+/*
+ * Copies one board in from row-major form, one byte per tile as the solver takes it, and clears its move count.
+ * @param board: boardSize * boardSize tiles, EMPTY_TILE for the empty tile.
+ * @return: 1 on success, 0 if the board has no empty tile.
+ */
+int setBoard(struct boardSet *set, size_t index, const uint8_t *board) {
+    int cellCount = set->boardSize * set->boardSize;
+    set->emptyIndex[index] = -1;
+    set->moveCount[index] = 0;
+    for (int cell = 0; cell < cellCount; cell++) {
+        set->tiles[(cell * set->count) + index] = board[cell];
+        if (board[cell] == EMPTY_TILE) {
+            set->emptyIndex[index] = cell;
+        }
+    }
+    return set->emptyIndex[index] != -1;
+}
+
+/*
+ * Exact reverse of setBoard().
+ * @param board: receives boardSize * boardSize tiles in row-major order.
+ */
+void getBoard(const struct boardSet *set, size_t index, uint8_t *board) {
+    int cellCount = set->boardSize * set->boardSize;
+    for (int cell = 0; cell < cellCount; cell++) {
+        board[cell] = set->tiles[(cell * set->count) + index];
+    }
+}
+
+/*
+ * Applies one move to each board in first..last-1, board i gets moves[i], with the rules of moveTile().
+ * A move is a tile value or a direction, see resolveMove(). Only the four neighbours of the empty tile can move,
+ * so a tile value is looked for there and nowhere else, no position index is needed.
+ * @param moves: indexed by board, like every other array of the set.
+ * @param moved: receives 1 for every board whose move was applied, 0 for a rejected one.
+ */
+void moveBoards(struct boardSet *set, size_t first, size_t last, const int32_t *moves, uint8_t *moved) {
+    int size = set->boardSize;
+    size_t count = set->count;
+    for (size_t index = first; index < last; index++) {
+        int empty = set->emptyIndex[index];
+        int emptyTileI = empty / size;
+        int emptyTileJ = empty % size;
+        int neighbours[4] = {
+                (emptyTileI < size - 1) ? empty + size : -1,//moveUp, the tile below slides up
+                (emptyTileI > 0) ? empty - size : -1,//moveDown
+                (emptyTileJ < size - 1) ? empty + 1 : -1,//moveLeft
+                (emptyTileJ > 0) ? empty - 1 : -1//moveRight
+        };
+        int entry = moves[index];
+        int from = -1;
+        if (entry <= moveUp && entry >= moveRight) {
+            from = neighbours[moveUp - entry];
+        } else {
+            for (int n = 0; n < 4 && entry > 0; n++) {
+                if (neighbours[n] != -1 && set->tiles[(neighbours[n] * count) + index] == entry) {
+                    from = neighbours[n];
+                }
+            }
+        }
+        moved[index] = (from != -1);
+        if (from != -1) {
+            set->tiles[(empty * count) + index] = set->tiles[(from * count) + index];
+            set->tiles[(from * count) + index] = EMPTY_TILE;
+            set->emptyIndex[index] = from;
+            set->moveCount[index]++;
+        }
+    }
+}
+
+/*
+ * Checks boards first..last-1 against the rule of isWon(): tiles descending with the empty tile anywhere.
+ * Walks cell by cell with every board of the range in the inner loop and no branches in it, each board carrying
+ * the tile it expects next, so the inner loop is plain vector work over contiguous bytes (built with -O3 for that).
+ * @param won: receives 1 for every won board, 0 otherwise.
+ */
+void checkWins(const struct boardSet *set, size_t first, size_t last, uint8_t *won) {
+    int cellCount = set->boardSize * set->boardSize;
+    uint8_t expected[256];
+    for (size_t block = first; block < last; block += sizeof(expected)) {
+        size_t blockLength = (last - block < sizeof(expected)) ? last - block : sizeof(expected);
+        uint8_t *restrict blockWon = won + block;
+        for (size_t i = 0; i < blockLength; i++) {
+            expected[i] = (uint8_t) (cellCount - 1);
+            blockWon[i] = 1;
+        }
+        for (int cell = 0; cell < cellCount; cell++) {
+            const uint8_t *restrict tiles = set->tiles + (cell * set->count) + block;
+            for (size_t i = 0; i < blockLength; i++) {
+                uint8_t isEmpty = (tiles[i] == EMPTY_TILE);
+                blockWon[i] &= (uint8_t) ((tiles[i] == expected[i]) | isEmpty);
+                expected[i] -= (uint8_t) (1 - isEmpty);
+            }
+        }
+    }
+}
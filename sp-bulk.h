@@ -0,0 +1,41 @@
+/*
+ * Representing the bulk board API of "sliding puzzle" game
+ * Uses C99 standard
+ * Many boards of one size kept structure-of-arrays: all boards' tiles of cell 0, then all of cell 1, and so on.
+ * Every call walks the boards in the inner loop, so a step over a million boards is a few straight passes over memory
+ * the compiler can vectorize, instead of a million visits to scattered struct game allocations.
+ * Calls take a range of boards, threads working on disjoint ranges of one set never touch the same bytes.
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#ifndef SP_BULK_H
+#define SP_BULK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sp-protocol.h"
+
+/*
+ * tiles[(cell * count) + index] is the tile in 'cell' of board 'index', EMPTY_TILE for the empty tile.
+ */
+struct boardSet {
+    int boardSize;
+    size_t count;
+    uint8_t *tiles;
+    int32_t *emptyIndex;//[index]
+    int32_t *moveCount;//[index], successful moves applied through moveBoards()
+};
+
+int allocateBoardSet(struct boardSet *set, int boardSize, size_t count);
+
+void freeBoardSet(struct boardSet *set);
+
+int setBoard(struct boardSet *set, size_t index, const uint8_t *board);
+
+void getBoard(const struct boardSet *set, size_t index, uint8_t *board);
+
+void moveBoards(struct boardSet *set, size_t first, size_t last, const int32_t *moves, uint8_t *moved);
+
+void checkWins(const struct boardSet *set, size_t first, size_t last, uint8_t *won);
+
+#endif
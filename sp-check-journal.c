@@ -0,0 +1,118 @@
+/*
+ * Representing the journal checks of "sliding puzzle" game
+ * Uses C99 standard
+ * Usage: sp-check-journal, writes and removes sp-check.spj in the working directory.
+ * A game plays random moves, undos and redos against a plain list of every board it went through: an undo must bring
+ * back the board before the last move, a redo the one after, and a new move must drop whatever could be redone.
+ * The same journal written to a file must then rebuild the game in a fresh one, as a restarted server would, with
+ * its board and move count, and every undo and redo of the history still to be had.
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "sp-check.h"
+
+#define JOURNAL_FILE "sp-check.spj"
+#define CHECK_SIZE 4
+#define CHECK_CELLS (CHECK_SIZE * CHECK_SIZE)
+#define CHECK_STEPS 5000
+#define CHECK_SEED 0x10c0ffeeULL
+
+/*
+ * Every board of the game since its checkpoint, boards[0] up to boards[current] are the moves in effect and
+ * the ones after 'current' up to 'last' are those an undo took back.
+ */
+struct boardHistory {
+    uint8_t boards[CHECK_STEPS + 1][CHECK_CELLS];
+    int current;
+    int last;
+};
+
+/*
+ * @return: 1 if the game's board is the given one.
+ */
+int isBoard(const struct game *game, const uint8_t *tiles) {
+    return memcmp(game->board, tiles, CHECK_CELLS) == 0;
+}
+
+/*
+ * Plays one random step on the game and the history alike, a move in two steps out of three, else an undo or a redo.
+ */
+void playStep(struct game *game, struct boardHistory *history, uint64_t *state, int step) {
+    uint64_t draw = nextCheckRandom(state) % 6;
+    int moveCount = game->moveCount;
+    if (draw < 4) {
+        if (moveTile(game, resolveMove(game, moveUp - (int) draw))) {
+            history->current++;
+            history->last = history->current;
+            memcpy(history->boards[history->current], game->board, CHECK_CELLS);
+        }
+    } else if (draw == 4) {
+        int isUndone = undoMove(game);
+        expect(isUndone == (history->current > 0), "step %d: undo gave %d with %d moves in effect", step, isUndone,
+               history->current);
+        history->current -= isUndone;
+        expect(isUndone == 0 || game->moveCount == moveCount - 1, "step %d: undo left the move count at %d", step,
+               game->moveCount);
+    } else {
+        int isRedone = redoMove(game);
+        expect(isRedone == (history->current < history->last), "step %d: redo gave %d with %d moves to redo", step,
+               isRedone, history->last - history->current);
+        history->current += isRedone;
+    }
+    expect(isBoard(game, history->boards[history->current]), "step %d: board is not the one in the history", step);
+}
+
+/*
+ * Undoes every move in effect and redoes everything that can be redone, checking each board against the history.
+ */
+void unwindHistory(struct game *game, const struct boardHistory *history) {
+    for (int i = history->current; i > 0; i--) {
+        expect(undoMove(game) && isBoard(game, history->boards[i - 1]), "undo back to move %d differs", i - 1);
+    }
+    expect(undoMove(game) == 0, "undo goes past the checkpoint");
+    for (int i = 0; i < history->last; i++) {
+        expect(redoMove(game) && isBoard(game, history->boards[i + 1]), "redo up to move %d differs", i + 1);
+    }
+    expect(redoMove(game) == 0, "redo goes past the last move");
+}
+
+int main(void) {
+    struct game game;
+    struct game rebuilt;
+    struct journal journal;
+    struct journal rebuiltJournal;
+    struct boardHistory *history = malloc(sizeof(struct boardHistory));
+    uint64_t state = CHECK_SEED;
+    memset(&game, 0, sizeof(game));
+    memset(&rebuilt, 0, sizeof(rebuilt));
+    unlink(JOURNAL_FILE);
+    if (history == NULL || initialize(&game, CHECK_SIZE) == 0 || initialize(&rebuilt, CHECK_SIZE) == 0) {
+        fprintf(stderr, "not enough memory for the games\n");
+        return 1;
+    }
+    expect(openJournal(&journal, JOURNAL_FILE, &game) == 0, "a game is rebuilt from a journal that is not there");
+    expect(checkpointJournal(&journal, &game), "journal cannot be started");
+    game.journal = &journal;
+    history->current = 0;
+    history->last = 0;
+    memcpy(history->boards[0], game.board, CHECK_CELLS);
+    for (int step = 0; step < CHECK_STEPS; step++) {
+        playStep(&game, history, &state, step);
+    }
+    flushJournal(&journal);
+    closeJournal(&journal, 1);//as a server that died would leave it
+    int wasRebuilt = openJournal(&rebuiltJournal, JOURNAL_FILE, &rebuilt);
+    rebuilt.journal = &rebuiltJournal;
+    expect(wasRebuilt && isSameBoard(&game, &rebuilt) && rebuilt.moveCount == game.moveCount,
+           "game is not rebuilt from its journal with its %d moves", game.moveCount);
+    unwindHistory(&rebuilt, history);
+    closeJournal(&rebuiltJournal, 0);
+    tearDown(&game);
+    tearDown(&rebuilt);
+    free(history);
+    return finishChecks("sp-check-journal");
+}
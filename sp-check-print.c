@@ -0,0 +1,339 @@
+/*
+ * Representing the print checks of "sliding puzzle" game
+ * Uses C99 standard
+ * Runs the server the way the client does and prints the board between random moves and new games, once with replies
+ * on the data pipe and once through a shared channel, where a print is read from the published board.
+ * Every print must come as a snapshot header and its tiles, TILE_WIDTH() bytes each on the pipe, hold a well formed
+ * board and be the board the moves made, with the misplaced tiles and distance the server keeps running the same as
+ * counted afresh. New games go past MAX_PACKED_BOARD_SIZE, so packed and wide boards are both printed.
+ * On the pipe each print names the board the last one left, which must bring back only the cells a move changed,
+ * applied to that board, and the whole board after a new game.
+ * Every reply must come in a frame with the id of its request and the length of what follows. Requests sent
+ * together must be answered in order, one that does not fit its command with the status word alone, and a frame
+ * too long to be a request with REQUEST_REJECTED before the server hangs up.
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "sp-check.h"
+#include "sp-shared.h"
+
+#define CHECK_ROUNDS 2000
+#define CHECK_SEED 0x5eed1ULL
+#define MAX_CHECK_SIZE 12
+#define CHECK_PIPELINE 16//requests written at once before any reply is read
+
+/*
+ * A print as the client takes it in, tiles widened to uint32_t whatever they took on the wire.
+ */
+struct printedBoard {
+    struct snapshotHeader header;
+    uint32_t tiles[MAX_CHECK_SIZE * MAX_CHECK_SIZE];
+};
+
+void serverFunction(int *command, int *data, struct sharedChannel *channel);
+
+int commandPipe[2];
+int dataPipe[2];
+struct replyReader reader;
+int32_t mirrorGame;//game of the board the last print left, -1 before the first
+uint32_t requestId;//of the last request sent
+
+/*
+ * Sends one request in its frame.
+ * @param arguments: 'length' bytes that go after the command.
+ */
+void sendRequest(int32_t command, const void *arguments, size_t length) {
+    uint8_t request[MAX_REQUEST_LENGTH];
+    struct frameHeader frame = {.length = sizeof(command) + length, .id = ++requestId};
+    memcpy(request, &frame, sizeof(frame));
+    memcpy(request + sizeof(frame), &command, sizeof(command));
+    memcpy(request + sizeof(frame) + sizeof(command), arguments, length);
+    write(commandPipe[1], request, sizeof(frame) + frame.length);
+}
+
+/*
+ * Takes in the frame of the next reply, which must answer the request with the given id.
+ * @return: bytes the frame says follow it, -1 if there is no reply.
+ */
+long readFrame(uint32_t id) {
+    struct frameHeader frame;
+    if (!expect(readReply(&reader, &frame, sizeof(frame)), "reply to request %u did not come", id)) {
+        return -1;
+    }
+    expect(frame.id == id, "reply carries id %u, the request it answers had %u", frame.id, id);
+    return frame.length;
+}
+
+/*
+ * Counts the misplaced tiles and the distance of a snapshot's board from scratch, each tile against its two winning
+ * cells, maxTileValue - value and the one after it.
+ */
+void measureSnapshot(const struct printedBoard *snapshot, int *misplacedTiles, int *manhattanDistance) {
+    int size = snapshot->header.boardSize;
+    int maxTileValue = (size * size) - 1;
+    *misplacedTiles = 0;
+    *manhattanDistance = 0;
+    for (int cell = 0; cell <= maxTileValue; cell++) {
+        int tile = snapshot->tiles[cell];
+        if (tile == EMPTY_TILE) {
+            continue;
+        }
+        int first = maxTileValue - tile;
+        int second = first + 1;
+        int toFirst = abs(cell / size - first / size) + abs(cell % size - first % size);
+        int toSecond = abs(cell / size - second / size) + abs(cell % size - second % size);
+        *misplacedTiles += cell != first && cell != second;
+        *manhattanDistance += (toFirst < toSecond) ? toFirst : toSecond;
+    }
+}
+
+/*
+ * Asks for a print and takes the header and then the tiles in, as the client does.
+ * @param snapshot: the board the last print left, brought up to date when only the changed cells come.
+ * @return: 1 if the snapshot came whole and its board is well formed.
+ */
+int printBoard(struct printedBoard *snapshot) {
+    uint8_t arguments[sizeof(int32_t) + sizeof(int64_t)];
+    struct snapshotHeader *header = &snapshot->header;
+    long frameLength = 0;
+    memcpy(arguments, &mirrorGame, sizeof(mirrorGame));
+    memcpy(arguments + sizeof(mirrorGame), &header->boardVersion, sizeof(header->boardVersion));
+    if (reader.channel != NULL) {
+        readBoardHeader(reader.channel, header);
+    } else {
+        sendRequest(print, arguments, sizeof(arguments));
+        frameLength = readFrame(requestId);
+        if (frameLength == -1 || !expect(readReply(&reader, header, sizeof(*header)), "print header did not come")) {
+            return 0;
+        }
+    }
+    if (!expect(header->version == SNAPSHOT_VERSION && header->boardSize >= MIN_BOARD_SIZE
+                && header->boardSize <= MAX_CHECK_SIZE, "print header has version %d size %d",
+                header->version, header->boardSize)) {
+        return 0;
+    }
+    int cellCount = header->boardSize * header->boardSize;
+    int width = TILE_WIDTH(header->boardSize);
+    uint8_t *packed = (uint8_t *) snapshot->tiles;//tiles a byte each are read in here and widened from the back
+    if (reader.channel != NULL) {
+        memcpy(snapshot->tiles, reader.channel->tiles, cellCount * sizeof(uint32_t));
+    } else if (header->changes != -1) {
+        uint32_t pair[2] = {0, 0};
+        uint8_t packedPair[2];
+        int isWhole = expect(header->changes >= 0 && header->game == mirrorGame,
+                             "print sends %d changes to a board of game %d, the client holds game %d",
+                             header->changes, header->game, mirrorGame);
+        for (int i = 0; isWhole && i < header->changes; i++) {
+            isWhole = expect(readReply(&reader, (width == 1) ? (void *) packedPair : (void *) pair, 2 * width),
+                             "print lost its changed cells");
+            if (width == 1) {
+                pair[0] = packedPair[0];
+                pair[1] = packedPair[1];
+            }
+            isWhole = isWhole && expect(pair[0] < (uint32_t) cellCount, "print changes cell %u of %d", pair[0],
+                                        cellCount);
+            if (isWhole) {
+                snapshot->tiles[pair[0]] = pair[1];
+            }
+        }
+        if (isWhole == 0) {
+            return 0;
+        }
+    } else if (!expect(readReply(&reader, snapshot->tiles, (size_t) cellCount * width),
+                       "print of a %dx%d board lost its tiles", header->boardSize, header->boardSize)) {
+        return 0;
+    }
+    for (int cell = cellCount - 1; reader.channel == NULL && header->changes == -1 && width == 1 && cell >= 0;
+         cell--) {
+        snapshot->tiles[cell] = packed[cell];
+    }
+    mirrorGame = header->game;
+    long streamed = (long) ((header->changes == -1) ? cellCount : 2 * header->changes) * width;
+    expect(reader.channel != NULL || frameLength == (long) sizeof(*header) + streamed + (long) sizeof(int32_t),
+           "print frame says %ld bytes follow, the header, %ld bytes of tiles and the status word are %zu",
+           frameLength, streamed, sizeof(*header) + streamed + sizeof(int32_t));
+    int seen[MAX_CHECK_SIZE * MAX_CHECK_SIZE] = {0};
+    int isPermutation = 1;
+    for (int index = 0; index < cellCount; index++) {
+        int tile = snapshot->tiles[index];
+        if (tile >= cellCount || seen[tile]++ != 0) {
+            isPermutation = 0;
+        }
+    }
+    expect(isPermutation, "print of a %dx%d board does not hold every tile once", header->boardSize,
+           header->boardSize);
+    int misplacedTiles;
+    int manhattanDistance;
+    measureSnapshot(snapshot, &misplacedTiles, &manhattanDistance);
+    expect(header->misplacedTiles == misplacedTiles && header->manhattanDistance == manhattanDistance,
+           "print has %d misplaced tiles and distance %d, its board has %d and %d", header->misplacedTiles,
+           header->manhattanDistance, misplacedTiles, manhattanDistance);
+    return expect(header->emptyIndex >= 0 && header->emptyIndex < cellCount
+                  && snapshot->tiles[header->emptyIndex] == EMPTY_TILE,
+                  "print puts the empty tile at %d, it is not there", header->emptyIndex) && isPermutation;
+}
+
+/*
+ * Sends a command with one int argument and takes its reply.
+ * @return: the reply, whether the command succeeded.
+ */
+int sendCommand(enum menuOptions command, int argument) {
+    int successful;
+    sendRequest(command, &argument, sizeof(argument));
+    return readFrame(requestId) == 2 * sizeof(int32_t) && readReply(&reader, &successful, sizeof(successful))
+           && successful;
+}
+
+/*
+ * @return: the status word the server ends each reply with, 1 if the last move won and a new game began.
+ */
+int readStatus() {
+    int isWon = 0;
+    readReply(&reader, &isWon, sizeof(isWon));
+    return isWon;
+}
+
+/*
+ * Sends requests the client never would and ends the server with a frame too long to be a request, the server
+ * says on stderr why it closes.
+ */
+void checkFraming() {
+    uint8_t pipeline[CHECK_PIPELINE * (sizeof(struct frameHeader) + (2 * sizeof(int32_t)))];
+    int32_t status;
+    uint32_t firstId = requestId + 1;
+    for (int i = 0; i < CHECK_PIPELINE; i++) {
+        int32_t request[4] = {2 * sizeof(int32_t), (int32_t) ++requestId, move, EMPTY_TILE};//never a valid move
+        memcpy(pipeline + (i * sizeof(request)), request, sizeof(request));
+    }
+    write(commandPipe[1], pipeline, sizeof(pipeline));
+    for (uint32_t id = firstId; id <= requestId; id++) {
+        int successful = 1;
+        expect(readFrame(id) == 2 * sizeof(int32_t) && readReply(&reader, &successful, sizeof(successful))
+               && successful == 0 && readStatus() == 0, "pipelined move %u is not answered as a failed move", id);
+    }
+    sendRequest(move, NULL, 0);
+    expect(readFrame(requestId) == sizeof(int32_t) && readStatus() == 0, "move without its tile is answered with "
+           "more than the status word");
+    sendRequest(noAction + 100, NULL, 0);
+    expect(readFrame(requestId) == sizeof(int32_t) && readStatus() == 0, "unknown command is answered with more "
+           "than the status word");
+    struct frameHeader tooLong = {.length = MAX_REQUEST_LENGTH, .id = ++requestId};
+    write(commandPipe[1], &tooLong, sizeof(tooLong));
+    expect(readFrame(requestId) == sizeof(int32_t) && readReply(&reader, &status, sizeof(status))
+           && status == REQUEST_REJECTED, "frame too long to be a request is not rejected");
+    expect(readReply(&reader, &status, sizeof(status)) == 0, "server goes on after a frame too long to be a request");
+}
+
+/*
+ * Forks a server and plays the rounds against it, a print is only asked of the server when there is no channel.
+ * @param channel: shared mapping the server publishes to, or NULL for replies on the data pipe.
+ * @param label: names the run in what failed.
+ * @return: 1 if the server could be started.
+ */
+int checkPrints(struct sharedChannel *channel, const char *label) {
+    if (pipe(commandPipe) || pipe(dataPipe)) {
+        perror("pipe failed");
+        return 0;
+    }
+    pid_t server = fork();
+    if (server == -1) {
+        perror("fork failed");
+        return 0;
+    }
+    if (server == 0) {
+        serverFunction(commandPipe, dataPipe, channel);
+        exit(0);
+    }
+    close(commandPipe[0]);
+    close(dataPipe[1]);
+    reader = (struct replyReader) {.fd = dataPipe[0], .channel = channel, .server = server};
+    uint64_t random = CHECK_SEED;
+    struct printedBoard expected;
+    struct printedBoard snapshot;
+    memset(&snapshot, 0, sizeof(snapshot));
+    mirrorGame = -1;
+    requestId = 0;
+    int isKnown = 0;//whether 'expected' is the board the server should have
+    int newSize = 4;//size of a game just begun, 0 once a move was made in it
+    sendRequest(noAction, NULL, 0);//the server only speaks when asked, this brings the first published board
+    expect(readFrame(requestId) == sizeof(int32_t), "%s: noAction is answered with more than the status word", label);
+    readStatus();
+    for (int round = 0; round < CHECK_ROUNDS; round++) {
+        if (!printBoard(&snapshot)) {
+            break;
+        }
+        if (isKnown) {
+            int size = snapshot.header.boardSize;
+            expect(memcmp(&snapshot.header, &expected.header, sizeof(expected.header)) == 0
+                   && memcmp(snapshot.tiles, expected.tiles, size * size * sizeof(uint32_t)) == 0,
+                   "%s round %d: print is not the board the moves made", label, round);
+        }
+        if (newSize != 0) {
+            expect(snapshot.header.boardSize == newSize && snapshot.header.moveCount == 0
+                   && snapshot.header.changes == -1,
+                   "%s round %d: print of a new %dx%d game has size %d, %d moves and %d changes", label, round,
+                   newSize, newSize, snapshot.header.boardSize, snapshot.header.moveCount, snapshot.header.changes);
+            newSize = 0;
+        }
+        if (channel == NULL && readStatus()) {//a print read from the channel asked nothing of the server
+            isKnown = 0;
+            newSize = 4;
+            continue;
+        }
+        expected = snapshot;
+        int size = snapshot.header.boardSize;
+        int empty = snapshot.header.emptyIndex;
+        uint64_t draw = nextCheckRandom(&random);
+        if (draw % 50 == 0) {
+            newSize = MIN_BOARD_SIZE + (int) ((draw >> 8) % (MAX_CHECK_SIZE - MIN_BOARD_SIZE + 1));
+            expect(sendCommand(new, newSize) == 1, "%s round %d: new %dx%d game failed", label, round, newSize,
+                   newSize);
+            isKnown = 0;
+        } else {
+            int cell = (int) ((draw >> 8) % (size * size));
+            int distance = abs(cell / size - empty / size) + abs(cell % size - empty % size);
+            int tile = snapshot.tiles[cell];
+            int successful = sendCommand(move, tile);
+            expect(successful == (distance == 1),
+                   "%s round %d: move of tile %d, %d cells from the empty tile, gave %d", label, round, tile, distance,
+                   successful);
+            if (channel == NULL) {
+                expected.header.changes = (distance == 1) ? 2 : 0;//the two cells of the move, or none
+            }
+            if (distance == 1) {
+                expected.tiles[empty] = tile;
+                expected.tiles[cell] = EMPTY_TILE;
+                expected.header.emptyIndex = cell;
+                expected.header.moveCount++;
+                expected.header.boardVersion++;
+                measureSnapshot(&expected, &expected.header.misplacedTiles, &expected.header.manhattanDistance);
+            }
+            isKnown = 1;
+        }
+        if (readStatus()) {
+            isKnown = 0;
+            newSize = 4;
+        }
+    }
+    if (channel == NULL) {
+        checkFraming();
+    }
+    close(commandPipe[1]);
+    close(dataPipe[0]);
+    waitpid(server, NULL, 0);
+    return 1;
+}
+
+int main() {
+    struct sharedChannel *channel = createSharedChannel();
+    if (checkPrints(NULL, "pipe") == 0 || expect(channel != NULL, "shared channel cannot be created") == 0
+        || checkPrints(channel, "shared") == 0) {
+        return 1;
+    }
+    return finishChecks("sp-check-print");
+}
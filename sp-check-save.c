@@ -0,0 +1,172 @@
+/*
+ * Representing the save format checks of "sliding puzzle" game
+ * Uses C99 standard
+ * Usage: sp-check-save, writes and removes sp-check.sav and sp-check.spar in the working directory.
+ * Games of every tile width, from boards small enough for one read() to ones streamed a chunk at a time, go through
+ * saveGame() and loadGame(), and through an archive, and must come back tile for tile with their move count.
+ * A record with a byte changed anywhere, or cut short, must be turned down and leave the game in progress as it was.
+ * A version 1 record, as saves were written before boards grew past MAX_PACKED_BOARD_SIZE, must still load.
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "sp-check.h"
+
+#define SAVE_FILE "sp-check.sav"
+#define ARCHIVE_FILE "sp-check.spar"
+#define CHECK_SEED 0x5a7e5a7eULL
+#define CHECK_MOVES 200
+
+static const int checkSizes[] = {3, 4, 9, 10, 17, 257};//byte tiles in one read, wide games, 2 and 4 byte tiles streamed
+
+/*
+ * A dealt board of the given size with some moves made on it, so the move count has something to carry.
+ */
+int dealGame(struct game *game, int size, uint64_t *state) {
+    memset(game, 0, sizeof(*game));
+    game->randomState = nextCheckRandom(state) | 1;
+    if (initialize(game, size) == 0) {
+        return 0;
+    }
+    for (int i = 0; i < CHECK_MOVES; i++) {
+        moveTile(game, resolveMove(game, moveUp - (int) (nextCheckRandom(state) % 4)));
+    }
+    return 1;
+}
+
+/*
+ * Changes one byte of a file in place.
+ */
+int flipByte(const char *fileName, long offset) {
+    FILE *file = fopen(fileName, "r+b");
+    int wasFlipped = file != NULL && fseek(file, offset, SEEK_SET) == 0;
+    int value = wasFlipped ? fgetc(file) : EOF;
+    wasFlipped = value != EOF && fseek(file, offset, SEEK_SET) == 0 && fputc(value ^ 0x40, file) != EOF;
+    if (file != NULL && fclose(file) != 0) {
+        wasFlipped = 0;
+    }
+    return wasFlipped;
+}
+
+/*
+ * Saves and loads a game of each size, then damages its file and loads it again over another game.
+ */
+void checkSaves(uint64_t *state) {
+    for (size_t i = 0; i < sizeof(checkSizes) / sizeof(checkSizes[0]); i++) {
+        struct game game;
+        struct game loaded;
+        int size = checkSizes[i];
+        if (expect(dealGame(&game, size, state) && dealGame(&loaded, 4, state), "no memory for a %dx%d game", size)
+            == 0) {
+            continue;
+        }
+        expect(saveGame(&game, SAVE_FILE), "%dx%d game does not save", size, size);
+        expect(loadGame(&loaded, SAVE_FILE) && isSameBoard(&game, &loaded) && loaded.moveCount == game.moveCount,
+               "%dx%d game does not load as it was saved", size, size);
+        long length = (long) recordLength(size);
+        long offsets[] = {0, (long) offsetof(struct saveHeader, checksum), length / 2, length - 1};
+        for (size_t j = 0; j < sizeof(offsets) / sizeof(offsets[0]); j++) {
+            uint64_t before = boardHash(&loaded);
+            saveGame(&game, SAVE_FILE);
+            expect(flipByte(SAVE_FILE, offsets[j]) && loadGame(&loaded, SAVE_FILE) == 0 && boardHash(&loaded) == before,
+                   "%dx%d save with byte %ld changed is not turned down", size, size, offsets[j]);
+        }
+        saveGame(&game, SAVE_FILE);
+        expect(truncate(SAVE_FILE, length - 1) == 0 && loadGame(&loaded, SAVE_FILE) == 0,
+               "%dx%d save cut short is not turned down", size, size);
+        tearDown(&game);
+        tearDown(&loaded);
+    }
+}
+
+/*
+ * Archives a game of each size, loads every one back, then damages one record and loads them all again.
+ */
+void checkArchive(uint64_t *state) {
+    struct game games[sizeof(checkSizes) / sizeof(checkSizes[0])];
+    struct archiveWriter writer;
+    struct archive archive;
+    struct game loaded;
+    int count = (int) (sizeof(checkSizes) / sizeof(checkSizes[0]));
+    long damaged = -1;
+    memset(&loaded, 0, sizeof(loaded));
+    expect(createArchive(&writer, ARCHIVE_FILE), "archive cannot be created");
+    for (int i = 0; i < count; i++) {
+        expect(dealGame(&games[i], checkSizes[i], state) && appendGame(&writer, &games[i]),
+               "%dx%d game cannot be archived", checkSizes[i], checkSizes[i]);
+        damaged = (i == 1) ? (long) writer.position - 1 : damaged;//the last tile of the 4x4 game
+    }
+    expect(finishArchive(&writer), "archive cannot be finished");
+    for (int pass = 0; pass < 2; pass++) {
+        if (expect(openArchive(&archive, ARCHIVE_FILE) && archive.count == (uint64_t) count,
+                   "archive does not open with %d games", count) == 0) {
+            break;
+        }
+        for (int i = 0; i < count; i++) {
+            int isLoaded = loadArchivedGame(&archive, i, &loaded);
+            int isExpected = pass == 0 || i != 1;
+            expect(isLoaded == isExpected && (isLoaded == 0 || isSameBoard(&games[i], &loaded)),
+                   "archived %dx%d game %s", checkSizes[i], checkSizes[i],
+                   isExpected ? "does not load as it was added" : "is loaded though damaged");
+        }
+        closeArchive(&archive);
+        expect(pass == 1 || flipByte(ARCHIVE_FILE, damaged), "archive cannot be damaged");
+    }
+    for (int i = 0; i < count; i++) {
+        tearDown(&games[i]);
+    }
+    tearDown(&loaded);
+}
+
+/*
+ * FNV-1a over some bytes, continuing from 'hash', the checksum a record is written with.
+ */
+uint32_t checksumFnv(uint32_t hash, const uint8_t *bytes, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/*
+ * Loads a 3x3 record written the way version 1 wrote it, and the same record with its checksum off by one.
+ */
+void checkVersion1() {
+    struct saveHeaderVersion1 header = {.magic = "SPSV", .version = SAVE_VERSION_1, .boardSize = 3,
+                                        .headerLength = sizeof(struct saveHeaderVersion1), .emptyIndex = 7,
+                                        .moveCount = 5, .checksum = 0};
+    const uint8_t tiles[9] = {1, 7, 6, 5, 4, 3, 2, EMPTY_TILE, 8};
+    const uint32_t wide[9] = {1, 7, 6, 5, 4, 3, 2, EMPTY_TILE, 8};
+    uint8_t record[sizeof(header) + sizeof(tiles)];
+    struct game game;
+    struct game expected;
+    memset(&game, 0, sizeof(game));
+    memset(&expected, 0, sizeof(expected));
+    initialize(&game, 4);
+    expected.isLoadingGame = 1;
+    initialize(&expected, 3);
+    putBoard(&expected, wide);
+    header.checksum = checksumFnv(checksumFnv(2166136261u, (const uint8_t *) &header, sizeof(header)), tiles,
+                                  sizeof(tiles));
+    memcpy(record, &header, sizeof(header));
+    memcpy(record + sizeof(header), tiles, sizeof(tiles));
+    expect(unpackGame(&game, record, sizeof(record)) && isSameBoard(&game, &expected) && game.moveCount == 5,
+           "version 1 record does not load");
+    record[offsetof(struct saveHeaderVersion1, checksum)] ^= 1;
+    expect(unpackGame(&game, record, sizeof(record)) == 0, "version 1 record with a bad checksum is loaded");
+    tearDown(&game);
+    tearDown(&expected);
+}
+
+int main(void) {
+    uint64_t state = CHECK_SEED;
+    checkSaves(&state);
+    checkArchive(&state);
+    checkVersion1();
+    unlink(SAVE_FILE);
+    unlink(ARCHIVE_FILE);
+    return finishChecks("sp-check-save");
+}
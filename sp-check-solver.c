@@ -0,0 +1,361 @@
+/*
+ * Representing the solver checks of "sliding puzzle" game
+ * Uses C99 standard
+ * Usage: sp-check-solver [pattern database of size 3]
+ * Every 3x3 board is reached by breadth first search backwards from each winning board, which gives the exact
+ * distance of every board to every goal. Against those distances:
+ *  - isSolvable() holds for exactly the boards that were reached, and isWon() for exactly the goals.
+ *  - manhattanDistance never overestimates the distance to the nearest goal, and the pattern database, when one is
+ *    given, never overestimates the distance to any single goal.
+ *  - solveBoard() finds a solution of exactly the optimal length for sampled boards, without and with the database,
+ *    whose moves win the game when played, and gives up on every unsolvable one.
+ * Scrambled 4x4 boards, hard enough for passes to be split between threads, are solved with one thread and with
+ * several, the solutions must be just as long.
+ * hintGame() gives the optimal distance and a tile that brings the board one move closer, asked again it answers
+ * from the table with the same, and following its hints wins in exactly that many moves, every later one a lookup.
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sp-check.h"
+#include "sp-pdb.h"
+#include "sp-solver.h"
+
+#define CHECK_SIZE 3
+#define CHECK_CELLS (CHECK_SIZE * CHECK_SIZE)
+#define PERMUTATIONS 362880//9!, every way to lay the tiles of a 3x3 board out
+#define UNREACHED 0xff
+#define SOLVER_SAMPLES 300
+#define CHECK_SEED 0x5eed5eedULL
+#define THREAD_SIZE 4
+#define THREAD_SAMPLES 6
+#define THREAD_SCRAMBLE 200//random steps away from a won board
+#define THREAD_COUNT 4
+#define HINT_SAMPLES 100
+
+/*
+ * Lehmer code of a board, its position among all permutations in lexicographic order.
+ */
+uint32_t rankBoard(const uint8_t *tiles) {
+    uint32_t rank = 0;
+    for (int i = 0; i < CHECK_CELLS; i++) {
+        int smaller = 0;
+        for (int j = i + 1; j < CHECK_CELLS; j++) {
+            smaller += tiles[j] < tiles[i];
+        }
+        rank = (rank * (CHECK_CELLS - i)) + smaller;
+    }
+    return rank;
+}
+
+void unrankBoard(uint32_t rank, uint8_t *tiles) {
+    int digits[CHECK_CELLS];
+    int unused[CHECK_CELLS];
+    for (int i = CHECK_CELLS - 1; i >= 0; i--) {
+        digits[i] = rank % (CHECK_CELLS - i);
+        rank /= CHECK_CELLS - i;
+    }
+    for (int value = 0; value < CHECK_CELLS; value++) {
+        unused[value] = value;
+    }
+    for (int i = 0; i < CHECK_CELLS; i++) {
+        tiles[i] = unused[digits[i]];
+        memmove(&unused[digits[i]], &unused[digits[i] + 1], (CHECK_CELLS - i - digits[i] - 1) * sizeof(int));
+    }
+}
+
+/*
+ * The winning board whose empty tile ends on 'goal', tiles in descending order around it, see isWon().
+ */
+void goalBoard(int goal, uint8_t *tiles) {
+    for (int slot = 0; slot < CHECK_CELLS - 1; slot++) {
+        tiles[(slot < goal) ? slot : slot + 1] = (CHECK_CELLS - 1) - slot;
+    }
+    tiles[goal] = EMPTY_TILE;
+}
+
+/*
+ * Distances from one goal to every board, moves are their own inverse so searching from the goal is the same.
+ * @param distances: PERMUTATIONS entries, UNREACHED for a board the goal cannot be reached from.
+ */
+void searchFromGoal(int goal, uint8_t *distances, uint32_t *queue) {
+    uint8_t tiles[CHECK_CELLS];
+    size_t head = 0;
+    size_t tail = 0;
+    memset(distances, UNREACHED, PERMUTATIONS);
+    goalBoard(goal, tiles);
+    queue[tail++] = rankBoard(tiles);
+    distances[queue[0]] = 0;
+    while (head < tail) {
+        uint32_t rank = queue[head++];
+        unrankBoard(rank, tiles);
+        int empty = (int) ((const uint8_t *) memchr(tiles, EMPTY_TILE, CHECK_CELLS) - tiles);
+        int neighbours[4] = {empty - CHECK_SIZE, empty + CHECK_SIZE, (empty % CHECK_SIZE > 0) ? empty - 1 : -1,
+                             (empty % CHECK_SIZE < CHECK_SIZE - 1) ? empty + 1 : -1};
+        for (int i = 0; i < 4; i++) {
+            int cell = neighbours[i];
+            if (cell < 0 || cell >= CHECK_CELLS) {
+                continue;
+            }
+            tiles[empty] = tiles[cell];
+            tiles[cell] = EMPTY_TILE;
+            uint32_t next = rankBoard(tiles);
+            if (distances[next] == UNREACHED) {
+                distances[next] = distances[rank] + 1;
+                queue[tail++] = next;
+            }
+            tiles[cell] = tiles[empty];
+            tiles[empty] = EMPTY_TILE;
+        }
+    }
+}
+
+/*
+ * Plays a solution out on the board, each move has to be a tile next to the empty tile.
+ * @return: the number of moves that could be played.
+ */
+int playMoves(uint8_t *board, const int32_t *moves, int length) {
+    for (int played = 0; played < length; played++) {
+        int empty = 0;
+        int cell = 0;
+        while (board[empty] != EMPTY_TILE) {
+            empty++;
+        }
+        while (cell < CHECK_CELLS && board[cell] != moves[played]) {
+            cell++;
+        }
+        int distance = abs(cell / CHECK_SIZE - empty / CHECK_SIZE) + abs(cell % CHECK_SIZE - empty % CHECK_SIZE);
+        if (cell == CHECK_CELLS || distance != 1) {
+            return played;
+        }
+        board[empty] = board[cell];
+        board[cell] = EMPTY_TILE;
+    }
+    return length;
+}
+
+/*
+ * @return: 1 if the tiles read in descending order with the empty tile anywhere, the server's win rule.
+ */
+int isWonBoard(const uint8_t *board) {
+    int expectedValue = CHECK_CELLS - 1;
+    for (int cell = 0; cell < CHECK_CELLS; cell++) {
+        if (board[cell] != EMPTY_TILE && board[cell] != expectedValue--) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * The database's estimate towards one goal, the sum over its patterns, read the way the solver reads it.
+ */
+int patternEstimate(const struct patternDatabase *database, const uint8_t *tiles, int goal) {
+    uint8_t position[CHECK_CELLS];
+    int estimate = 0;
+    for (int cell = 0; cell < CHECK_CELLS; cell++) {
+        position[tiles[cell]] = cell;
+    }
+    for (int p = 0; p < database->patternCount; p++) {
+        const struct pdbPattern *pattern = &database->patterns[p];
+        uint8_t positions[PDB_MAX_PATTERN_TILES];
+        int segment = 0;
+        for (uint32_t i = 0; i < pattern->tileCount; i++) {
+            positions[i] = position[(CHECK_CELLS - 1) - pattern->slots[i]];
+            segment += pattern->slots[i] < goal;
+        }
+        uint64_t rank = rankPattern(positions, pattern->tileCount, CHECK_CELLS);
+        estimate += database->base[pattern->offset + (rank * (pattern->tileCount + 1)) + segment];
+    }
+    return estimate;
+}
+
+/*
+ * Walks every board, checking what can be checked without the solver: a board is solvable exactly when some goal
+ * was reached from it, and no estimate may be over the distance the search found.
+ */
+void checkEveryBoard(uint8_t *const *distances, const uint8_t *nearest, const struct patternDatabase *database) {
+    struct game game;
+    uint8_t tiles[CHECK_CELLS];
+    uint32_t wide[CHECK_CELLS];
+    memset(&game, 0, sizeof(game));
+    game.isLoadingGame = 1;
+    initialize(&game, CHECK_SIZE);
+    for (uint32_t rank = 0; rank < PERMUTATIONS; rank++) {
+        unrankBoard(rank, tiles);
+        for (int cell = 0; cell < CHECK_CELLS; cell++) {
+            wide[cell] = tiles[cell];
+        }
+        putBoard(&game, wide);
+        int isReached = nearest[rank] != UNREACHED;
+        expect(isSolvable(tiles, CHECK_SIZE) == isReached, "isSolvable() of board %u is %d", rank, !isReached);
+        expect(isWon(&game) == (nearest[rank] == 0), "isWon() of board %u is %d", rank, nearest[rank] != 0);
+        if (isReached) {
+            expect(game.manhattanDistance <= nearest[rank], "manhattanDistance %d of board %u is over its distance %d",
+                   game.manhattanDistance, rank, nearest[rank]);
+        }
+        for (int goal = 0; database != NULL && goal < CHECK_CELLS; goal++) {
+            int estimate = patternEstimate(database, tiles, goal);
+            expect(distances[goal][rank] == UNREACHED || estimate <= distances[goal][rank],
+                   "pattern estimate %d of board %u is over its distance %d to goal %d", estimate, rank,
+                   distances[goal][rank], goal);
+        }
+    }
+    tearDown(&game);
+}
+
+/*
+ * Solves sampled boards, every one of them solvable or not, and plays each solution out.
+ */
+void checkSolutions(const uint8_t *nearest, const char *label) {
+    struct solverResult result;
+    uint8_t tiles[CHECK_CELLS];
+    uint64_t state = CHECK_SEED;
+    for (int sample = 0; sample < SOLVER_SAMPLES; sample++) {
+        uint32_t rank = nextCheckRandom(&state) % PERMUTATIONS;
+        unrankBoard(rank, tiles);
+        int isSolved = solveBoard(tiles, CHECK_SIZE, SOLVER_NODE_LIMIT, &result) && result.found;
+        if (nearest[rank] == UNREACHED) {
+            expect(isSolved == 0, "%s: unsolvable board %u was solved", label, rank);
+            continue;
+        }
+        if (expect(isSolved && result.length == nearest[rank], "%s: board %u solved in %d moves, optimal is %d",
+                   label, rank, isSolved ? result.length : -1, nearest[rank]) == 0) {
+            continue;
+        }
+        expect(playMoves(tiles, result.moves, result.length) == result.length && isWonBoard(tiles),
+               "%s: solution of board %u does not win when played", label, rank);
+    }
+}
+
+/*
+ * Deals a board by walking the empty tile at random away from a won board, so it is always solvable.
+ * The walk never steps straight back, which would only undo its last move.
+ * @param board: receives size * size tiles in server form, one byte each.
+ */
+void scrambleBoard(uint8_t *board, int size, int moves, uint64_t *state) {
+    int cellCount = size * size;
+    int empty = cellCount - 1;
+    int previous = -1;
+    for (int cell = 0; cell < empty; cell++) {
+        board[cell] = (cellCount - 1) - cell;
+    }
+    board[empty] = EMPTY_TILE;
+    for (int move = 0; move < moves; move++) {
+        int neighbours[4] = {empty - size, empty + size, (empty % size > 0) ? empty - 1 : -1,
+                             (empty % size < size - 1) ? empty + 1 : -1};
+        int cell = neighbours[nextCheckRandom(state) % 4];
+        if (cell >= 0 && cell < cellCount && cell != previous) {
+            board[empty] = board[cell];
+            board[cell] = EMPTY_TILE;
+            previous = empty;
+            empty = cell;
+        }
+    }
+}
+
+/*
+ * Solves the same boards with one thread and with THREAD_COUNT.
+ */
+void checkThreads() {
+    struct solverResult single;
+    struct solverResult parallel;
+    uint8_t board[THREAD_SIZE * THREAD_SIZE];
+    uint64_t state = CHECK_SEED;
+    for (int sample = 0; sample < THREAD_SAMPLES; sample++) {
+        scrambleBoard(board, THREAD_SIZE, THREAD_SCRAMBLE, &state);
+        setSolverThreads(1);
+        solveBoard(board, THREAD_SIZE, SOLVER_NODE_LIMIT, &single);
+        setSolverThreads(THREAD_COUNT);
+        solveBoard(board, THREAD_SIZE, SOLVER_NODE_LIMIT, &parallel);
+        expect(single.found && parallel.found && single.length == parallel.length,
+               "4x4 board %d solved in %d moves with one thread, %d with %d", sample, single.found ? single.length : -1,
+               parallel.found ? parallel.length : -1, THREAD_COUNT);
+    }
+    setSolverThreads(1);
+}
+
+/*
+ * Follows hints from sampled boards to the win, every one of them after the first must come from the table.
+ */
+void checkHints(const uint8_t *nearest) {
+    struct game game;
+    struct hintReply first;
+    struct hintReply again;
+    uint8_t tiles[CHECK_CELLS];
+    uint32_t wide[CHECK_CELLS];
+    uint64_t state = CHECK_SEED ^ HINT_SAMPLES;
+    memset(&game, 0, sizeof(game));
+    game.isLoadingGame = 1;
+    initialize(&game, CHECK_SIZE);
+    createHintTable(HINT_DEFAULT_ENTRIES);
+    for (int sample = 0; sample < HINT_SAMPLES; sample++) {
+        uint32_t rank = nextCheckRandom(&state) % PERMUTATIONS;
+        unrankBoard(rank, tiles);
+        for (int cell = 0; cell < CHECK_CELLS; cell++) {
+            wide[cell] = tiles[cell];
+        }
+        putBoard(&game, wide);
+        hintGame(&game, &first);
+        hintGame(&game, &again);
+        if (nearest[rank] == UNREACHED) {
+            expect(first.status == 0 && again.status == 0, "hint for unsolvable board %u has status %d", rank,
+                   first.status);
+            continue;
+        }
+        if (expect(first.status == 1 && first.distance == nearest[rank], "hint for board %u is %d moves away, "
+                   "optimal is %d", rank, first.distance, nearest[rank]) == 0) {
+            continue;
+        }
+        expect(again.fromCache && again.tile == first.tile && again.distance == first.distance,
+               "hint for board %u asked again is not the same one from the table", rank);
+        int distance = first.distance;
+        while (distance > 0 && moveTile(&game, first.tile) && --distance > 0) {
+            hintGame(&game, &first);
+            expect(first.fromCache && first.distance == distance, "hint on the way from board %u is %d moves away "
+                   "%s, %d expected", rank, first.distance, first.fromCache ? "from the table" : "solved", distance);
+        }
+        expect(distance == 0 && isWon(&game), "hints from board %u do not win the game", rank);
+    }
+    tearDown(&game);
+}
+
+int main(int argc, char **argv) {
+    uint8_t *distances[CHECK_CELLS];
+    uint8_t *nearest = malloc(PERMUTATIONS);
+    uint32_t *queue = malloc(PERMUTATIONS * sizeof(uint32_t));
+    if (argc > 2 || nearest == NULL || queue == NULL) {
+        fprintf(stderr, "usage: %s [pattern database of size %d]\n", argv[0], CHECK_SIZE);
+        return 1;
+    }
+    memset(nearest, UNREACHED, PERMUTATIONS);
+    for (int goal = 0; goal < CHECK_CELLS; goal++) {
+        distances[goal] = malloc(PERMUTATIONS);
+        if (distances[goal] == NULL) {
+            fprintf(stderr, "not enough memory for the distances\n");
+            return 1;
+        }
+        searchFromGoal(goal, distances[goal], queue);
+        for (uint32_t rank = 0; rank < PERMUTATIONS; rank++) {
+            nearest[rank] = (distances[goal][rank] < nearest[rank]) ? distances[goal][rank] : nearest[rank];
+        }
+    }
+    setSolverThreads(1);
+    checkEveryBoard(distances, nearest, NULL);
+    checkSolutions(nearest, "manhattan");
+    checkThreads();
+    checkHints(nearest);
+    if (argc == 2 && expect(mapPatternDatabase(argv[1]) && patternDatabases[CHECK_SIZE] != NULL,
+                            "pattern database [%s] of size %d does not map", argv[1], CHECK_SIZE)) {
+        checkEveryBoard(distances, nearest, patternDatabases[CHECK_SIZE]);
+        checkSolutions(nearest, "pattern database");
+    }
+    for (int goal = 0; goal < CHECK_CELLS; goal++) {
+        free(distances[goal]);
+    }
+    free(nearest);
+    free(queue);
+    return finishChecks("sp-check-solver");
+}
@@ -0,0 +1,79 @@
+/*
+ * Representing the self checks of "sliding puzzle" game
+ * Uses C99 standard
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include "sp-check.h"
+
+long checksMade = 0;
+long checksFailed = 0;
+
+/*
+ * Counts one check, printing what it was about if it failed.
+ * @param format: printf() style description of the check, with its arguments after it.
+ * @return: isTrue, so a caller can skip what depends on a failed check.
+ */
+int expect(int isTrue, const char *format, ...) {
+    checksMade++;
+    if (isTrue) {
+        return 1;
+    }
+    if (checksFailed++ < CHECK_MAX_REPORTS) {
+        va_list arguments;
+        va_start(arguments, format);
+        printf("  failed: ");
+        vprintf(format, arguments);
+        printf("\n");
+        va_end(arguments);
+    }
+    return 0;
+}
+
+/*
+ * Prints how the checks of a program went.
+ * @return: the program's exit status, 0 if every check passed.
+ */
+int finishChecks(const char *program) {
+    printf("%s: %ld checks, %ld failed\n", program, checksMade, checksFailed);
+    return checksFailed == 0 ? 0 : 1;
+}
+
+/*
+ * xorshift64*, the checks draw their boards and moves from a fixed seed so a failure can be run again.
+ * @param state: never 0.
+ */
+uint64_t nextCheckRandom(uint64_t *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+/*
+ * Puts a whole board on an initialized game of the same size, as a load would.
+ * @param tiles: boardSize * boardSize tiles in row-major order, EMPTY_TILE for the empty tile.
+ */
+void putBoard(struct game *game, const uint32_t *tiles) {
+    for (int cell = 0; cell <= game->maxTileValue; cell++) {
+        setOneTile(game, cell, tiles[cell]);
+    }
+    measureBoard(game);
+}
+
+/*
+ * @return: 1 if both games have the same size and the same tile on every cell.
+ */
+int isSameBoard(const struct game *game, const struct game *other) {
+    if (game->boardSize != other->boardSize || game->emptyIndex != other->emptyIndex) {
+        return 0;
+    }
+    for (int cell = 0; cell <= game->maxTileValue; cell++) {
+        if (tileAt(game, cell) != tileAt(other, cell)) {
+            return 0;
+        }
+    }
+    return 1;
+}
@@ -0,0 +1,27 @@
+/*
+ * Representing the self checks of "sliding puzzle" game
+ * Uses C99 standard
+ * The sp-check-* programs, run by make check, each hold one part of the game against something simpler that is
+ * known to be right. Every check that fails prints a line saying what, and the program then exits with 1.
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#ifndef SP_CHECK_H
+#define SP_CHECK_H
+
+#include <stdint.h>
+#include "sp-engine.h"
+
+#define CHECK_MAX_REPORTS 20//failures printed by one program, the rest are only counted
+
+int expect(int isTrue, const char *format, ...);
+
+int finishChecks(const char *program);
+
+uint64_t nextCheckRandom(uint64_t *state);
+
+void putBoard(struct game *game, const uint32_t *tiles);
+
+int isSameBoard(const struct game *game, const struct game *other);
+
+#endif
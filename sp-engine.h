@@ -0,0 +1,23 @@
+/*
+ * Representing the engine library of "sliding puzzle" game, libspengine.a
+ * Uses C99 standard
+ * Everything a program needs to play, check and solve boards without the game's client or servers.
+ * Nothing in the library keeps state of its own besides read-only tables and the hint cache, which takes no locks,
+ * any number of threads may each work on their own struct game or their own range of a boardSet.
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#ifndef SP_ENGINE_H
+#define SP_ENGINE_H
+
+#include "sp-protocol.h"
+#include "sp-game.h"
+#include "sp-bulk.h"
+#include "sp-solver.h"
+#include "sp-hint.h"
+#include "sp-pdb.h"
+#include "sp-save.h"
+#include "sp-pool.h"
+#include "sp-journal.h"
+
+#endif
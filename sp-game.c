@@ -0,0 +1,646 @@
+/*
+ * Representing the game engine of "sliding puzzle" game
+ * Uses C99 standard
+ * Every function works on the struct game handed to it and nothing else, the pipe server keeps one game
+ * and the socket server one per connection.
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include "sp-game.h"
+#include "sp-journal.h"
+#include "sp-kernel.h"
+#include "sp-pool.h"
+#include "sp-solver.h"
+
+#define TILE_NOT_PLACED UINT32_MAX//widePosition of a tile no setOneTile() has put down yet
+#define PACKED_NOT_PLACED UINT8_MAX//the same in tilePosition, no packed board has that many cells
+#define ROW_SHIFT 42//rowOf() is exact for board indices below 2^20 on boards up to 2^10, MAX_BOARD_SIZE included
+
+const int emptyTileValue = EMPTY_TILE;
+
+static const struct moveKernel anySizeKernel;//boards without a kernel of their own, defined after its functions
+
+/*
+ * Scrambles a value so that inputs differing in a few low bits come out unrelated, the splitmix64 finalizer.
+ */
+uint64_t mixBits(uint64_t value) {
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+}
+
+/*
+ * Next number of this game's generator, xorshift64* seeded once from the clock, the process id and the game's
+ * address, so games started side by side in one process still get different boards.
+ * Seeding once matters: reseeding from the clock every game handed out the same board twice within a second.
+ * @return: 64 uniformly distributed bits.
+ */
+uint64_t nextRandom(struct game *game) {
+    if (game->randomState == 0) {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        uint64_t clock = ((uint64_t) now.tv_sec * 1000000000ULL) + now.tv_nsec;
+        game->randomState = mixBits(mixBits(mixBits(clock) ^ (uint64_t) getpid()) ^ (uint64_t) (uintptr_t) game);
+        game->randomState = (game->randomState == 0) ? 1 : game->randomState;
+    }
+    game->randomState ^= game->randomState >> 12;
+    game->randomState ^= game->randomState << 25;
+    game->randomState ^= game->randomState >> 27;
+    return game->randomState * 0x2545f4914f6cdd1dULL;
+}
+
+/*
+ * Draws an unbiased value below a bound, multiplying into the high half and rejecting the few low halves
+ * that would make some values one draw more likely than others, unlike a plain '% bound'.
+ * @param bound: number of possible values, at least 1.
+ * @return: a value from 0 to bound - 1.
+ */
+uint32_t randomBelow(struct game *game, uint32_t bound) {
+    uint32_t threshold = -bound % bound;
+    uint64_t product;
+    do {
+        product = (nextRandom(game) >> 32) * bound;
+    } while ((uint32_t) product < threshold);
+    return product >> 32;
+}
+
+/*
+ * A tile has two cells it may finish in: maxTileValue - value when the empty tile ends up after it in reading order,
+ * one further on when the empty tile ends up before it. A board is won exactly when every tile sits on one of its
+ * two cells, reading the tiles in order the first one has to be on its earlier cell and the last one on its later
+ * cell, and no tile in between can be on the other one without two tiles sharing a cell.
+ * @return: 1 if tile 'value' at board index 'index' is on neither of its cells.
+ */
+static int isTileMisplaced(const struct game *game, int value, int index) {
+    int goal = game->maxTileValue - value;
+    return index != goal && index != goal + 1;
+}
+
+/*
+ * Row of a board index by multiplying with the reciprocal of the board size, moveTile() would otherwise spend more
+ * time dividing than moving.
+ */
+static int rowOf(const struct game *game, int index) {
+    return (int) (((uint64_t) index * game->rowReciprocal) >> ROW_SHIFT);
+}
+
+/*
+ * Moves tile 'value' at board index 'index' needs, ignoring every other tile, to reach the nearer of its two cells.
+ */
+static int tileDistance(const struct game *game, int value, int index) {
+    int size = game->boardSize;
+    int goal = game->maxTileValue - value;
+    int row = rowOf(game, index);
+    int goalRow = rowOf(game, goal);
+    int laterRow = rowOf(game, goal + 1);
+    int column = index - (row * size);
+    int goalColumn = goal - (goalRow * size);
+    int laterColumn = (goal + 1) - (laterRow * size);
+    int toEarlier = abs(row - goalRow) + abs(column - goalColumn);
+    int toLater = abs(row - laterRow) + abs(column - laterColumn);
+    return (toEarlier < toLater) ? toEarlier : toLater;
+}
+
+/*
+ * Counts misplacedTiles and manhattanDistance from scratch on a board of any size.
+ * Like every function of the any-size kernel it only runs on wide boards, packed sizes all have a kernel.
+ */
+static void measureAnyBoard(struct game *game) {
+    game->misplacedTiles = 0;
+    game->manhattanDistance = 0;
+    for (int value = 1; value <= game->maxTileValue; value++) {
+        game->misplacedTiles += isTileMisplaced(game, value, game->widePosition[value]);
+        game->manhattanDistance += tileDistance(game, value, game->widePosition[value]);
+    }
+}
+
+/*
+ * Counts misplacedTiles and manhattanDistance from scratch, moveTile() keeps them up to date from then on.
+ * Must follow any change of the board that does not go through moveTile(), such as placing tiles with setOneTile().
+ */
+void measureBoard(struct game *game) {
+    game->kernel->measureBoard(game);
+}
+
+/*
+ * Allows for direct access of a single tile on the board, makes for cleaner access when swapping.
+ * Every write to the board goes through here so the position index and empty tile location never go stale.
+ * @param index: the board index of this element to be changed, (i * boardSize) + j for tile i,j.
+ * @param value: this is the value that tile located at index will be changed to.
+ */
+void setOneTile(struct game *game, int index, int value) {
+    if (game->board != NULL) {
+        game->board[index] = (uint8_t) value;
+    } else {
+        game->wideBoard[index] = value;
+    }
+    if (value == emptyTileValue) {
+        game->emptyIndex = index;
+    } else if (game->tilePosition != NULL) {
+        game->tilePosition[value] = (uint8_t) index;
+    } else {
+        game->widePosition[value] = index;
+    }
+}
+
+/*
+ * Tile at a board index whichever way the board is kept, for code off the move path.
+ */
+uint32_t tileAt(const struct game *game, int index) {
+    return (game->board != NULL) ? game->board[index] : game->wideBoard[index];
+}
+
+/*
+ * Copies tiles of the board out as they go on the wire, TILE_WIDTH() bytes each, see sp-protocol.h.
+ * @param first: board index of the first tile.
+ * @param buffer: room for count tiles.
+ * @return: bytes written to buffer.
+ */
+size_t copyTiles(const struct game *game, int first, int count, uint8_t *buffer) {
+    if (game->board != NULL) {
+        memcpy(buffer, game->board + first, count);
+        return count;
+    }
+    memcpy(buffer, game->wideBoard + first, (size_t) count * sizeof(uint32_t));
+    return (size_t) count * sizeof(uint32_t);
+}
+
+/*
+ * Writes a tile without touching the position index, for shuffling a board that setOneTile() then goes over.
+ */
+static void putTile(struct game *game, int index, uint32_t value) {
+    if (game->board != NULL) {
+        game->board[index] = (uint8_t) value;
+    } else {
+        game->wideBoard[index] = value;
+    }
+}
+
+/*
+ * Puts a tile down on a board being filled from outside, such as a loaded one, refusing anything that would leave
+ * the board with a tile twice, two empty tiles or a tile that does not exist.
+ * @return: 1 if the tile was placed, 0 if the board would no longer be a valid one.
+ */
+int placeTile(struct game *game, int index, int value) {
+    if (value < 0 || value > game->maxTileValue) {
+        return 0;
+    }
+    int isPlaced = (game->tilePosition != NULL) ? game->tilePosition[value] != PACKED_NOT_PLACED
+                                                : game->widePosition[value] != TILE_NOT_PLACED;
+    if ((value == emptyTileValue) ? game->emptyIndex != -1 : isPlaced) {
+        return 0;
+    }
+    setOneTile(game, index, value);
+    return 1;
+}
+
+/*
+ * Randomly assigns appropriate values to a game board scaled by the game's 'boardSize', in a single
+ * Fisher-Yates pass: every index from the last down swaps with a random index at or below it, which deals
+ * each arrangement with the same chance and never draws a tile twice.
+ * Half of all arrangements of an odd sized board cannot be won, see isSolvable(). Swapping two tiles flips that,
+ * so an unwinnable deal gets the tiles of its first two cells other than the empty one swapped, which pairs each
+ * unwinnable board with exactly one winnable board and keeps the deal uniform over the winnable ones.
+ * Even sized boards are always winnable and are never touched.
+ * isSolvable() counts inversions pair by pair, which would take hours on the largest boards. Every swap of two
+ * different cells flips the parity of the whole arrangement instead, and the empty tile, the lowest value, adds an
+ * inversion with each tile before it, so counting the swaps gives the same answer for free.
+ */
+void setAllTiles(struct game *game) {
+    int cellCount = game->boardSize * game->boardSize;
+    long swaps = 0;
+    for (int index = 0; index < cellCount; index++) {
+        putTile(game, index, index);//the empty tile is 0, EMPTY_TILE
+    }
+    for (int index = cellCount - 1; index > 0; index--) {
+        int other = randomBelow(game, index + 1);
+        uint32_t value = tileAt(game, index);
+        putTile(game, index, tileAt(game, other));
+        putTile(game, other, value);
+        swaps += (other != index);
+    }
+    int emptyIndex = 0;
+    while (tileAt(game, emptyIndex) != (uint32_t) emptyTileValue) {
+        emptyIndex++;
+    }
+    long long maxTileValue = game->maxTileValue;
+    long long goalInversions = (maxTileValue * (maxTileValue - 1)) / 2;//descending order inverts every pair
+    if (game->boardSize % 2 == 1 && (swaps + emptyIndex) % 2 != goalInversions % 2) {
+        int first = (emptyIndex == 0) ? 1 : 0;
+        int second = (emptyIndex == 1 || first == 1) ? 2 : 1;
+        uint32_t value = tileAt(game, first);
+        putTile(game, first, tileAt(game, second));
+        putTile(game, second, value);
+    }
+    for (int index = 0; index < cellCount; index++) {
+        setOneTile(game, index, tileAt(game, index));
+    }
+    measureBoard(game);
+}
+
+/*
+ * Sets and scales dimensions for the board in relation to a newSize passed in.
+ * Necessary to allow all other functions to operate with the scale of this new size.
+ * The change log remembers as many moves as the board has cells, rounded up to a power of two and at most
+ * CHANGE_LOG_MOVES, more moves than that change about as many cells as sending the whole board would.
+ * @param newSize: this is the size of the new board that all values will be set in relation to.
+ */
+void setBoardSizeAndValues(struct game *game, int newSize) {
+    game->boardSize = newSize;
+    game->maxTileValue = (game->boardSize * game->boardSize) - 1;
+    game->rowReciprocal = ((1ULL << ROW_SHIFT) / newSize) + 1;
+    game->kernel = (selectKernel(newSize) != NULL) ? selectKernel(newSize) : &anySizeKernel;
+    game->changeLogMask = 1;
+    while (game->changeLogMask < (uint32_t) game->maxTileValue && game->changeLogMask < CHANGE_LOG_MOVES - 1) {
+        game->changeLogMask = (game->changeLogMask << 1) | 1;
+    }
+}
+
+/*
+ * Frees all memory of the current board, the tiles and the position index that mirrors them.
+ */
+void freeBoardMemory(struct game *game) {
+    free(game->board);
+    free(game->tilePosition);
+    free(game->wideBoard);
+    free(game->widePosition);
+    free(game->changeLog);
+    game->board = NULL;
+    game->tilePosition = NULL;
+    game->wideBoard = NULL;
+    game->widePosition = NULL;
+    game->changeLog = NULL;
+}
+
+/*
+ * Ends the current game, informs the user.
+ * Must call freeBoardMemory() in order to free up dynamically allocated memory allotted to the game we are ending.
+ */
+void tearDown(struct game *game) {
+    freeBoardMemory(game);
+}
+
+/*
+ * Dynamically allocates memory for a board in relation to the game's 'boardSize'.
+ * Must be dynamically allocated to scale in demand of unknown board sizes.
+ * The tiles live in a single block so walking the board is one linear pass, one byte each up to
+ * MAX_PACKED_BOARD_SIZE and one uint32_t each above, the other pair of pointers stays NULL. The position index
+ * gets one slot per tile value, every slot starts at PACKED_NOT_PLACED or TILE_NOT_PLACED.
+ * The change log goes with them, as many moves as setBoardSizeAndValues() sized it for.
+ * Every pointer is set here, a game copied from another one never shares its memory.
+ * @return: 1 on success, 0 if there is not enough memory for the board, the game is then left without one.
+ */
+int allocateMemory(struct game *game) {
+    int cellCount = game->maxTileValue + 1;
+    int isPacked = TILE_WIDTH(game->boardSize) == 1;
+    game->board = isPacked ? (uint8_t *) calloc(cellCount, 1) : NULL;
+    game->tilePosition = isPacked ? (uint8_t *) malloc(cellCount) : NULL;
+    game->wideBoard = isPacked ? NULL : (uint32_t *) calloc(cellCount, sizeof(uint32_t));
+    game->widePosition = isPacked ? NULL : (uint32_t *) malloc(cellCount * sizeof(uint32_t));
+    game->changeLog = (uint32_t *) malloc(2 * (game->changeLogMask + 1) * sizeof(uint32_t));
+    if ((isPacked ? game->board == NULL || game->tilePosition == NULL
+                  : game->wideBoard == NULL || game->widePosition == NULL) || game->changeLog == NULL) {
+        freeBoardMemory(game);
+        return 0;
+    }
+    if (isPacked) {
+        memset(game->tilePosition, PACKED_NOT_PLACED, cellCount);
+    }
+    for (int value = 0; isPacked == 0 && value < cellCount; value++) {
+        game->widePosition[value] = TILE_NOT_PLACED;
+    }
+    game->emptyIndex = -1;
+    return 1;
+}
+
+/*
+ * Starts a new game of size specified by input param.
+ * Reject boards greater than MAX_BOARD_SIZE, or less than MIN_BOARD_SIZE.
+ * Frees up previously allocated memory if applicable, and offers a different prompt whether call is for:
+ *  -The first game played for this session
+ *  -New game being created
+ *  -Loading an existing game
+ * The game's board dimensions are established in relation to this new board, memory is allocated,
+ * and appropriate values are assigned whether loading or randomizing a new game.
+ * Decisions made within the function allow reuse of the same initialization() function in all applicable situations.
+ * A board too big for the memory left is turned down like a bad size, the game in progress goes on.
+ * A size with a puzzle pool mapped gets its board from the pool instead of a random deal, see sp-pool.h.
+ * @param sizeOfNewBoard: this is the size of the new board that all above operations will be in relation to.
+ */
+int initialize(struct game *game, int sizeOfNewBoard) {
+    if (sizeOfNewBoard > MAX_BOARD_SIZE || sizeOfNewBoard < MIN_BOARD_SIZE) {
+        return 0;
+    }
+    struct game fresh = *game;
+    setBoardSizeAndValues(&fresh, sizeOfNewBoard);
+    if (allocateMemory(&fresh) == 0) {
+        game->isLoadingGame = 0;
+        return 0;
+    }
+    tearDown(game);
+    *game = fresh;
+    if (game->isLoadingGame != 1 && dealPooledBoard(game) == 0) {
+        setAllTiles(game);
+    }
+    game->isLoadingGame = 0;
+    game->moveCount = 0;
+    game->boardVersion = 0;
+    game->gamesPlayed++;
+    return 1;
+}
+
+/*
+ * Takes over the board of another game, which is left with none, and counts it as a new game.
+ * Lets a board be built up aside, as a load does, and only replace the one in progress once it is known to be good.
+ * @param source: a game with a complete board, its move count comes along.
+ */
+void adoptBoard(struct game *game, struct game *source) {
+    tearDown(game);
+    game->board = source->board;
+    game->tilePosition = source->tilePosition;
+    game->wideBoard = source->wideBoard;
+    game->widePosition = source->widePosition;
+    game->changeLog = source->changeLog;
+    game->emptyIndex = source->emptyIndex;
+    setBoardSizeAndValues(game, source->boardSize);
+    game->moveCount = source->moveCount;
+    game->misplacedTiles = source->misplacedTiles;
+    game->manhattanDistance = source->manhattanDistance;
+    game->boardVersion = 0;
+    game->gamesPlayed++;
+    source->board = NULL;
+    source->tilePosition = NULL;
+    source->wideBoard = NULL;
+    source->widePosition = NULL;
+    source->changeLog = NULL;
+}
+
+/*
+ * Evaluates if a given tile can be moved based its location in relation to the empty tile.
+ * Limits possible tiles to evaluate based on the tile values currently present on the board.
+ * The tile and the empty tile are located through 'widePosition' and 'emptyIndex' in constant time,
+ * their board indices are split back into i and j values as movement is determined by the tile position.
+ * Only need two checks: up/down and left/right, this is more efficient than checking all 4 directions separately.
+ * Does not follow a typical cartesian plane, but the i and j could be understood as x and y if that aids in reading:
+ *  - i = y coordinate
+ *  - j = x coordinate
+ * @param tileToCheck: this value will be located if on the board, and checked if it is located next to the empty tile.
+ * @return: 1 if the tile to check is eligible to move, 0 if the move is not valid.
+ */
+static int isMoveValidOnAnyBoard(const struct game *game, int tileToCheck) {
+    int valid = 0;
+    if (tileToCheck < 1 || tileToCheck > game->maxTileValue) {
+        return valid;
+    } else {
+        int tileToMoveI = game->widePosition[tileToCheck] / game->boardSize;
+        int tileToMoveJ = game->widePosition[tileToCheck] % game->boardSize;
+        int emptyTileI = game->emptyIndex / game->boardSize;
+        int emptyTileJ = game->emptyIndex % game->boardSize;
+        if ((tileToMoveI == (emptyTileI + 1) || tileToMoveI == (emptyTileI - 1)) &&
+            emptyTileJ == tileToMoveJ) {//Tile is above or below
+            valid = 1;
+            return valid;
+        }
+        if ((tileToMoveJ == (emptyTileJ + 1) || tileToMoveJ == (emptyTileJ - 1)) &&
+            emptyTileI == tileToMoveI) {//Tile is left or right
+            valid = 1;
+            return valid;
+        } else {
+            valid = 0;
+            return valid;
+        }
+    }
+}
+
+/*
+ * Prompts for a tile to move
+ * Must make use of isMoveValid() to determine whether to perform a swap, no internal evaluation.
+ * Rejects bad moves and continues game, performs valid moves by swapping the tile values.
+ * Relies on setOneTile() for the actual swap as there is no internal swapping functionality.
+ * No explicit need for a success flag 'wasMoved', but one is included for future iterations/versions.
+ * Only the moved tile changes cell, so misplacedTiles and manhattanDistance are updated from that tile alone,
+ * and the two cells go into the change log.
+ * @return: 1 on success, 0 on a rejected move.
+ */
+static int moveTileOnAnyBoard(struct game *game, int desiredValue) {
+    int wasMoved = 0;
+    if (isMoveValidOnAnyBoard(game, desiredValue)) {
+        int tileIndex = game->widePosition[desiredValue];
+        game->misplacedTiles += isTileMisplaced(game, desiredValue, game->emptyIndex)
+                                - isTileMisplaced(game, desiredValue, tileIndex);
+        game->manhattanDistance += tileDistance(game, desiredValue, game->emptyIndex)
+                                   - tileDistance(game, desiredValue, tileIndex);
+        if (game->journal != NULL) {
+            int offset = tileIndex - game->emptyIndex;
+            int direction = (offset == game->boardSize) ? 0 : (offset == -game->boardSize) ? 1 : (offset == 1) ? 2 : 3;
+            journalMove(game->journal, direction);//counted from moveUp, see sp-journal.h
+        }
+        uint32_t *logged = game->changeLog + (2 * (game->boardVersion & game->changeLogMask));
+        logged[0] = game->emptyIndex;
+        logged[1] = tileIndex;
+        game->boardVersion++;
+        setOneTile(game, game->emptyIndex, desiredValue);
+        setOneTile(game, tileIndex, emptyTileValue);
+        game->moveCount++;
+        wasMoved = 1;
+        return wasMoved;
+    } else {
+        return wasMoved;
+    }
+}
+
+/*
+ * Whether a tile sits next to the empty tile, see the kernel of the board's size or isMoveValidOnAnyBoard().
+ * @return: 1 if the tile to check is eligible to move, 0 if the move is not valid.
+ */
+int isMoveValid(const struct game *game, int tileToCheck) {
+    return game->kernel->isMoveValid(game, tileToCheck);
+}
+
+/*
+ * Slides a tile into the empty tile if it may, see the kernel of the board's size or moveTileOnAnyBoard().
+ * @return: 1 on success, 0 on a rejected move.
+ */
+int moveTile(struct game *game, int desiredValue) {
+    return game->kernel->moveTile(game, desiredValue);
+}
+
+/*
+ * Starts with index of 0,0 and walks board in appropriate order.
+ * As long as next tile is one greater than current.
+ * or next tile is the empty tile, game is won.
+ * Put differently, every tile is on one of its two cells, see isTileMisplaced(), and moveTile() keeps count of the
+ * tiles that are not, so there is nothing left to walk.
+ * @return: 1 on a winning board, else return 0.
+ */
+int isWon(const struct game *game) {
+    return game->misplacedTiles == 0;
+}
+
+/*
+ * Cells changed by the moves made since a given board version, which the server can send in place of the board.
+ * @param version: a boardVersion of this same board, no later than the current one.
+ * @param cells: room for 2 * CHANGE_LOG_MOVES board indices, receives two per move, oldest move first.
+ * @return: number of cells, -1 if the moves since 'version' are more than the change log remembers.
+ */
+int changedCells(const struct game *game, uint64_t version, uint32_t *cells) {
+    if (version > game->boardVersion || game->boardVersion - version > game->changeLogMask + 1) {
+        return -1;
+    }
+    int count = 0;
+    for (uint64_t moveNumber = version; moveNumber < game->boardVersion; moveNumber++) {
+        const uint32_t *logged = game->changeLog + (2 * (moveNumber & game->changeLogMask));
+        cells[count++] = logged[0];
+        cells[count++] = logged[1];
+    }
+    return count;
+}
+
+/*
+ * A 64 bit hash of a packed board's tiles, for telling boards apart or keying tables by them.
+ * Boards up to 4x4 are first packed 4 bits per tile into a single word, since the mix below is a bijection
+ * no two such boards ever share a hash. Larger boards are mixed in 8 tile words.
+ * @param tiles: one byte per tile, the empty tile as EMPTY_TILE.
+ * @param cellCount: number of tiles including the empty tile.
+ */
+uint64_t hashTiles(const uint8_t *tiles, int cellCount) {
+    uint64_t hash = 0;
+    if (cellCount <= 16) {
+        for (int cell = 0; cell < cellCount; cell++) {
+            hash |= (uint64_t) tiles[cell] << (4 * cell);
+        }
+        return mixBits(hash);
+    }
+    hash = cellCount;
+    for (int cell = 0; cell < cellCount; cell += 8) {
+        uint64_t word = 0;
+        memcpy(&word, tiles + cell, (cellCount - cell < 8) ? cellCount - cell : 8);
+        hash = mixBits(hash ^ word);
+    }
+    return hash;
+}
+
+/*
+ * Hash of the game's board, see hashTiles(), a wide board is mixed two tiles to a word.
+ */
+uint64_t boardHash(const struct game *game) {
+    int cellCount = game->boardSize * game->boardSize;
+    if (game->board != NULL) {
+        return hashTiles(game->board, cellCount);
+    }
+    uint64_t hash = cellCount;
+    for (int cell = 0; cell < cellCount; cell += 2) {
+        uint64_t word = game->wideBoard[cell];
+        word |= (cell + 1 < cellCount) ? (uint64_t) game->wideBoard[cell + 1] << 32 : 0;
+        hash = mixBits(hash ^ word);
+    }
+    return hash;
+}
+
+/*
+ * Describes the current board for a snapshot, the tiles follow it straight from the board, see copyTiles().
+ * The header announces the whole board, a print that only sends the changed cells sets 'changes' itself.
+ * @param header: filled in.
+ */
+void fillSnapshotHeader(const struct game *game, struct snapshotHeader *header) {
+    header->boardSize = game->boardSize;
+    header->version = SNAPSHOT_VERSION;
+    header->emptyIndex = game->emptyIndex;
+    header->moveCount = game->moveCount;
+    header->misplacedTiles = game->misplacedTiles;
+    header->manhattanDistance = game->manhattanDistance;
+    header->game = game->gamesPlayed;
+    header->changes = -1;
+    header->boardVersion = game->boardVersion;
+}
+
+/*
+ * Translates one batch entry into the tile value it refers to.
+ * Tile values pass through untouched, a direction names the neighbour of the empty tile that would slide that way,
+ * so moveUp is the tile just below the empty tile, moveLeft the tile just to its right, and so on.
+ * @param entry: a tile value or one of enum moveDirection.
+ * @return: the tile value to move, 0 if the direction points off the board or the entry is nonsense.
+ */
+static int resolveMoveOnAnyBoard(const struct game *game, int entry) {
+    int emptyTileI = game->emptyIndex / game->boardSize;
+    int emptyTileJ = game->emptyIndex % game->boardSize;
+    if (entry > 0) {
+        return entry;
+    } else if (entry == moveUp && emptyTileI < game->boardSize - 1) {
+        return game->wideBoard[game->emptyIndex + game->boardSize];
+    } else if (entry == moveDown && emptyTileI > 0) {
+        return game->wideBoard[game->emptyIndex - game->boardSize];
+    } else if (entry == moveLeft && emptyTileJ < game->boardSize - 1) {
+        return game->wideBoard[game->emptyIndex + 1];
+    } else if (entry == moveRight && emptyTileJ > 0) {
+        return game->wideBoard[game->emptyIndex - 1];
+    }
+    return 0;
+}
+
+static const struct moveKernel anySizeKernel = {isMoveValidOnAnyBoard, moveTileOnAnyBoard, resolveMoveOnAnyBoard,
+                                                measureAnyBoard};
+
+/*
+ * Translates one batch entry into the tile value it refers to, see resolveMoveOnAnyBoard().
+ */
+int resolveMove(const struct game *game, int entry) {
+    return game->kernel->resolveMove(game, entry);
+}
+
+/*
+ * Applies a whole move sequence through moveTile(), in order.
+ * Rejected moves are skipped and the rest of the sequence carries on, mirroring what typing them one by one would do.
+ * Stops right after a move that wins the game, so the board handed back is the winning one.
+ * @param moves: tile values or directions, see resolveMove().
+ * @param count: number of entries in moves, at most MAX_BATCH_MOVES.
+ * @param reply: receives which moves were applied, how many entries were looked at and the final won state.
+ */
+void moveTiles(struct game *game, const int32_t *moves, int count, struct batchMoveReply *reply) {
+    const struct moveKernel *kernel = game->kernel;
+    reply->processed = 0;
+    reply->isWon = 0;
+    for (int i = 0; i < MAX_BATCH_MOVES / 8; i++) {
+        reply->movedBitmap[i] = 0;
+    }
+    for (int i = 0; i < count && reply->isWon == 0; i++) {
+        if (kernel->moveTile(game, kernel->resolveMove(game, moves[i]))) {
+            reply->movedBitmap[i / 8] |= (uint8_t) (1 << (i % 8));
+            reply->isWon = isWon(game);
+        }
+        reply->processed++;
+    }
+}
+
+/*
+ * Runs the optimal solver on the board in progress, the board itself is not changed.
+ * The solver takes the packed board as it is, a wide board is given up on right away, no search would come
+ * back from one.
+ * @param reply: receives the outcome, the moves that win the game and how hard the search had to work.
+ */
+void solveGame(const struct game *game, struct solveReply *reply) {
+    struct solverResult result;
+    memset(reply, 0, sizeof(*reply));
+    reply->status = -1;
+    if (game->board == NULL) {
+        return;
+    }
+    solveBoard(game->board, game->boardSize, SOLVER_NODE_LIMIT, &result);
+    if (result.found == 1) {
+        reply->status = 1;
+    } else {
+        reply->status = isSolvable(game->board, game->boardSize) ? -1 : 0;
+    }
+    reply->length = result.length;
+    reply->nodesExpanded = result.nodesExpanded;
+    reply->nodesPerSecond = (result.seconds > 0) ? (int64_t) (result.nodesExpanded / result.seconds) : 0;
+    reply->elapsedMicros = (int64_t) (result.seconds * 1e6);
+    for (int i = 0; i < result.length; i++) {
+        reply->moves[i] = result.moves[i];
+    }
+}
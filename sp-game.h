@@ -0,0 +1,97 @@
+/*
+ * Representing the game engine of "sliding puzzle" game
+ * Uses C99 standard
+ * Everything one game needs lives in a struct game, so a process can keep as many games as it has players.
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#ifndef SP_GAME_H
+#define SP_GAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sp-protocol.h"
+
+#define DEFAULT_BOARD_SIZE 4
+#define CHANGE_LOG_MOVES 512//most moves whose cells a change log remembers, a power of two
+
+extern const int emptyTileValue;
+
+struct journal;
+
+struct moveKernel;
+
+/*
+ * One game in progress, zero it before the first initialize().
+ * Boards up to MAX_PACKED_BOARD_SIZE keep one byte per tile in 'board' and 'tilePosition', the boards people play
+ * and the ones the solver and the per-size kernels work on. Larger boards keep a uint32_t per tile in 'wideBoard'
+ * and 'widePosition' instead, exactly one of the two pairs is in use, see TILE_WIDTH(). Either way memory goes with
+ * the area of the board and a change log of at most two uint32_t per cell, and a move costs the same on any size.
+ */
+struct game {
+    uint8_t *board;//one contiguous row-major buffer, tile i,j lives at board[(i * boardSize) + j], NULL on wide boards
+    uint8_t *tilePosition;//tilePosition[value] is the board index holding tile 'value', kept in sync by setOneTile()
+    uint32_t *wideBoard;//the same for boards above MAX_PACKED_BOARD_SIZE, NULL on packed ones
+    uint32_t *widePosition;
+    int emptyIndex;//board index of the empty tile, tracked the same way so it never has to be searched for
+    int boardSize;
+    int maxTileValue;
+    uint64_t rowReciprocal;//2^ROW_SHIFT / boardSize rounded up, see rowOf()
+    const struct moveKernel *kernel;//move hot path made for this board size, see sp-kernel.h
+    int gamesPlayed;
+    int moveCount;//successful moves in the game in progress, reported with every snapshot
+    int misplacedTiles;//tiles on neither of their winning cells, 0 exactly when the game is won, see measureBoard()
+    int manhattanDistance;//sum over the tiles of the moves to their nearer winning cell, the distance to solved
+    int isLoadingGame;
+    uint64_t randomState;//xorshift state of this game, seeded on first use, never 0 afterwards
+    struct journal *journal;//records every move for undo, redo and recovery, NULL if the game keeps no journal
+    uint64_t boardVersion;//moves made since the board was dealt or loaded, undo and redo included, see changedCells()
+    uint32_t *changeLog;//the two cells each of the last changeLogMask + 1 moves changed, allocated with the board
+    uint32_t changeLogMask;//moves the change log remembers less one, see setBoardSizeAndValues()
+};
+
+uint64_t mixBits(uint64_t value);
+
+uint64_t nextRandom(struct game *game);
+
+uint32_t randomBelow(struct game *game, uint32_t bound);
+
+void setOneTile(struct game *game, int index, int value);
+
+int placeTile(struct game *game, int index, int value);
+
+void setAllTiles(struct game *game);
+
+void measureBoard(struct game *game);
+
+void tearDown(struct game *game);
+
+int initialize(struct game *game, int sizeOfNewBoard);
+
+void adoptBoard(struct game *game, struct game *source);
+
+int isMoveValid(const struct game *game, int tileToCheck);
+
+int moveTile(struct game *game, int desiredValue);
+
+int isWon(const struct game *game);
+
+int changedCells(const struct game *game, uint64_t version, uint32_t *cells);
+
+uint32_t tileAt(const struct game *game, int index);
+
+size_t copyTiles(const struct game *game, int first, int count, uint8_t *buffer);
+
+uint64_t hashTiles(const uint8_t *tiles, int cellCount);
+
+uint64_t boardHash(const struct game *game);
+
+void fillSnapshotHeader(const struct game *game, struct snapshotHeader *header);
+
+int resolveMove(const struct game *game, int entry);
+
+void moveTiles(struct game *game, const int32_t *moves, int count, struct batchMoveReply *reply);
+
+void solveGame(const struct game *game, struct solveReply *reply);
+
+#endif
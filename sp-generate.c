@@ -0,0 +1,269 @@
+/*
+ * Representing the puzzle generator of "sliding puzzle" game
+ * Uses C99 standard
+ * Usage: sp-generate [-j threads] [-z seed] [-n node limit] <board size> <count> <min>-<max> <archive>
+ * Makes 'count' boards whose optimal solutions take from min to max moves and writes them to an archive, a pool
+ * the servers deal new games from when it is named sp-pool-<size>.spar in SP_POOL_DIR, see sp-pool.h.
+ * A board starts from a won one with a target length drawn from the band, takes a random walk that never steps
+ * straight back, and goes to the solver. Short of the target, it walks on for the moves it is missing and is solved
+ * again, past the band or too hard for the node limit, it is thrown away and the next attempt starts over.
+ * Every board has a generator of its own, seeded from the seed and its position in the archive, so a seed gives the
+ * same archive on any number of threads.
+ * Workers take the next board to make in turn and the main thread writes them in order, holding at most
+ * GENERATE_WINDOW boards per worker that are made but not yet written.
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "sp-engine.h"
+
+#define GENERATE_MAX_THREADS 256
+#define GENERATE_WINDOW 16
+#define GENERATE_NODE_LIMIT 20000000ULL
+#define GENERATE_MAX_ATTEMPTS 100000//per board, a band this many attempts never hit is taken to be out of reach
+#define DEFAULT_GENERATE_SEED 1ULL
+
+/*
+ * One board made and waiting for its turn to be written.
+ */
+struct generatedBoard {
+    int isReady;
+    int length;//of its optimal solution
+    uint8_t record[sizeof(struct saveHeader) + (MAX_PACKED_BOARD_SIZE * MAX_PACKED_BOARD_SIZE)];
+};
+
+/*
+ * Board n is made into slots[n % slotCount], once the writer is past board n - slotCount.
+ */
+struct generator {
+    pthread_mutex_t lock;//guards the counters and every slot's isReady
+    pthread_cond_t made;
+    pthread_cond_t written;
+    struct generatedBoard *slots;
+    uint64_t slotCount;
+    uint64_t count;
+    uint64_t claimed;
+    uint64_t writtenCount;
+    int isAborted;//a board ran out of attempts
+    int size;
+    int minLength;
+    int maxLength;
+    uint64_t seed;
+    uint64_t nodeLimit;
+    uint64_t attempts;
+    uint64_t solves;
+};
+
+/*
+ * A won board, the tiles in descending order and the empty tile in the last cell.
+ */
+void setWonBoard(struct game *game) {
+    for (int cell = 0; cell <= game->maxTileValue; cell++) {
+        setOneTile(game, cell, game->maxTileValue - cell);
+    }
+    measureBoard(game);
+}
+
+/*
+ * Moves the empty tile 'steps' times at random, never straight back to where it just was.
+ * @param lastTile: the tile moved last, 0 if none, updated.
+ */
+void walkBoard(struct game *game, int steps, int *lastTile) {
+    while (steps > 0) {
+        int tile = resolveMove(game, moveUp - (int) (nextRandom(game) >> 62));
+        if (tile != 0 && tile != *lastTile && moveTile(game, tile)) {
+            *lastTile = tile;
+            steps--;
+        }
+    }
+}
+
+/*
+ * Optimal solution length of the game's board.
+ * @return: the length, -1 if the search gave up.
+ */
+int solvedLength(const struct game *game, uint64_t nodeLimit) {
+    struct solverResult result;
+    return solveBoard(game->board, game->boardSize, nodeLimit, &result) ? result.length : -1;
+}
+
+/*
+ * Makes board 'index' of the archive.
+ * @param solves: receives the number of times the solver ran.
+ * @return: attempts it took, 0 if it ran out of them.
+ */
+uint64_t makeBoard(struct generator *generator, struct game *game, uint64_t index, struct generatedBoard *board,
+                   uint64_t *solves) {
+    game->randomState = mixBits(generator->seed ^ mixBits(index + 1));
+    game->randomState = (game->randomState == 0) ? 1 : game->randomState;
+    *solves = 0;
+    for (uint64_t attempt = 1; attempt <= GENERATE_MAX_ATTEMPTS; attempt++) {
+        int target = generator->minLength + (int) randomBelow(game, generator->maxLength - generator->minLength + 1);
+        int lastTile = 0;
+        int length = 0;
+        int walked = 0;
+        setWonBoard(game);
+        while (length < target && walked <= 4 * generator->maxLength) {
+            walkBoard(game, target - length, &lastTile);
+            walked += target - length;
+            length = solvedLength(game, generator->nodeLimit);
+            (*solves)++;
+            if (length == -1) {
+                break;
+            }
+        }
+        if (length >= generator->minLength && length <= generator->maxLength) {
+            game->moveCount = 0;
+            board->length = length;
+            packGame(game, board->record);
+            return attempt;
+        }
+    }
+    return 0;
+}
+
+void *generateBoards(void *argument) {
+    struct generator *generator = argument;
+    struct game game;
+    memset(&game, 0, sizeof(game));
+    game.isLoadingGame = 1;//the board is set up by hand, never dealt or drawn from a pool
+    if (initialize(&game, generator->size) == 0) {
+        pthread_mutex_lock(&generator->lock);
+        generator->isAborted = 1;
+        pthread_cond_broadcast(&generator->made);
+        pthread_mutex_unlock(&generator->lock);
+        return NULL;
+    }
+    pthread_mutex_lock(&generator->lock);
+    while (generator->isAborted == 0 && generator->claimed < generator->count) {
+        if (generator->claimed - generator->writtenCount == generator->slotCount) {
+            pthread_cond_wait(&generator->written, &generator->lock);
+            continue;
+        }
+        uint64_t index = generator->claimed++;
+        struct generatedBoard *board = &generator->slots[index % generator->slotCount];
+        pthread_mutex_unlock(&generator->lock);
+        uint64_t solves;
+        uint64_t attempts = makeBoard(generator, &game, index, board, &solves);
+        pthread_mutex_lock(&generator->lock);
+        generator->attempts += attempts;
+        generator->solves += solves;
+        generator->isAborted |= (attempts == 0);
+        board->isReady = 1;
+        pthread_cond_broadcast(&generator->made);
+    }
+    pthread_mutex_unlock(&generator->lock);
+    tearDown(&game);
+    return NULL;
+}
+
+/*
+ * The writer, run on the main thread: appends the boards in order as each is made.
+ * @param histogram: counts the boards written by their solution length.
+ * @return: 1 if every board was written, 0 if a write failed or the generator gave up.
+ */
+int writeBoards(struct generator *generator, struct archiveWriter *writer, uint64_t *histogram) {
+    uint64_t recordBytes = recordLength(generator->size);
+    pthread_mutex_lock(&generator->lock);
+    while (generator->writtenCount < generator->count && generator->isAborted == 0) {
+        struct generatedBoard *board = &generator->slots[generator->writtenCount % generator->slotCount];
+        if (board->isReady == 0) {
+            pthread_cond_wait(&generator->made, &generator->lock);
+            continue;
+        }
+        pthread_mutex_unlock(&generator->lock);
+        int wasAppended = appendRecord(writer, board->record, recordBytes);
+        histogram[board->length]++;
+        pthread_mutex_lock(&generator->lock);
+        board->isReady = 0;
+        generator->writtenCount++;
+        generator->isAborted |= (wasAppended == 0);
+        pthread_cond_broadcast(&generator->written);
+    }
+    int wasSuccessful = generator->writtenCount == generator->count;
+    generator->isAborted = 1;//wakes and stops any worker still waiting for room
+    pthread_cond_broadcast(&generator->written);
+    pthread_mutex_unlock(&generator->lock);
+    return wasSuccessful;
+}
+
+int main(int argc, char **argv) {
+    struct generator generator;
+    struct archiveWriter writer;
+    uint64_t histogram[SOLVER_MAX_MOVES + 1] = {0};
+    int threadCount = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    int option;
+    memset(&generator, 0, sizeof(generator));
+    generator.seed = DEFAULT_GENERATE_SEED;
+    generator.nodeLimit = GENERATE_NODE_LIMIT;
+    while ((option = getopt(argc, argv, "j:z:n:")) != -1) {
+        if (option == 'j') {
+            threadCount = atoi(optarg);
+        } else if (option == 'z') {
+            generator.seed = strtoull(optarg, NULL, 10);
+        } else if (option == 'n') {
+            generator.nodeLimit = strtoull(optarg, NULL, 10);
+        } else {
+            threadCount = 0;
+        }
+    }
+    if (argc - optind == 4) {
+        generator.size = atoi(argv[optind]);
+        generator.count = strtoull(argv[optind + 1], NULL, 10);
+        if (sscanf(argv[optind + 2], "%d-%d", &generator.minLength, &generator.maxLength) != 2) {
+            generator.minLength = 0;
+        }
+    }
+    if (threadCount < 1 || threadCount > GENERATE_MAX_THREADS || generator.size < MIN_BOARD_SIZE
+        || generator.size > MAX_PACKED_BOARD_SIZE || generator.count == 0 || generator.minLength < 1
+        || generator.maxLength < generator.minLength || generator.maxLength > SOLVER_MAX_MOVES
+        || generator.nodeLimit == 0) {
+        fprintf(stderr, "usage: %s [-j threads, 1..%d] [-z seed] [-n solver node limit] <board size, %d..%d> "
+                        "<count> <min>-<max solution moves, 1..%d> <archive>\n", argv[0], GENERATE_MAX_THREADS,
+                MIN_BOARD_SIZE, MAX_PACKED_BOARD_SIZE, SOLVER_MAX_MOVES);
+        return 1;
+    }
+    if (createArchive(&writer, argv[optind + 3]) == 0) {
+        perror("cannot create archive");
+        return 1;
+    }
+    mapPatternDatabases();
+    setSolverThreads(1);//the boards already keep every core busy
+    generator.slotCount = (uint64_t) threadCount * GENERATE_WINDOW;
+    generator.slots = calloc(generator.slotCount, sizeof(struct generatedBoard));
+    pthread_t *threads = calloc(threadCount, sizeof(pthread_t));
+    if (generator.slots == NULL || threads == NULL) {
+        fprintf(stderr, "not enough memory for %d workers\n", threadCount);
+        return 1;
+    }
+    pthread_mutex_init(&generator.lock, NULL);
+    pthread_cond_init(&generator.made, NULL);
+    pthread_cond_init(&generator.written, NULL);
+    for (int i = 0; i < threadCount; i++) {
+        pthread_create(&threads[i], NULL, generateBoards, &generator);
+    }
+    int wasSuccessful = writeBoards(&generator, &writer, histogram);
+    for (int i = 0; i < threadCount; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    wasSuccessful = finishArchive(&writer) && wasSuccessful;
+    if (wasSuccessful == 0) {
+        fprintf(stderr, "gave up after %llu of %llu boards, a board of %d to %d moves took over %d attempts or the "
+                        "archive could not be written\n", (unsigned long long) generator.writtenCount,
+                (unsigned long long) generator.count, generator.minLength, generator.maxLength,
+                GENERATE_MAX_ATTEMPTS);
+    }
+    for (int length = generator.minLength; length <= generator.maxLength; length++) {
+        fprintf(stderr, "%3d moves: %llu boards\n", length, (unsigned long long) histogram[length]);
+    }
+    fprintf(stderr, "%llu boards in %llu attempts and %llu solves on %d threads\n",
+            (unsigned long long) generator.writtenCount, (unsigned long long) generator.attempts,
+            (unsigned long long) generator.solves, threadCount);
+    free(generator.slots);
+    free(threads);
+    return wasSuccessful ? 0 : 1;
+}
@@ -0,0 +1,199 @@
+/*
+ * Representing the hint cache of "sliding puzzle" game
+ * Uses C99 standard
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "sp-hint.h"
+#include "sp-solver.h"
+
+#define HINT_VALID (1ULL << 63)
+#define ZOBRIST_SEED 0x9e3779b97f4a7c15ULL
+
+struct hintEntry {
+    uint64_t check;//key ^ data, 0 together with data for an entry never written
+    uint64_t data;//best tile in bits 0..15, distance in bits 16..31, HINT_VALID set
+};
+
+struct hintTable {
+    size_t bucketCount;//a power of two, 0 until the table is created
+    struct hintEntry *entries;//bucketCount * HINT_BUCKET_ENTRIES, bucket b starts at entry b * HINT_BUCKET_ENTRIES
+    uint8_t *referenced;//per entry, set when it is stored or found, cleared by the clock hand passing it
+    uint8_t *hands;//per bucket, the entry the clock hand looks at next
+};
+
+struct hintTable hintTable;
+
+/*
+ * Maps the table, in memory shared with every process forked afterwards.
+ * @param entryCount: entries to make room for, rounded down to a power of two, 0 for SP_HINT_ENTRIES or
+ * HINT_DEFAULT_ENTRIES when that is not set.
+ * @return: 1 if the table is there, 0 if it could not be mapped, hints are then searched every time.
+ */
+int createHintTable(size_t entryCount) {
+    const char *setting = getenv("SP_HINT_ENTRIES");
+    if (entryCount == 0 && setting != NULL) {
+        entryCount = strtoull(setting, NULL, 10);
+    }
+    if (entryCount == 0) {
+        entryCount = HINT_DEFAULT_ENTRIES;
+    }
+    size_t rounded = HINT_BUCKET_ENTRIES;
+    while (rounded * 2 <= entryCount) {
+        rounded *= 2;
+    }
+    size_t bucketCount = rounded / HINT_BUCKET_ENTRIES;
+    size_t length = (rounded * (sizeof(struct hintEntry) + 1)) + bucketCount;
+    uint8_t *base = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        return 0;
+    }
+    hintTable.entries = (struct hintEntry *) base;
+    hintTable.referenced = base + (rounded * sizeof(struct hintEntry));
+    hintTable.hands = hintTable.referenced + rounded;
+    hintTable.bucketCount = bucketCount;
+    return 1;
+}
+
+/*
+ * The random number a tile contributes to the hash of a board when it sits on a cell.
+ * Drawn from the mix rather than a table of them, so every process agrees on them without sharing anything.
+ */
+uint64_t zobristKey(int size, int cell, int tile) {
+    return mixBits(ZOBRIST_SEED ^ ((uint64_t) size << 32) ^ ((uint64_t) cell << 16) ^ (uint64_t) tile);
+}
+
+/*
+ * The Zobrist hash of a board, the xor of the keys of all its tiles, the empty tile included.
+ * A move changes it by the keys of the two cells it touches, before and after, see hintGame().
+ * @param tiles: one byte per tile, EMPTY_TILE for the empty tile.
+ */
+uint64_t zobristHash(const uint8_t *tiles, int size) {
+    uint64_t hash = 0;
+    for (int cell = 0; cell < size * size; cell++) {
+        hash ^= zobristKey(size, cell, tiles[cell]);
+    }
+    return hash;
+}
+
+/*
+ * Looks a position up.
+ * @param tile: receives the best tile to move from there.
+ * @param distance: receives the moves the position is from solved.
+ * @return: 1 if the position is in the table, 0 otherwise.
+ */
+int lookupHint(uint64_t key, int *tile, int *distance) {
+    if (hintTable.bucketCount == 0) {
+        return 0;
+    }
+    size_t first = (key & (hintTable.bucketCount - 1)) * HINT_BUCKET_ENTRIES;
+    for (size_t index = first; index < first + HINT_BUCKET_ENTRIES; index++) {
+        uint64_t data = __atomic_load_n(&hintTable.entries[index].data, __ATOMIC_ACQUIRE);
+        uint64_t check = __atomic_load_n(&hintTable.entries[index].check, __ATOMIC_ACQUIRE);
+        if ((data & HINT_VALID) && (check ^ data) == key) {
+            *tile = (int) (data & 0xffff);
+            *distance = (int) ((data >> 16) & 0xffff);
+            __atomic_store_n(&hintTable.referenced[index], 1, __ATOMIC_RELAXED);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Remembers a position, in the entry it already has, an empty one, or the one the bucket's clock hand gives up.
+ * The hand passes over entries looked up since it last came by, clearing them, and takes the first one that was
+ * not, it never has to go round more than twice.
+ * Writers that race for one entry may leave it torn, lookups then miss it until it is stored again.
+ */
+void storeHint(uint64_t key, int tile, int distance) {
+    if (hintTable.bucketCount == 0) {
+        return;
+    }
+    size_t bucket = key & (hintTable.bucketCount - 1);
+    size_t first = bucket * HINT_BUCKET_ENTRIES;
+    size_t victim = first + HINT_BUCKET_ENTRIES;
+    for (size_t index = first; index < first + HINT_BUCKET_ENTRIES; index++) {
+        uint64_t data = __atomic_load_n(&hintTable.entries[index].data, __ATOMIC_RELAXED);
+        uint64_t check = __atomic_load_n(&hintTable.entries[index].check, __ATOMIC_RELAXED);
+        if ((data & HINT_VALID) && (check ^ data) == key) {
+            victim = index;
+            break;
+        }
+        if ((data & HINT_VALID) == 0 && victim == first + HINT_BUCKET_ENTRIES) {
+            victim = index;//keep looking, the key may still be further on
+        }
+    }
+    int hand = __atomic_load_n(&hintTable.hands[bucket], __ATOMIC_RELAXED);
+    for (int step = 0; victim == first + HINT_BUCKET_ENTRIES; step++) {
+        size_t index = first + ((hand + step) % HINT_BUCKET_ENTRIES);
+        if (__atomic_exchange_n(&hintTable.referenced[index], 0, __ATOMIC_RELAXED) == 0) {
+            victim = index;
+            __atomic_store_n(&hintTable.hands[bucket], (hand + step + 1) % HINT_BUCKET_ENTRIES, __ATOMIC_RELAXED);
+        }
+    }
+    uint64_t data = HINT_VALID | ((uint64_t) distance << 16) | (uint64_t) tile;
+    __atomic_store_n(&hintTable.entries[victim].data, data, __ATOMIC_RELEASE);
+    __atomic_store_n(&hintTable.entries[victim].check, key ^ data, __ATOMIC_RELEASE);
+    __atomic_store_n(&hintTable.referenced[victim], 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * Finds the best next move for the board in progress, the board itself is not changed.
+ * A position not in the table is solved, and every position along the solution goes into the table with the
+ * moves it has left, so a player that follows the hints gets every later one from the table.
+ * Like solveGame(), boards larger than MAX_PACKED_BOARD_SIZE are given up on right away.
+ * A process that never created the table gets one of its own with the first hint.
+ * @param reply: receives the tile to move and how far the board is from solved.
+ */
+void hintGame(const struct game *game, struct hintReply *reply) {
+    struct solverResult result;
+    uint8_t tiles[MAX_PACKED_BOARD_SIZE * MAX_PACKED_BOARD_SIZE];
+    int size = game->boardSize;
+    int tile;
+    int distance;
+    memset(reply, 0, sizeof(*reply));
+    reply->status = -1;
+    if (size > MAX_PACKED_BOARD_SIZE) {
+        return;
+    }
+    if (hintTable.bucketCount == 0) {
+        createHintTable(0);
+    }
+    memcpy(tiles, game->board, game->maxTileValue + 1);
+    uint64_t key = zobristHash(tiles, size);
+    if (lookupHint(key, &tile, &distance)) {
+        reply->status = 1;
+        reply->tile = tile;
+        reply->distance = distance;
+        reply->fromCache = 1;
+        return;
+    }
+    solveBoard(tiles, size, SOLVER_NODE_LIMIT, &result);
+    if (result.found == 0) {
+        reply->status = isSolvable(tiles, size) ? -1 : 0;
+        return;
+    }
+    reply->status = 1;
+    reply->tile = (result.length > 0) ? result.moves[0] : EMPTY_TILE;
+    reply->distance = result.length;
+    int empty = game->emptyIndex;
+    const int steps[4] = {-1, 1, -size, size};
+    for (int i = 0; i < result.length; i++) {//the rest of an optimal solution is optimal from where it has got to
+        int moved = result.moves[i];
+        int from = empty;
+        storeHint(key, moved, result.length - i);
+        for (int neighbor = 0; neighbor < 4 && tiles[from] != moved; neighbor++) {//tiles are unique, no row checks
+            from = empty + steps[neighbor];
+            from = (from < 0 || from >= size * size) ? empty : from;
+        }
+        key ^= zobristKey(size, empty, EMPTY_TILE) ^ zobristKey(size, from, moved);
+        key ^= zobristKey(size, empty, moved) ^ zobristKey(size, from, EMPTY_TILE);
+        tiles[empty] = (uint8_t) moved;
+        tiles[from] = EMPTY_TILE;
+        empty = from;
+    }
+}
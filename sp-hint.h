@@ -0,0 +1,37 @@
+/*
+ * Representing the hint cache of "sliding puzzle" game
+ * Uses C99 standard
+ * Remembers the distance to solved and the best move of every position the solver has been through, keyed by a
+ * 64 bit Zobrist hash of the board. A hint asked again anywhere along a solution already found is one lookup.
+ * The table is a fixed number of buckets of HINT_BUCKET_ENTRIES entries, one cache line each, and takes no locks:
+ * an entry is two words, the data and the data xor the key, so a reader that catches an entry half written sees
+ * the wrong key and takes it for a miss. A full bucket gives up the entry the clock hand finds first that was not
+ * looked up since the hand last passed it.
+ * Created before the servers fork, the table lives in a shared mapping and every server process hints from it.
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#ifndef SP_HINT_H
+#define SP_HINT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sp-game.h"
+#include "sp-protocol.h"
+
+#define HINT_DEFAULT_ENTRIES (1 << 20)//16 bytes each, SP_HINT_ENTRIES picks another power of two
+#define HINT_BUCKET_ENTRIES 4
+
+int createHintTable(size_t entryCount);
+
+uint64_t zobristHash(const uint8_t *tiles, int size);
+
+uint64_t zobristKey(int size, int cell, int tile);
+
+int lookupHint(uint64_t key, int *tile, int *distance);
+
+void storeHint(uint64_t key, int tile, int distance);
+
+void hintGame(const struct game *game, struct hintReply *reply);
+
+#endif
@@ -0,0 +1,359 @@
+/*
+ * Representing the move journal of "sliding puzzle" game
+ * Uses C99 standard
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "sp-journal.h"
+#include "sp-save.h"
+
+uint64_t journalClock(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t) now.tv_sec * 1000000000ULL) + now.tv_nsec;
+}
+
+/*
+ * Gives up on the file after a failed write, the game goes on with undo and redo kept in memory.
+ */
+void dropJournalFile(struct journal *journal) {
+    perror("journal write failed, moves are no longer recorded");
+    close(journal->fd);
+    journal->fd = -1;
+    journal->pendingLength = 0;
+}
+
+/*
+ * Writes the entries collected so far, without waiting for the disk.
+ */
+void writePending(struct journal *journal) {
+    size_t written = 0;
+    while (written < journal->pendingLength) {
+        ssize_t count = write(journal->fd, journal->pending + written, journal->pendingLength - written);
+        if (count <= 0) {
+            dropJournalFile(journal);
+            return;
+        }
+        written += count;
+    }
+    journal->pendingLength = 0;
+    journal->unsynced = 1;
+}
+
+void appendEntry(struct journal *journal, uint8_t entry) {
+    if (journal->fd == -1) {
+        return;
+    }
+    if (journal->pendingLength == JOURNAL_BUFFER_BYTES) {
+        writePending(journal);
+        if (journal->fd == -1) {
+            return;
+        }
+    }
+    journal->pending[journal->pendingLength++] = entry;
+}
+
+/*
+ * Adds a move to the history, dropping the moves that could have been redone.
+ * A history of JOURNAL_MAX_HISTORY moves first lets go of its older half, however long a game goes on undo reaches
+ * back at least that far and the history never takes more memory. A replay drops the same moves at the same point.
+ * @return: 0 if out of memory.
+ */
+int pushHistory(struct journal *journal, int direction) {
+    if (journal->historyLength == JOURNAL_MAX_HISTORY) {
+        journal->historyLength -= JOURNAL_MAX_HISTORY / 2;
+        memmove(journal->history, journal->history + (JOURNAL_MAX_HISTORY / 2), journal->historyLength);
+    }
+    if (journal->historyLength == journal->historyCapacity) {
+        size_t capacity = (journal->historyCapacity == 0) ? 1024 : journal->historyCapacity * 2;
+        uint8_t *history = realloc(journal->history, capacity);
+        if (history == NULL) {
+            return 0;
+        }
+        journal->history = history;
+        journal->historyCapacity = capacity;
+    }
+    journal->history[journal->historyLength++] = direction;
+    journal->redoLength = 0;
+    return 1;
+}
+
+/*
+ * Carries out one entry on the game and the move history, the same way for play and for replay.
+ * The journal must be detached from the game while this runs, so the moves it makes are not journaled again.
+ * @return: 1 if the entry could be carried out, 0 if it does not fit the game, which ends a replay.
+ */
+int applyEntry(struct journal *journal, struct game *game, int entry) {
+    int direction;
+    if (entry == JOURNAL_UNDO) {
+        if (journal->historyLength == 0) {
+            return 0;
+        }
+        direction = journal->history[journal->historyLength - 1] ^ 1;
+    } else if (entry == JOURNAL_REDO) {
+        if (journal->redoLength == 0) {
+            return 0;
+        }
+        direction = journal->history[journal->historyLength];
+    } else if (entry >= 0 && entry < 4) {
+        direction = entry;
+    } else {
+        return 0;
+    }
+    if (moveTile(game, resolveMove(game, moveUp - direction)) == 0) {
+        return 0;
+    }
+    if (entry == JOURNAL_UNDO) {
+        journal->historyLength--;
+        journal->redoLength++;
+        game->moveCount -= 2;//taking a move back counts as not having made it
+    } else if (entry == JOURNAL_REDO) {
+        journal->historyLength++;
+        journal->redoLength--;
+    } else if (pushHistory(journal, direction) == 0) {
+        return 0;
+    }
+    return 1;
+}
+
+/*
+ * Sets up the journal of a game and rebuilds the game from the journal file left by an earlier server, if any.
+ * The file is read in one go, its checkpoint restored and every entry after it replayed, moves and all, so undo
+ * and redo carry on where they were. Anything after the last entry that makes sense is cut off.
+ * Until checkpointJournal() the file, if any, is left alone.
+ * @param fileName: the journal file, NULL to keep the journal in memory only.
+ * @return: 1 if the game was rebuilt from the file, 0 if there was nothing to rebuild, the game is then untouched.
+ */
+int openJournal(struct journal *journal, const char *fileName, struct game *game) {
+    struct journalHeader header;
+    struct stat fileStat;
+    memset(journal, 0, sizeof(*journal));
+    journal->fd = -1;
+    if (fileName == NULL) {
+        return 0;
+    }
+    journal->pending = malloc(JOURNAL_BUFFER_BYTES);
+    journal->fileName = (journal->pending == NULL) ? NULL : strdup(fileName);
+    if (journal->fileName == NULL) {
+        free(journal->pending);
+        journal->pending = NULL;
+        return 0;
+    }
+    int fd = open(fileName, O_RDWR);
+    if (fd == -1) {
+        return 0;
+    }
+    uint8_t *contents = NULL;
+    size_t length = 0;
+    if (fstat(fd, &fileStat) == 0 && (size_t) fileStat.st_size >= sizeof(header) + sizeof(struct saveHeader)) {
+        length = fileStat.st_size;
+        contents = malloc(length);
+    }
+    size_t received = 0;
+    while (contents != NULL && received < length) {
+        ssize_t count = read(fd, contents + received, length - received);
+        if (count <= 0) {
+            break;
+        }
+        received += count;
+    }
+    int recovered = 0;
+    if (contents != NULL && received == length) {
+        struct saveHeader checkpoint;
+        memcpy(&header, contents, sizeof(header));
+        memcpy(&checkpoint, contents + sizeof(header), sizeof(checkpoint));
+        size_t entries = sizeof(header) + recordLength(checkpoint.boardSize);
+        recovered = memcmp(header.magic, JOURNAL_MAGIC, sizeof(header.magic)) == 0
+                    && header.version == JOURNAL_VERSION && entries > sizeof(header) && entries <= length
+                    && unpackGame(game, contents + sizeof(header), entries - sizeof(header));
+        while (recovered && entries < length && applyEntry(journal, game, contents[entries])) {
+            entries++;
+        }
+        if (recovered && ftruncate(fd, entries) == 0 && lseek(fd, 0, SEEK_END) != -1) {
+            journal->fd = fd;
+            journal->lastSync = journalClock();
+        }
+    }
+    free(contents);
+    if (journal->fd == -1) {
+        close(fd);
+        if (recovered) {
+            checkpointJournal(journal, game);//the game is back but the file cannot be added to, start a new one
+        }
+    }
+    return recovered;
+}
+
+/*
+ * Syncs the directory a file is in, so a file just renamed into it keeps its new name after a crash.
+ * @return: 1 if the directory is on disk, 0 otherwise.
+ */
+int syncDirectory(const char *fileName) {
+    char directory[4096];
+    const char *slash = strrchr(fileName, '/');
+    if (slash == NULL) {
+        strcpy(directory, ".");
+    } else {
+        snprintf(directory, sizeof(directory), "%.*s", (int) ((slash == fileName) ? 1 : slash - fileName), fileName);
+    }
+    int fd = open(directory, O_RDONLY | O_DIRECTORY);
+    if (fd == -1) {
+        return 0;
+    }
+    int isSynced = fsync(fd) == 0;
+    close(fd);
+    return isSynced;
+}
+
+/*
+ * Starts the journal over from the game as it is now, for a new or loaded game.
+ * The checkpoint goes to a new file that only replaces the old one once it and the rename are on disk, so a crash
+ * at any point leaves one complete journal behind. Undo does not reach back past a checkpoint, the history of the
+ * old game is let go of.
+ * @return: 1 if the journal has been started over, 0 if the file could not be written, moves then only go to memory.
+ */
+int checkpointJournal(struct journal *journal, const struct game *game) {
+    struct journalHeader header;
+    char temporaryName[4096];
+    free(journal->history);
+    journal->history = NULL;
+    journal->historyCapacity = 0;
+    journal->historyLength = 0;
+    journal->redoLength = 0;
+    journal->pendingLength = 0;
+    if (journal->fileName == NULL) {
+        return 1;
+    }
+    if (journal->fd != -1) {
+        close(journal->fd);
+        journal->fd = -1;
+    }
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, JOURNAL_MAGIC, sizeof(header.magic));
+    header.version = JOURNAL_VERSION;
+    snprintf(temporaryName, sizeof(temporaryName), "%s.tmp", journal->fileName);
+    int fd = open(temporaryName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        perror("cannot create journal");
+        return 0;
+    }
+    if (write(fd, &header, sizeof(header)) != (ssize_t) sizeof(header) || writeRecord(fd, game) == 0
+        || fdatasync(fd) != 0 || rename(temporaryName, journal->fileName) != 0
+        || syncDirectory(journal->fileName) == 0) {
+        perror("cannot write journal");
+        close(fd);
+        unlink(temporaryName);
+        return 0;
+    }
+    journal->fd = fd;
+    journal->unsynced = 0;
+    journal->lastSync = journalClock();
+    return 1;
+}
+
+/*
+ * Records a move moveTile() made, see struct journal. Moves that were undone can no longer be redone after it.
+ * @param direction: 0..3, the moveDirection of the move counted from moveUp.
+ */
+void journalMove(struct journal *journal, int direction) {
+    if (pushHistory(journal, direction) == 0) {
+        journal->historyLength = 0;//undo cannot be trusted without the full history
+        journal->redoLength = 0;
+    }
+    appendEntry(journal, direction);
+}
+
+/*
+ * Undo or redo of a game with a journal, journaled like any move.
+ */
+int takeEntry(struct game *game, int entry) {
+    struct journal *journal = game->journal;
+    if (journal == NULL) {
+        return 0;
+    }
+    game->journal = NULL;
+    int wasApplied = applyEntry(journal, game, entry);
+    game->journal = journal;
+    if (wasApplied) {
+        appendEntry(journal, entry);
+    }
+    return wasApplied;
+}
+
+/*
+ * Takes back the last move of the game.
+ * @return: 1 if a move was taken back, 0 if there is none since the game started or the game has no journal.
+ */
+int undoMove(struct game *game) {
+    return takeEntry(game, JOURNAL_UNDO);
+}
+
+/*
+ * Makes the last move taken back again.
+ * @return: 1 if a move was made, 0 if there is nothing to redo.
+ */
+int redoMove(struct game *game) {
+    return takeEntry(game, JOURNAL_REDO);
+}
+
+/*
+ * Group commit, servers call it once they have answered every request they have at hand.
+ * The entries of all those requests go out in one write(), and the disk is synced if it has not been for
+ * JOURNAL_SYNC_MILLIS.
+ */
+void flushJournal(struct journal *journal) {
+    if (journal->fd == -1) {
+        return;
+    }
+    if (journal->pendingLength > 0) {
+        writePending(journal);
+    }
+    uint64_t now = journalClock();
+    if (journal->fd != -1 && journal->unsynced && now - journal->lastSync >= JOURNAL_SYNC_MILLIS * 1000000ULL) {
+        fdatasync(journal->fd);
+        journal->unsynced = 0;
+        journal->lastSync = now;
+    }
+}
+
+/*
+ * How long a server waiting for requests may stay idle before it has to call flushJournal(), so every move it has
+ * answered reaches the disk within JOURNAL_SYNC_MILLIS even when no round of requests comes after it.
+ * @return: milliseconds, 0 if a sync is due now, -1 if nothing waits to be synced, as poll() takes a timeout.
+ */
+int journalSyncDelay(const struct journal *journal) {
+    if (journal->fd == -1 || (journal->unsynced == 0 && journal->pendingLength == 0)) {
+        return -1;
+    }
+    uint64_t waited = (journalClock() - journal->lastSync) / 1000000ULL;
+    return (waited >= JOURNAL_SYNC_MILLIS) ? 0 : (int) (JOURNAL_SYNC_MILLIS - waited);
+}
+
+/*
+ * Writes and syncs whatever is left and releases the journal.
+ * @param keepFile: 0 on a clean shutdown, the file is removed as there is nothing to recover.
+ */
+void closeJournal(struct journal *journal, int keepFile) {
+    if (journal->fd != -1) {
+        writePending(journal);
+    }
+    if (journal->fd != -1) {
+        fdatasync(journal->fd);
+        close(journal->fd);
+    }
+    if (journal->fileName != NULL && keepFile == 0) {
+        unlink(journal->fileName);
+    }
+    free(journal->history);
+    free(journal->pending);
+    free(journal->fileName);
+    memset(journal, 0, sizeof(*journal));
+    journal->fd = -1;
+}
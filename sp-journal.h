@@ -0,0 +1,71 @@
+/*
+ * Representing the move journal of "sliding puzzle" game
+ * Uses C99 standard
+ * A journal file starts with a checkpoint, the game as a save record taken when it began, followed by one byte for
+ * every move, undo and redo since. Moves are written as the direction they went rather than the tile, so a byte
+ * is enough on any board. Rebuilding a game is one read() of the file and a moveTile() per byte.
+ * Entries are collected in memory and go out with one write() whenever the server is done with a round of
+ * requests, so a dead server process loses nothing. The disk is synced with the first round that comes at least
+ * JOURNAL_SYNC_MILLIS after the last sync, one sync covers every move in between. A server that goes idle first
+ * syncs once that time is up, see journalSyncDelay().
+ * The last moves since the checkpoint, up to JOURNAL_MAX_HISTORY, are also kept in memory, which is all that undo
+ * and redo need.
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#ifndef SP_JOURNAL_H
+#define SP_JOURNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sp-game.h"
+
+#define JOURNAL_MAGIC "SPJL"
+#define JOURNAL_VERSION 1
+#define JOURNAL_BUFFER_BYTES 4096
+#define JOURNAL_SYNC_MILLIS 50
+#define JOURNAL_MAX_HISTORY (1 << 20)//moves kept for undo, see pushHistory()
+
+/*
+ * Entry bytes after the checkpoint, directions are 0..3 in the order of enum moveDirection.
+ * A direction xor 1 is the opposite direction, the one that takes the move back.
+ */
+#define JOURNAL_UNDO 4
+#define JOURNAL_REDO 5
+
+struct journalHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t reserved;
+};
+
+struct journal {
+    int fd;//-1 while nothing is written to a file, undo and redo still work
+    char *fileName;
+    uint8_t *pending;//JOURNAL_BUFFER_BYTES of entries not written yet, only for a journal with a file
+    size_t pendingLength;
+    int unsynced;//1 if written entries may not have reached the disk yet
+    uint64_t lastSync;//CLOCK_MONOTONIC nanoseconds
+    uint8_t *history;//directions of the moves since the checkpoint
+    size_t historyLength;//moves in effect, the redoLength after them were undone
+    size_t redoLength;
+    size_t historyCapacity;
+};
+
+int openJournal(struct journal *journal, const char *fileName, struct game *game);
+
+int checkpointJournal(struct journal *journal, const struct game *game);
+
+void journalMove(struct journal *journal, int direction);
+
+int undoMove(struct game *game);
+
+int redoMove(struct game *game);
+
+void flushJournal(struct journal *journal);
+
+int journalSyncDelay(const struct journal *journal);
+
+void closeJournal(struct journal *journal, int keepFile);
+
+#endif
@@ -0,0 +1,70 @@
+/*
+ * Representing the move kernel table generator of "sliding puzzle" game
+ * Uses C99 standard
+ * Usage: sp-kernel-gen > sp-kernel-tables.h, run by make before sp-kernel.c is compiled.
+ * Writes, for every board size from MIN_BOARD_SIZE to MAX_PACKED_BOARD_SIZE, the constant tables its kernel
+ * looks everything up in, and the list of sizes sp-kernel.c makes a kernel for:
+ *  - kernelSteps<size>[cell][direction]: the cell next to 'cell' that a tile moving in 'direction' into the empty
+ *    tile comes from, counted from moveUp as the journal counts them, KERNEL_OFF_BOARD past the edge.
+ *  - kernelScores<size>[tile][cell]: twice the moves tile 'tile' on 'cell' needs to reach the nearer of its two
+ *    winning cells, plus one if it is on neither, see isTileMisplaced() in sp-game.c. Row 0 is the empty tile's.
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "sp-kernel.h"
+#include "sp-protocol.h"
+
+void writeSteps(int size) {
+    int cellCount = size * size;
+    printf("static const uint8_t kernelSteps%d[%d][4] = {\n", size, cellCount);
+    for (int cell = 0; cell < cellCount; cell++) {
+        int row = cell / size;
+        int column = cell % size;
+        printf("    {%d, %d, %d, %d},\n", (row < size - 1) ? cell + size : KERNEL_OFF_BOARD,
+               (row > 0) ? cell - size : KERNEL_OFF_BOARD, (column < size - 1) ? cell + 1 : KERNEL_OFF_BOARD,
+               (column > 0) ? cell - 1 : KERNEL_OFF_BOARD);
+    }
+    printf("};\n");
+}
+
+int distanceBetween(int size, int cell, int other) {
+    return abs((cell / size) - (other / size)) + abs((cell % size) - (other % size));
+}
+
+void writeScores(int size) {
+    int cellCount = size * size;
+    printf("static const uint8_t kernelScores%d[%d][%d] = {\n", size, cellCount, cellCount);
+    for (int tile = 0; tile < cellCount; tile++) {
+        int goal = (cellCount - 1) - tile;
+        printf("    {");
+        for (int cell = 0; cell < cellCount; cell++) {
+            int score = 0;
+            if (tile != EMPTY_TILE) {
+                int toEarlier = distanceBetween(size, cell, goal);
+                int toLater = distanceBetween(size, cell, goal + 1);
+                score = (2 * ((toEarlier < toLater) ? toEarlier : toLater)) + (cell != goal && cell != goal + 1);
+            }
+            printf((cell == 0) ? "%d" : ", %d", score);
+        }
+        printf("},\n");
+    }
+    printf("};\n");
+}
+
+int main(void) {
+    printf("/*\n * Written by sp-kernel-gen, do not edit, see sp-kernel-gen.c for what the tables hold.\n */\n");
+    printf("#ifndef SP_KERNEL_TABLES_H\n#define SP_KERNEL_TABLES_H\n\n#include <stdint.h>\n\n");
+    for (int size = MIN_BOARD_SIZE; size <= MAX_PACKED_BOARD_SIZE; size++) {
+        writeSteps(size);
+        writeScores(size);
+        printf("\n");
+    }
+    printf("#define KERNEL_SIZES(X)");
+    for (int size = MIN_BOARD_SIZE; size <= MAX_PACKED_BOARD_SIZE; size++) {
+        printf(" X(%d)", size);
+    }
+    printf("\n\n#endif\n");
+    return 0;
+}
@@ -0,0 +1,114 @@
+/*
+ * Representing the move kernels of "sliding puzzle" game
+ * Uses C99 standard
+ * The sized functions below are written once and always inlined into one small wrapper per board size, where the
+ * size is a constant: every row length, cell count and table stride folds away and the loops unroll completely.
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#include "sp-kernel.h"
+#include "sp-game.h"
+#include "sp-journal.h"
+#include "sp-kernel-tables.h"
+
+#define KERNEL_INLINE static inline __attribute__((always_inline))
+
+/*
+ * A tile can move when its cell is one of the empty tile's neighbours, four comparisons and no branch.
+ */
+KERNEL_INLINE int sizedIsMoveValid(const struct game *game, int tileToCheck, int size, const uint8_t (*steps)[4]) {
+    if ((unsigned) (tileToCheck - 1) >= (unsigned) ((size * size) - 1)) {
+        return 0;
+    }
+    uint32_t at = game->tilePosition[tileToCheck];
+    const uint8_t *near = steps[game->emptyIndex];
+    return (at == near[0]) | (at == near[1]) | (at == near[2]) | (at == near[3]);
+}
+
+/*
+ * Same as the general moveTile(), the two counters change by what the scores table gives for the moved tile's two
+ * cells, and the board is written directly instead of through setOneTile().
+ */
+KERNEL_INLINE int sizedMoveTile(struct game *game, int desiredValue, int size, const uint8_t (*steps)[4],
+                                const uint8_t *scores) {
+    if (sizedIsMoveValid(game, desiredValue, size, steps) == 0) {
+        return 0;
+    }
+    int emptyIndex = game->emptyIndex;
+    int tileIndex = game->tilePosition[desiredValue];
+    int before = scores[(desiredValue * size * size) + tileIndex];
+    int after = scores[(desiredValue * size * size) + emptyIndex];
+    game->misplacedTiles += (after & 1) - (before & 1);
+    game->manhattanDistance += (after >> 1) - (before >> 1);
+    if (game->journal != NULL) {
+        int offset = tileIndex - emptyIndex;
+        journalMove(game->journal, (offset == size) ? 0 : (offset == -size) ? 1 : (offset == 1) ? 2 : 3);
+    }
+    uint32_t *logged = game->changeLog + (2 * (game->boardVersion & game->changeLogMask));
+    logged[0] = emptyIndex;
+    logged[1] = tileIndex;
+    game->boardVersion++;
+    game->board[emptyIndex] = desiredValue;
+    game->board[tileIndex] = EMPTY_TILE;
+    game->tilePosition[desiredValue] = emptyIndex;
+    game->emptyIndex = tileIndex;
+    game->moveCount++;
+    return 1;
+}
+
+KERNEL_INLINE int sizedResolveMove(const struct game *game, int entry, const uint8_t (*steps)[4]) {
+    if (entry > 0) {
+        return entry;
+    }
+    unsigned direction = (unsigned) (moveUp - entry);
+    if (direction > 3) {
+        return 0;
+    }
+    int cell = steps[game->emptyIndex][direction];
+    return (cell == KERNEL_OFF_BOARD) ? 0 : (int) game->board[cell];
+}
+
+KERNEL_INLINE void sizedMeasureBoard(struct game *game, int size, const uint8_t *scores) {
+    int misplacedTiles = 0;
+    int manhattanDistance = 0;
+#pragma GCC unroll 81
+    for (int value = 1; value < size * size; value++) {
+        int score = scores[(value * size * size) + game->tilePosition[value]];
+        misplacedTiles += score & 1;
+        manhattanDistance += score >> 1;
+    }
+    game->misplacedTiles = misplacedTiles;
+    game->manhattanDistance = manhattanDistance;
+}
+
+#define DEFINE_KERNEL(size) \
+    static int isMoveValid##size(const struct game *game, int tileToCheck) { \
+        return sizedIsMoveValid(game, tileToCheck, size, kernelSteps##size); \
+    } \
+    static int moveTile##size(struct game *game, int desiredValue) { \
+        return sizedMoveTile(game, desiredValue, size, kernelSteps##size, kernelScores##size[0]); \
+    } \
+    static int resolveMove##size(const struct game *game, int entry) { \
+        return sizedResolveMove(game, entry, kernelSteps##size); \
+    } \
+    static void measureBoard##size(struct game *game) { \
+        sizedMeasureBoard(game, size, kernelScores##size[0]); \
+    } \
+    static const struct moveKernel kernel##size = {isMoveValid##size, moveTile##size, resolveMove##size, \
+                                                   measureBoard##size};
+
+KERNEL_SIZES(DEFINE_KERNEL)
+
+#define KERNEL_ENTRY(size) [size] = &kernel##size,
+
+static const struct moveKernel *const sizedKernels[MAX_PACKED_BOARD_SIZE + 1] = {KERNEL_SIZES(KERNEL_ENTRY)};
+
+/*
+ * @return: the kernel made for boards of this size, NULL for a size without one.
+ */
+const struct moveKernel *selectKernel(int boardSize) {
+    if (boardSize < 0 || boardSize > MAX_PACKED_BOARD_SIZE) {
+        return NULL;
+    }
+    return sizedKernels[boardSize];
+}
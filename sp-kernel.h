@@ -0,0 +1,30 @@
+/*
+ * Representing the move kernels of "sliding puzzle" game
+ * Uses C99 standard
+ * Every board size up to MAX_PACKED_BOARD_SIZE gets its own copy of the move hot path, compiled with the size as a
+ * constant against tables sp-kernel-gen writes at build time: the neighbours of every cell and the distance of
+ * every tile from every cell. Moving then takes no division and no branch on the size. initialize() picks the
+ * kernel of the board's size once, larger boards get the general code in sp-game.c.
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#ifndef SP_KERNEL_H
+#define SP_KERNEL_H
+
+#define KERNEL_OFF_BOARD 255//neighbour of a cell at the edge, never a board index of a kernel's board
+
+struct game;
+
+/*
+ * The calls of sp-game.h that depend on the board size, see there.
+ */
+struct moveKernel {
+    int (*isMoveValid)(const struct game *game, int tileToCheck);
+    int (*moveTile)(struct game *game, int desiredValue);
+    int (*resolveMove)(const struct game *game, int entry);
+    void (*measureBoard)(struct game *game);
+};
+
+const struct moveKernel *selectKernel(int boardSize);
+
+#endif
@@ -0,0 +1,399 @@
+/*
+ * Representing the load generator of "sliding puzzle" game
+ * Uses C99 standard
+ * Usage: sp-load [-s socket] [-k clients] [-d seconds] [-m mix] [-t think micros] [-z seed]
+ * Runs K synthetic players side by side, each on its own connection and each waiting for every reply like the
+ * real client does. Without -s every player gets its own forked pipe server, as the game itself would, with -s
+ * they all connect to one running socket server.
+ * The mix weighs the commands a player picks from, for example "move=70,print=20,new=5,save=3,load=2".
+ * Latency is taken on the player side, from before the request is written until the whole reply is in, and
+ * goes into the same histograms the server keeps for its stats command.
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "sp-pipe-io.h"
+#include "sp-protocol.h"
+#include "sp-session.h"
+#include "sp-stats.h"
+
+#define MAX_LOAD_CLIENTS 4096
+#define DEFAULT_LOAD_MIX "move=70,print=20,new=5,save=3,load=2"
+
+struct sharedChannel;
+
+void serverFunction(int *command, int *data, struct sharedChannel *channel);
+
+/*
+ * One synthetic player and what it knows of its board, kept up to date from its own moves and prints.
+ */
+struct loadClient {
+    int commandFd;
+    int dataFd;
+    pid_t server;//forked pipe server, 0 on a socket
+    pthread_t thread;
+    uint64_t randomState;
+    uint8_t tiles[MAX_PACKED_BOARD_SIZE * MAX_PACKED_BOARD_SIZE];//players only ever start boards up to this size
+    int boardSize;//0 when the board has to be asked for again in full
+    int emptyIndex;
+    int32_t game;//game and boardVersion of the last print, sent with the next one so only changes come back
+    int64_t boardVersion;
+    int hasSave;
+    uint32_t requestId;//of the last request sent
+    uint64_t requests;
+    uint64_t failures;//requests the server turned down, moves into the edge never go out so these are real
+    int broken;//1 once the connection was lost
+    char fileName[FILE_NAME_LENGTH];
+};
+
+int commandWeights[STATS_COMMANDS];
+int totalWeight = 0;
+long thinkMicros = 0;
+volatile int stopLoad = 0;
+
+uint64_t nextLoadRandom(struct loadClient *client) {
+    client->randomState ^= client->randomState >> 12;
+    client->randomState ^= client->randomState << 25;
+    client->randomState ^= client->randomState >> 27;
+    return client->randomState * 0x2545f4914f6cdd1dULL;
+}
+
+/*
+ * Turns "move=70,print=20" into weights, commands left out are never sent.
+ * Only print, save, load, new and move can be asked for, the rest need more context than a player here has.
+ * @return: 1 if every part named one of those commands with a weight, 0 otherwise.
+ */
+int parseMix(const char *mix) {
+    const int allowed[] = {print, save, load, new, move};
+    char buffer[256];
+    memset(commandWeights, 0, sizeof(commandWeights));
+    totalWeight = 0;
+    snprintf(buffer, sizeof(buffer), "%s", mix);
+    for (char *part = strtok(buffer, ","); part != NULL; part = strtok(NULL, ",")) {
+        char *equals = strchr(part, '=');
+        int found = 0;
+        if (equals == NULL) {
+            return 0;
+        }
+        *equals = '\0';
+        for (size_t i = 0; i < sizeof(allowed) / sizeof(allowed[0]); i++) {
+            if (strcmp(part, commandNames[allowed[i]]) == 0) {
+                commandWeights[allowed[i]] = atoi(equals + 1);
+                found = 1;
+            }
+        }
+        if (found == 0 || atoi(equals + 1) < 0) {
+            return 0;
+        }
+    }
+    for (int command = 0; command < STATS_COMMANDS; command++) {
+        totalWeight += commandWeights[command];
+    }
+    return totalWeight > 0;
+}
+
+int pickCommand(struct loadClient *client) {
+    int roll = nextLoadRandom(client) % totalWeight;
+    int command = 0;
+    while (roll >= commandWeights[command]) {
+        roll -= commandWeights[command];
+        command++;
+    }
+    return command;
+}
+
+/*
+ * Sends one request and takes in its whole reply, timing the two together.
+ * A print is answered with a snapshot header and the tiles after it, the whole board or only the cells that
+ * changed, either way they go to the client's own board.
+ * @param argument: bytes after the command, argumentLength of them.
+ * @param reply: receives replyLength bytes, the status word that follows is handled here.
+ * @return: 0 if the connection is gone, 1 otherwise.
+ */
+int exchange(struct loadClient *client, int32_t command, const void *argument, size_t argumentLength,
+             void *reply, size_t replyLength) {
+    uint8_t request[sizeof(struct frameHeader) + sizeof(int32_t) + FILE_NAME_LENGTH];
+    struct frameHeader frame = {.length = sizeof(command) + argumentLength, .id = ++client->requestId};
+    int32_t isWon;
+    memcpy(request, &frame, sizeof(frame));
+    memcpy(request + sizeof(frame), &command, sizeof(command));
+    if (argumentLength > 0) {
+        memcpy(request + sizeof(frame) + sizeof(command), argument, argumentLength);
+    }
+    uint64_t start = statsClock();
+    ssize_t length = sizeof(frame) + frame.length;
+    if (write(client->commandFd, request, length) != length || readFully(client->dataFd, &frame, sizeof(frame)) == 0
+        || frame.id != client->requestId || readFully(client->dataFd, reply, replyLength) == 0) {
+        client->broken = 1;
+        return 0;
+    }
+    if (command == print) {
+        struct snapshotHeader header;
+        uint8_t pairs[2 * MAX_PACKED_BOARD_SIZE * MAX_PACKED_BOARD_SIZE];//tiles are a byte each on these boards
+        memcpy(&header, reply, sizeof(header));
+        int cellCount = header.boardSize * header.boardSize;
+        size_t tileBytes = (header.changes == -1) ? (size_t) cellCount : (size_t) header.changes * 2;
+        if (header.boardSize < MIN_BOARD_SIZE || header.boardSize > MAX_PACKED_BOARD_SIZE || header.changes < -1
+            || header.changes >= cellCount
+            || readFully(client->dataFd, (header.changes == -1) ? client->tiles : pairs, tileBytes) == 0) {
+            client->broken = 1;
+            return 0;
+        }
+        for (int i = 0; i < header.changes; i++) {
+            if (pairs[2 * i] >= cellCount) {
+                client->broken = 1;
+                return 0;
+            }
+            client->tiles[pairs[2 * i]] = pairs[(2 * i) + 1];
+        }
+    }
+    if (readFully(client->dataFd, &isWon, sizeof(isWon)) == 0) {
+        client->broken = 1;
+        return 0;
+    }
+    recordLatency(command, statsClock() - start);
+    countTraffic(sizeof(frame) + frame.length, length);
+    client->requests++;
+    if (isWon == 1) {
+        client->boardSize = 0;//the server started a new game, the board has to be asked for again
+    }
+    return 1;
+}
+
+int refreshBoard(struct loadClient *client) {
+    struct snapshotHeader header;
+    uint8_t mirror[sizeof(client->game) + sizeof(client->boardVersion)];
+    int32_t game = (client->boardSize == 0) ? -1 : client->game;
+    memcpy(mirror, &game, sizeof(game));
+    memcpy(mirror + sizeof(game), &client->boardVersion, sizeof(client->boardVersion));
+    if (exchange(client, print, mirror, sizeof(mirror), &header, sizeof(header)) == 0) {
+        return 0;
+    }
+    client->boardSize = header.boardSize;
+    client->emptyIndex = header.emptyIndex;
+    client->game = header.game;
+    client->boardVersion = header.boardVersion;
+    return 1;
+}
+
+/*
+ * Moves one of the tiles next to the empty one, picked at random.
+ */
+int sendMove(struct loadClient *client) {
+    int size = client->boardSize;
+    int row = client->emptyIndex / size;
+    int column = client->emptyIndex % size;
+    int neighbours[4];
+    int count = 0;
+    int32_t success;
+    if (row > 0) {
+        neighbours[count++] = client->emptyIndex - size;
+    }
+    if (row < size - 1) {
+        neighbours[count++] = client->emptyIndex + size;
+    }
+    if (column > 0) {
+        neighbours[count++] = client->emptyIndex - 1;
+    }
+    if (column < size - 1) {
+        neighbours[count++] = client->emptyIndex + 1;
+    }
+    int tileIndex = neighbours[nextLoadRandom(client) % count];
+    int32_t tile = client->tiles[tileIndex];
+    if (exchange(client, move, &tile, sizeof(tile), &success, sizeof(success)) == 0) {
+        return 0;
+    }
+    if (success == 1) {
+        client->tiles[client->emptyIndex] = tile;
+        client->tiles[tileIndex] = EMPTY_TILE;
+        client->emptyIndex = tileIndex;
+    } else {
+        client->failures++;
+    }
+    return 1;
+}
+
+/*
+ * Plays until told to stop or the connection goes.
+ */
+void *runClient(void *argument) {
+    struct loadClient *client = argument;
+    int32_t success;
+    while (stopLoad == 0 && client->broken == 0) {
+        if (client->boardSize == 0 && refreshBoard(client) == 0) {
+            break;
+        }
+        int command = pickCommand(client);
+        if (command == move) {
+            sendMove(client);
+        } else if (command == print) {
+            refreshBoard(client);
+        } else if (command == new) {
+            int32_t size = MIN_BOARD_SIZE + (nextLoadRandom(client) % (MAX_PACKED_BOARD_SIZE - MIN_BOARD_SIZE + 1));
+            if (exchange(client, new, &size, sizeof(size), &success, sizeof(success)) && success == 1) {
+                client->boardSize = 0;
+            }
+        } else if (command == save || (command == load && client->hasSave == 0)) {
+            if (exchange(client, save, client->fileName, FILE_NAME_LENGTH, &success, sizeof(success))) {
+                client->hasSave |= success;
+                client->failures += 1 - success;
+            }
+        } else if (command == load) {
+            if (exchange(client, load, client->fileName, FILE_NAME_LENGTH, &success, sizeof(success))) {
+                client->boardSize = (success == 1) ? 0 : client->boardSize;
+                client->failures += 1 - success;
+            }
+        }
+        if (thinkMicros > 0) {
+            struct timespec think = {thinkMicros / 1000000, (thinkMicros % 1000000) * 1000};
+            nanosleep(&think, NULL);
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Opens the connection of player 'index', a forked pipe server or a socket of the running server.
+ * A forked server closes the pipes of the players before it, or their servers would never see them quit.
+ * @return: 1 if connected.
+ */
+int connectClient(struct loadClient *clients, int index, const char *socketPath) {
+    struct loadClient *client = &clients[index];
+    if (socketPath != NULL) {
+        struct sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        snprintf(address.sun_path, sizeof(address.sun_path), "%s", socketPath);
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd == -1 || connect(fd, (struct sockaddr *) &address, sizeof(address)) == -1) {
+            perror("cannot connect to the server");
+            if (fd != -1) {
+                close(fd);
+            }
+            return 0;
+        }
+        client->commandFd = fd;
+        client->dataFd = fd;
+        return 1;
+    }
+    int commandPipe[2];
+    int dataPipe[2];
+    if (pipe(commandPipe) || pipe(dataPipe)) {
+        perror("pipe failed");
+        return 0;
+    }
+    client->server = fork();
+    if (client->server == -1) {
+        perror("fork failed");
+        return 0;
+    }
+    if (client->server == 0) {
+        for (int i = 0; i < index; i++) {
+            close(clients[i].commandFd);
+            close(clients[i].dataFd);
+        }
+        serverFunction(commandPipe, dataPipe, NULL);
+        _exit(0);
+    }
+    close(commandPipe[0]);
+    close(dataPipe[1]);
+    client->commandFd = commandPipe[1];
+    client->dataFd = dataPipe[0];
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    const char *socketPath = NULL;
+    const char *mix = DEFAULT_LOAD_MIX;
+    int clientCount = 4;
+    double seconds = 5;
+    uint64_t seed = 1;
+    int option;
+    while ((option = getopt(argc, argv, "s:k:d:m:t:z:")) != -1) {
+        if (option == 's') {
+            socketPath = optarg;
+        } else if (option == 'k') {
+            clientCount = atoi(optarg);
+        } else if (option == 'd') {
+            seconds = atof(optarg);
+        } else if (option == 'm') {
+            mix = optarg;
+        } else if (option == 't') {
+            thinkMicros = atol(optarg);
+        } else if (option == 'z') {
+            seed = strtoull(optarg, NULL, 10);
+        } else {
+            clientCount = 0;
+        }
+    }
+    if (clientCount < 1 || clientCount > MAX_LOAD_CLIENTS || seconds <= 0 || thinkMicros < 0 || parseMix(mix) == 0) {
+        fprintf(stderr, "usage: %s [-s socket] [-k clients, 1..%d] [-d seconds] [-m mix, e.g. %s] "
+                        "[-t think micros] [-z seed]\n", argv[0], MAX_LOAD_CLIENTS, DEFAULT_LOAD_MIX);
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    struct loadClient *clients = calloc(clientCount, sizeof(struct loadClient));
+    int connected = 0;
+    while (connected < clientCount && connectClient(clients, connected, socketPath)) {
+        struct loadClient *client = &clients[connected];
+        client->randomState = (seed * 0x9e3779b97f4a7c15ULL) ^ ((uint64_t) (connected + 1) * 0xbf58476d1ce4e5b9ULL);
+        client->randomState = (client->randomState == 0) ? 1 : client->randomState;
+        snprintf(client->fileName, sizeof(client->fileName), "sp-load-%d-%d.sav", (int) getpid(), connected);
+        connected++;
+    }
+    uint64_t start = statsClock();
+    for (int i = 0; i < connected; i++) {
+        pthread_create(&clients[i].thread, NULL, runClient, &clients[i]);
+    }
+    struct timespec duration = {(time_t) seconds, (long) ((seconds - (time_t) seconds) * 1e9)};
+    while (nanosleep(&duration, &duration) == -1 && errno == EINTR) {
+    }
+    stopLoad = 1;
+    uint64_t requests = 0;
+    uint64_t failures = 0;
+    int broken = 0;
+    for (int i = 0; i < connected; i++) {
+        pthread_join(clients[i].thread, NULL);
+        requests += clients[i].requests;
+        failures += clients[i].failures;
+        broken += clients[i].broken;
+        close(clients[i].commandFd);//tells the server the player quit
+        if (clients[i].dataFd != clients[i].commandFd) {
+            close(clients[i].dataFd);
+        }
+        if (clients[i].server > 0) {
+            waitpid(clients[i].server, NULL, 0);
+        }
+        char path[4096];
+        if (saveFilePath(clients[i].fileName, path, sizeof(path))) {
+            unlink(path);//where a server with the same SP_SAVE_DIR put it
+        }
+    }
+    double elapsed = (statsClock() - start) / 1e9;
+    struct statsReply stats;
+    summarizeStats(&stats);
+    printf("%d of %d clients on %s, %.2f s, %llu requests, %.0f requests/s, %llu turned down, %d connections lost\n",
+           connected, clientCount, (socketPath != NULL) ? socketPath : "forked pipe servers", elapsed,
+           (unsigned long long) requests, requests / elapsed, (unsigned long long) failures, broken);
+    printf("%-8s %10s %12s %12s %12s %12s\n", "command", "count", "per second", "p50 (us)", "p99 (us)", "max (us)");
+    for (int command = 0; command < STATS_COMMANDS; command++) {
+        const struct latencySummary *summary = &stats.latency[command];
+        if (summary->count == 0) {
+            continue;
+        }
+        printf("%-8s %10llu %12.0f %12.1f %12.1f %12.1f\n", commandNames[command], (unsigned long long) summary->count,
+               summary->count / elapsed, summary->p50 / 1e3, summary->p99 / 1e3, summary->max / 1e3);
+    }
+    free(clients);
+    return (connected == clientCount && broken == 0) ? 0 : 1;
+}
@@ -0,0 +1,277 @@
+/*
+ * Representing the pattern database generator of "sliding puzzle" game
+ * Uses C99 standard
+ * Usage: sp-pdb-gen <board size> <partition> <output file>, for example sp-pdb-gen 4 6-6-3 sp-pdb-4.dat
+ * The partition splits the tiles into patterns by goal slot and must cover every tile, either as run lengths taken
+ * largest tiles first ("6-6-3") or as explicit slot lists ("0,1,4,5,8,9/2,3,6,7,10,11/12,13,14"). Compact blocks
+ * of goal cells catch more of the tiles' interactions than whole rows do.
+ * Each pattern is solved backwards from its goal by breadth first search over its own tiles and the empty tile,
+ * counting only moves of its own tiles. Other tiles are left out of the abstraction, the empty tile passes them for
+ * free, so the distances never overestimate, and since no move is ever counted by two patterns the distances of
+ * disjoint patterns can be added together. A placement keeps the distance of the best cell for the empty tile.
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sp-pdb.h"
+
+#define PDB_PAGE_SIZE 4096
+
+/*
+ * Cells of the region the empty tile can reach from 'cell' without moving a pattern tile, the cell included.
+ * @param occupied: 1 for every cell a pattern tile holds.
+ * @param region: receives the cells.
+ * @return: number of cells in the region.
+ */
+int fillRegion(int cell, const uint8_t *occupied, int size, uint8_t *region) {
+    uint8_t seen[MAX_PACKED_BOARD_SIZE * MAX_PACKED_BOARD_SIZE] = {0};
+    int count = 1;
+    region[0] = cell;
+    seen[cell] = 1;
+    for (int i = 0; i < count; i++) {
+        int at = region[i];
+        int targets[4] = {at - size, at + size, (at % size > 0) ? at - 1 : -1, (at % size < size - 1) ? at + 1 : -1};
+        for (int t = 0; t < 4; t++) {
+            if (targets[t] >= 0 && targets[t] < size * size && occupied[targets[t]] == 0 && seen[targets[t]] == 0) {
+                seen[targets[t]] = 1;
+                region[count++] = targets[t];
+            }
+        }
+    }
+    return count;
+}
+
+/*
+ * Fills in one segment of a pattern's entries, the distance of every placement from that segment's goal.
+ * The empty tile is part of the search: a pattern tile only moves into the empty cell, which costs a move, while
+ * the empty tile travels through the cells of other tiles for free. The empty tile's whole region, as fillRegion()
+ * gives it, is reached at once, so each level of the search only ever costs one move more than the last.
+ * Works level by level over the placements found at the previous depth instead of keeping a queue, which on large
+ * patterns would cost several times the memory of the table itself.
+ * @param entries: rankCount * (tileCount + 1) bytes, only every (tileCount + 1)th byte from 'segment' on is touched,
+ * it receives the distance from the closest cell the empty tile may start in.
+ * @param distances: rankCount * cellCount bytes of work space, the distance of every placement and empty cell.
+ * @param frontier: two bit sets of rankCount bits, the placements reached at the current and the next depth.
+ * @param segment: how many of the pattern's tiles sit on their own slot in the goal.
+ */
+void searchSegment(uint8_t *entries, uint8_t *distances, uint64_t **frontier, const struct pdbPattern *pattern,
+                   int size, int segment) {
+    int cellCount = size * size;
+    int tileCount = pattern->tileCount;
+    int stride = tileCount + 1;
+    size_t words = (pattern->rankCount + 63) / 64;
+    uint8_t positions[PDB_MAX_PATTERN_TILES];
+    uint8_t occupied[MAX_PACKED_BOARD_SIZE * MAX_PACKED_BOARD_SIZE] = {0};
+    uint8_t region[MAX_PACKED_BOARD_SIZE * MAX_PACKED_BOARD_SIZE];
+    for (int i = 0; i < tileCount; i++) {
+        positions[i] = pattern->slots[i] + (i < segment ? 0 : 1);
+        occupied[positions[i]] = 1;
+    }
+    memset(distances, PDB_UNREACHED, pattern->rankCount * cellCount);
+    memset(frontier[0], 0, words * sizeof(uint64_t));
+    uint64_t goalRank = rankPattern(positions, tileCount, cellCount);
+    int first = (segment == 0) ? 0 : pattern->slots[segment - 1] + 1;
+    int last = (segment == tileCount) ? cellCount - 1 : pattern->slots[segment];
+    for (int goal = first; goal <= last; goal++) {//every cell the empty tile finishes in for this segment
+        for (int i = fillRegion(goal, occupied, size, region) - 1; i >= 0; i--) {
+            distances[(goalRank * cellCount) + region[i]] = 0;
+        }
+    }
+    frontier[0][goalRank / 64] |= 1ULL << (goalRank % 64);
+    for (int depth = 0; depth < PDB_UNREACHED - 1; depth++) {
+        uint64_t found = 0;
+        memset(frontier[1], 0, words * sizeof(uint64_t));
+        for (size_t word = 0; word < words; word++) {
+            for (uint64_t bits = frontier[0][word]; bits != 0; bits &= bits - 1) {
+                uint64_t rank = (word * 64) + __builtin_ctzll(bits);
+                uint8_t *cells = distances + (rank * cellCount);
+                uint8_t handled[MAX_PACKED_BOARD_SIZE * MAX_PACKED_BOARD_SIZE] = {0};
+                unrankPattern(rank, positions, tileCount, cellCount);
+                memset(occupied, 0, cellCount);
+                for (int i = 0; i < tileCount; i++) {
+                    occupied[positions[i]] = i + 1;
+                }
+                for (int empty = 0; empty < cellCount; empty++) {
+                    if (cells[empty] != depth || handled[empty]) {
+                        continue;
+                    }
+                    int regionSize = fillRegion(empty, occupied, size, region);
+                    for (int r = 0; r < regionSize; r++) {
+                        handled[region[r]] = 1;
+                    }
+                    for (int r = 0; r < regionSize; r++) {//every pattern tile next to the region can step into it
+                        int to = region[r];
+                        int from[4] = {to - size, to + size, (to % size > 0) ? to - 1 : -1,
+                                       (to % size < size - 1) ? to + 1 : -1};
+                        for (int t = 0; t < 4; t++) {
+                            if (from[t] < 0 || from[t] >= cellCount || occupied[from[t]] == 0) {
+                                continue;
+                            }
+                            int tile = occupied[from[t]] - 1;
+                            positions[tile] = to;
+                            uint64_t next = rankPattern(positions, tileCount, cellCount);
+                            positions[tile] = from[t];
+                            if (distances[(next * cellCount) + from[t]] != PDB_UNREACHED) {
+                                continue;
+                            }
+                            uint8_t nextRegion[MAX_PACKED_BOARD_SIZE * MAX_PACKED_BOARD_SIZE];
+                            occupied[to] = occupied[from[t]];
+                            occupied[from[t]] = 0;
+                            for (int i = fillRegion(from[t], occupied, size, nextRegion) - 1; i >= 0; i--) {
+                                distances[(next * cellCount) + nextRegion[i]] = depth + 1;
+                            }
+                            occupied[from[t]] = occupied[to];
+                            occupied[to] = 0;
+                            frontier[1][next / 64] |= 1ULL << (next % 64);
+                            found++;
+                        }
+                    }
+                }
+            }
+        }
+        fprintf(stderr, "  segment %d depth %d: %llu regions\n", segment, depth + 1, (unsigned long long) found);
+        uint64_t *reached = frontier[0];
+        frontier[0] = frontier[1];
+        frontier[1] = reached;
+        if (found == 0) {
+            break;
+        }
+    }
+    for (uint64_t rank = 0; rank < pattern->rankCount; rank++) {
+        uint8_t nearest = PDB_UNREACHED;
+        for (int cell = 0; cell < cellCount; cell++) {
+            nearest = (distances[(rank * cellCount) + cell] < nearest) ? distances[(rank * cellCount) + cell] : nearest;
+        }
+        entries[(rank * stride) + segment] = nearest;
+    }
+}
+
+/*
+ * Adds one slot to a pattern, keeping its slots ascending.
+ * @return: 0 if the slot is off the board, already taken or the pattern is full, 1 otherwise.
+ */
+int addSlot(struct pdbPattern *pattern, long slot, int size, uint8_t *slotTaken) {
+    if (slot < 0 || slot >= (size * size) - 1 || slotTaken[slot] || pattern->tileCount == PDB_MAX_PATTERN_TILES) {
+        return 0;
+    }
+    uint32_t i = pattern->tileCount++;
+    while (i > 0 && pattern->slots[i - 1] > slot) {
+        pattern->slots[i] = pattern->slots[i - 1];
+        i--;
+    }
+    pattern->slots[i] = slot;
+    slotTaken[slot] = 1;
+    return 1;
+}
+
+/*
+ * Turns "6-6-3" or "0,1,4,5,8,9/2,3,6,7,10,11/12,13,14" into patterns, checking that they cover every tile once.
+ * @return: number of patterns, 0 if the partition is not usable for this size.
+ */
+int parsePartition(const char *partition, int size, struct pdbPattern *patterns) {
+    uint8_t slotTaken[MAX_PACKED_BOARD_SIZE * MAX_PACKED_BOARD_SIZE] = {0};
+    int explicitSlots = strchr(partition, ',') != NULL || strchr(partition, '/') != NULL;
+    int count = 0;
+    long nextSlot = 0;
+    const char *cursor = partition;
+    memset(patterns, 0, PDB_MAX_PATTERNS * sizeof(struct pdbPattern));
+    while (*cursor != '\0') {
+        char *end;
+        long value = strtol(cursor, &end, 10);
+        if (end == cursor || count == PDB_MAX_PATTERNS) {
+            return 0;
+        }
+        if (explicitSlots) {
+            if (addSlot(&patterns[count], value, size, slotTaken) == 0) {
+                return 0;
+            }
+        } else {
+            if (value < 1 || value > PDB_MAX_PATTERN_TILES) {
+                return 0;
+            }
+            for (long i = 0; i < value; i++) {
+                if (addSlot(&patterns[count], nextSlot++, size, slotTaken) == 0) {
+                    return 0;
+                }
+            }
+        }
+        if (*end == (explicitSlots ? '/' : '-') || *end == '\0') {
+            patterns[count].rankCount = patternRankCount(size * size, patterns[count].tileCount);
+            count++;
+        } else if (*end != ',' || explicitSlots == 0) {
+            return 0;
+        }
+        cursor = (*end == '\0') ? end : end + 1;
+    }
+    for (int slot = 0; slot < (size * size) - 1; slot++) {
+        if (slotTaken[slot] == 0) {
+            return 0;
+        }
+    }
+    return count;
+}
+
+int main(int argc, char **argv) {
+    struct pdbHeader header;
+    struct pdbPattern patterns[PDB_MAX_PATTERNS];
+    if (argc != 4) {
+        fprintf(stderr, "usage: %s <board size> <partition, e.g. 6-6-3> <output file>\n", argv[0]);
+        return 1;
+    }
+    int size = atoi(argv[1]);
+    int patternCount = (size >= MIN_BOARD_SIZE && size <= MAX_PACKED_BOARD_SIZE)
+                       ? parsePartition(argv[2], size, patterns) : 0;
+    if (patternCount == 0) {
+        fprintf(stderr, "partition [%s] does not cover the %d tiles of a %dx%d board in patterns of at most %d\n",
+                argv[2], (size * size) - 1, size, size, PDB_MAX_PATTERN_TILES);
+        return 1;
+    }
+    FILE *filePtr = fopen(argv[3], "wb");
+    if (filePtr == NULL) {
+        perror("cannot create output file");
+        return 1;
+    }
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PDB_MAGIC, sizeof(header.magic));
+    header.version = PDB_VERSION;
+    header.boardSize = size;
+    header.patternCount = patternCount;
+    uint64_t offset = sizeof(header) + (patternCount * sizeof(struct pdbPattern));
+    for (int p = 0; p < patternCount; p++) {
+        offset = (offset + PDB_PAGE_SIZE - 1) / PDB_PAGE_SIZE * PDB_PAGE_SIZE;
+        patterns[p].offset = offset;
+        offset += patterns[p].rankCount * (patterns[p].tileCount + 1);
+    }
+    fwrite(&header, sizeof(header), 1, filePtr);
+    fwrite(patterns, sizeof(struct pdbPattern), patternCount, filePtr);
+    for (int p = 0; p < patternCount; p++) {
+        uint64_t entryCount = patterns[p].rankCount * (patterns[p].tileCount + 1);
+        size_t words = (patterns[p].rankCount + 63) / 64;
+        uint8_t *entries = malloc(entryCount);
+        uint8_t *distances = malloc(patterns[p].rankCount * size * size);
+        uint64_t *frontier[2] = {malloc(words * sizeof(uint64_t)), malloc(words * sizeof(uint64_t))};
+        if (entries == NULL || distances == NULL || frontier[0] == NULL || frontier[1] == NULL) {
+            fprintf(stderr, "not enough memory for a pattern of %u tiles\n", patterns[p].tileCount);
+            fclose(filePtr);
+            return 1;
+        }
+        fprintf(stderr, "pattern %d: %u tiles, %llu placements\n", p, patterns[p].tileCount,
+                (unsigned long long) patterns[p].rankCount);
+        for (uint32_t segment = 0; segment <= patterns[p].tileCount; segment++) {
+            searchSegment(entries, distances, frontier, &patterns[p], size, segment);
+        }
+        fseek(filePtr, patterns[p].offset, SEEK_SET);
+        fwrite(entries, 1, entryCount, filePtr);
+        free(entries);
+        free(distances);
+        free(frontier[0]);
+        free(frontier[1]);
+    }
+    if (fclose(filePtr) != 0) {
+        perror("cannot write output file");
+        return 1;
+    }
+    return 0;
+}
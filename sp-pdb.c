@@ -0,0 +1,149 @@
+/*
+ * Representing the pattern databases of "sliding puzzle" game
+ * Uses C99 standard
+ * Databases are built offline by sp-pdb-gen and mapped read-only at startup, so a heuristic lookup costs no parsing
+ * or building at all, and every process forked after the mapping shares the same pages.
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "sp-pdb.h"
+
+const struct patternDatabase *patternDatabases[MAX_PACKED_BOARD_SIZE + 1];
+
+/*
+ * Number of ways to place tileCount distinct tiles on cellCount cells, the size of one pattern's rank space.
+ */
+uint64_t patternRankCount(int cellCount, int tileCount) {
+    uint64_t count = 1;
+    for (int i = 0; i < tileCount; i++) {
+        count *= cellCount - i;
+    }
+    return count;
+}
+
+/*
+ * Perfect hash of the cells a pattern's tiles occupy, in the range 0 to patternRankCount() - 1.
+ * Each tile's cell is counted among the cells still free after the tiles before it, read as a mixed radix number.
+ * @param positions: cell of each pattern tile, in pattern order.
+ */
+uint64_t rankPattern(const uint8_t *positions, int tileCount, int cellCount) {
+    uint64_t rank = 0;
+    for (int i = 0; i < tileCount; i++) {
+        int digit = positions[i];
+        for (int j = 0; j < i; j++) {
+            if (positions[j] < positions[i]) {
+                digit--;
+            }
+        }
+        rank = (rank * (cellCount - i)) + digit;
+    }
+    return rank;
+}
+
+/*
+ * Exact reverse of rankPattern().
+ * @param positions: receives the cell of each pattern tile.
+ */
+void unrankPattern(uint64_t rank, uint8_t *positions, int tileCount, int cellCount) {
+    int digits[PDB_MAX_PATTERN_TILES];
+    uint8_t used[MAX_PACKED_BOARD_SIZE * MAX_PACKED_BOARD_SIZE] = {0};
+    for (int i = tileCount - 1; i >= 0; i--) {
+        digits[i] = rank % (cellCount - i);
+        rank /= (cellCount - i);
+    }
+    for (int i = 0; i < tileCount; i++) {
+        int cell = 0;
+        for (int skip = digits[i]; skip > 0 || used[cell]; cell++) {
+            if (used[cell] == 0) {
+                skip--;
+            }
+        }
+        used[cell] = 1;
+        positions[i] = cell;
+    }
+}
+
+/*
+ * Maps one database file read-only and registers it for its board size.
+ * The file is checked against what its header promises, a truncated or foreign file is never used.
+ * @param fileName: database written by sp-pdb-gen.
+ * @return: 1 if the database is now in use, 0 if the file is missing, not a valid database or memory ran out.
+ */
+int mapPatternDatabase(const char *fileName) {
+    struct stat fileStat;
+    struct pdbHeader header;
+    int fd = open(fileName, O_RDONLY);
+    if (fd == -1) {
+        return 0;
+    }
+    if (fstat(fd, &fileStat) == -1 || (size_t) fileStat.st_size < sizeof(header)) {
+        close(fd);
+        return 0;
+    }
+    const uint8_t *base = mmap(NULL, fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);//the mapping keeps the file open
+    if (base == MAP_FAILED) {
+        return 0;
+    }
+    memcpy(&header, base, sizeof(header));
+    int valid = memcmp(header.magic, PDB_MAGIC, sizeof(header.magic)) == 0 && header.version == PDB_VERSION
+                && header.boardSize >= MIN_BOARD_SIZE && header.boardSize <= MAX_PACKED_BOARD_SIZE
+                && header.patternCount >= 1 && header.patternCount <= PDB_MAX_PATTERNS
+                && sizeof(header) + (header.patternCount * sizeof(struct pdbPattern)) <= (size_t) fileStat.st_size;
+    struct patternDatabase *database = malloc(sizeof(struct patternDatabase));
+    if (database == NULL) {
+        munmap((void *) base, fileStat.st_size);
+        return 0;
+    }
+    uint8_t slotCovered[MAX_PACKED_BOARD_SIZE * MAX_PACKED_BOARD_SIZE] = {0};
+    int slotsCovered = 0;
+    int cellCount = header.boardSize * header.boardSize;
+    for (uint32_t p = 0; p < header.patternCount && valid; p++) {
+        struct pdbPattern *pattern = &database->patterns[p];
+        memcpy(pattern, base + sizeof(header) + (p * sizeof(struct pdbPattern)), sizeof(struct pdbPattern));
+        valid = pattern->tileCount >= 1 && pattern->tileCount <= PDB_MAX_PATTERN_TILES
+                && pattern->rankCount == patternRankCount(cellCount, pattern->tileCount)
+                && pattern->offset + (pattern->rankCount * (pattern->tileCount + 1)) <= (uint64_t) fileStat.st_size;
+        for (uint32_t i = 0; i < pattern->tileCount && valid; i++) {
+            valid = pattern->slots[i] < cellCount - 1 && slotCovered[pattern->slots[i]] == 0
+                    && (i == 0 || pattern->slots[i - 1] < pattern->slots[i]);
+            slotCovered[pattern->slots[i]] = 1;
+            slotsCovered++;
+        }
+    }
+    if (valid == 0 || slotsCovered != cellCount - 1) {
+        munmap((void *) base, fileStat.st_size);
+        free(database);
+        return 0;
+    }
+    database->base = base;
+    database->length = fileStat.st_size;
+    database->boardSize = header.boardSize;
+    database->patternCount = header.patternCount;
+    patternDatabases[header.boardSize] = database;
+    return 1;
+}
+
+/*
+ * Maps every database found for the playable board sizes, named sp-pdb-<size>.dat.
+ * They are looked for in the directory named by SP_PDB_DIR, or the current directory when it is not set.
+ * Sizes without a database simply solve on Manhattan distance and linear conflicts alone.
+ */
+void mapPatternDatabases() {
+    char fileName[4096];
+    const char *directory = getenv("SP_PDB_DIR");
+    if (directory == NULL) {
+        directory = ".";
+    }
+    for (int size = MIN_BOARD_SIZE; size <= MAX_PACKED_BOARD_SIZE; size++) {
+        snprintf(fileName, sizeof(fileName), "%s/sp-pdb-%d.dat", directory, size);
+        mapPatternDatabase(fileName);
+    }
+}
@@ -0,0 +1,68 @@
+/*
+ * Representing the pattern databases of "sliding puzzle" game
+ * Uses C99 standard
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#ifndef SP_PDB_H
+#define SP_PDB_H
+
+#include <stdint.h>
+#include "sp-protocol.h"
+
+#define PDB_MAGIC "SPPDB01"
+#define PDB_VERSION 1
+#define PDB_MAX_PATTERNS 16
+#define PDB_MAX_PATTERN_TILES 8
+#define PDB_UNREACHED 0xff
+
+/*
+ * A pattern is a set of tiles named by goal slot, slot being maxTileValue - tile, the cell a tile owns while the
+ * empty tile comes after it. A winning board can put the empty tile before, between or after the pattern's slots,
+ * which gives the pattern tileCount + 1 goal shapes, 'segment' j meaning the j lowest slots are kept and the other
+ * tiles sit one cell further on. Each rank of the pattern stores one distance per segment side by side,
+ * so a lookup for every shape at once touches a single cache line.
+ */
+struct pdbPattern {
+    uint32_t tileCount;
+    uint8_t slots[PDB_MAX_PATTERN_TILES];//ascending, tile i of a placement is the tile owning slots[i]
+    uint32_t reserved;
+    uint64_t offset;//bytes from the start of the file to this pattern's entries
+    uint64_t rankCount;
+};
+
+/*
+ * Leads the file, followed by patternCount pdbPattern records, then the entries, each pattern's page aligned.
+ */
+struct pdbHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t boardSize;
+    uint32_t patternCount;
+    uint32_t reserved;
+};
+
+/*
+ * A database mapped into memory, entries of pattern p start at base + patterns[p].offset.
+ */
+struct patternDatabase {
+    const uint8_t *base;
+    size_t length;
+    int boardSize;
+    int patternCount;
+    struct pdbPattern patterns[PDB_MAX_PATTERNS];
+};
+
+extern const struct patternDatabase *patternDatabases[MAX_PACKED_BOARD_SIZE + 1];
+
+uint64_t patternRankCount(int cellCount, int tileCount);
+
+uint64_t rankPattern(const uint8_t *positions, int tileCount, int cellCount);
+
+void unrankPattern(uint64_t rank, uint8_t *positions, int tileCount, int cellCount);
+
+int mapPatternDatabase(const char *fileName);
+
+void mapPatternDatabases();
+
+#endif
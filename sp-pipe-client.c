@@ -7,105 +7,287 @@
  * @version 3.0
  */
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
+#include "sp-protocol.h"
+#include "sp-pipe-io.h"
+#include "sp-shared.h"
 
-enum menuOptions {
-    print, save, load, new, move, noAction
+/*
+ * Prints one row of the board, every tile as wide as the largest one so the columns line up on any board size.
+ */
+void printRow(const uint32_t *tiles, int boardSize, int width) {
+    printf("|");
+    for (int j = 0; j < boardSize; j++) {
+        if (tiles[j] == EMPTY_TILE) {//no printing empty tile value
+            printf("%*c|", width, ' ');
+        } else {
+            printf("%*u|", width, tiles[j]);
+        }
+    }
+    printf("\n");
+}
+
+void printBorder(int boardSize, int width) {
+    for (int i = 0; i < (boardSize * (width + 1)) + 1; i++) {//boundary that scales. (nice little touch for U.I.)
+        printf("-");
+    }
+    printf("\n");
+}
+
+#define CHANGE_BATCH 256//changed cells taken in per read
+
+/*
+ * The client's own copy of the board, a print only brings the cells changed since, see sp-protocol.h.
+ */
+struct boardMirror {
+    uint32_t *tiles;//boardSize * boardSize tiles in row-major order, NULL before the first print
+    int boardSize;
+    int32_t game;//of the board in tiles, -1 while there is none the server could build on
+    int64_t boardVersion;
 };
 
 /*
- * Client function acts as middleman for user and server, process user inputs and return results
- * Straightforward design pattern any reasonable developer should know
- * @param: command is the command pipe created in main function, accessible to both client and server
- * @param: data is the data pipe created in main function, accessible to both client and server
+ * Sends one request in its frame and takes in the frame of the reply to it, the answer itself is left to the caller.
+ * The interactive client waits for every reply before the next prompt, the user needs the answer anyway.
+ * @param requestId: id of the last request sent, advanced here.
+ * @param arguments: 'length' bytes that go after the command.
+ * @return: 1 if the reply to this request is next in the stream, 0 if the server is gone or out of step.
+ */
+int askServer(int commandFd, struct replyReader *reader, uint32_t *requestId, int32_t command, const void *arguments,
+              size_t length) {
+    uint8_t request[sizeof(struct frameHeader) + sizeof(command) + sizeof(struct batchMoveRequest)];
+    struct frameHeader frame = {.length = sizeof(command) + length, .id = ++*requestId};
+    memcpy(request, &frame, sizeof(frame));
+    memcpy(request + sizeof(frame), &command, sizeof(command));
+    if (length > 0) {
+        memcpy(request + sizeof(frame) + sizeof(command), arguments, length);
+    }
+    ssize_t total = sizeof(frame) + frame.length;
+    if (write(commandFd, request, total) != total || readReply(reader, &frame, sizeof(frame)) == 0) {
+        return 0;
+    }
+    return frame.id == *requestId;
+}
+
+/*
+ * Asks the server for the board, telling it which one the client already holds.
+ * @return: 1 if the reply is next in the stream, 0 otherwise.
+ */
+int requestBoard(int commandFd, struct replyReader *reader, uint32_t *requestId, const struct boardMirror *mirror) {
+    uint8_t arguments[sizeof(mirror->game) + sizeof(mirror->boardVersion)];
+    memcpy(arguments, &mirror->game, sizeof(mirror->game));
+    memcpy(arguments + sizeof(mirror->game), &mirror->boardVersion, sizeof(mirror->boardVersion));
+    return askServer(commandFd, reader, requestId, print, arguments, sizeof(arguments));
+}
+
+/*
+ * Brings the mirror up to the board a snapshot header describes, from the tiles that follow the header.
+ * A mirror left half updated is dropped, the next print then asks for the whole board.
+ * @param header: already read and checked.
+ * @return: 1 if the mirror holds the board now, 0 if the tiles could not be read or make no sense.
+ */
+int updateMirror(struct replyReader *reader, struct boardMirror *mirror, const struct snapshotHeader *header) {
+    int cellCount = header->boardSize * header->boardSize;
+    int tileWidth = TILE_WIDTH(header->boardSize);
+    uint32_t pairs[2 * CHANGE_BATCH];
+    uint8_t *packed = (uint8_t *) pairs;//tiles a byte each are read in here and widened in place from the back
+    int isUpdated = 1;
+    if (header->changes == -1 && header->boardSize != mirror->boardSize) {
+        free(mirror->tiles);
+        mirror->tiles = malloc((size_t) cellCount * sizeof(uint32_t));
+        mirror->boardSize = (mirror->tiles != NULL) ? header->boardSize : 0;
+    }
+    if (header->changes == -1) {
+        isUpdated = mirror->tiles != NULL && readReply(reader, mirror->tiles, (size_t) cellCount * tileWidth);
+        packed = (uint8_t *) mirror->tiles;
+        for (int cell = cellCount - 1; isUpdated && tileWidth == 1 && cell >= 0; cell--) {
+            mirror->tiles[cell] = packed[cell];
+        }
+    } else if (header->game != mirror->game || header->boardSize != mirror->boardSize) {
+        isUpdated = 0;//changes to a board this client does not have, the server lost track
+    }
+    for (int done = 0; isUpdated && header->changes != -1 && done < header->changes; done += CHANGE_BATCH) {
+        int count = (header->changes - done < CHANGE_BATCH) ? header->changes - done : CHANGE_BATCH;
+        isUpdated = readReply(reader, pairs, (size_t) count * tileWidth * 2);
+        for (int i = (2 * count) - 1; isUpdated && tileWidth == 1 && i >= 0; i--) {
+            pairs[i] = packed[i];
+        }
+        for (int i = 0; isUpdated && i < count; i++) {
+            isUpdated = pairs[2 * i] < (uint32_t) cellCount;
+            if (isUpdated) {
+                mirror->tiles[pairs[2 * i]] = pairs[(2 * i) + 1];
+            }
+        }
+    }
+    mirror->game = isUpdated ? header->game : -1;
+    mirror->boardVersion = header->boardVersion;
+    return isUpdated;
+}
+
+/*
+ * Prints the board a row at a time, from the client's mirror once the server's answer is in, or straight out of
+ * the shared channel.
+ * The request must already have been sent when the board comes from the server.
+ * @param reader: where replies come in.
+ * @param channel: the shared channel to print from instead, or NULL.
+ * @param mirror: the board as the client last saw it, brought up to date first when the board comes from the server.
+ * @return: 1 if the whole board was printed, 0 if it could not be read.
+ */
+int printBoard(struct replyReader *reader, struct sharedChannel *channel, struct boardMirror *mirror) {
+    struct snapshotHeader header;
+    const uint32_t *tiles;
+    if (channel != NULL) {
+        readBoardHeader(channel, &header);
+    } else if (readReply(reader, &header, sizeof(header)) == 0) {
+        return 0;
+    }
+    int boardsize = header.boardSize;//need to find out the board size from server
+    if (header.version != SNAPSHOT_VERSION || boardsize < MIN_BOARD_SIZE || boardsize > MAX_BOARD_SIZE
+        || header.changes < -1 || header.changes >= boardsize * boardsize) {
+        return 0;
+    }
+    if (channel != NULL) {
+        tiles = channel->tiles;
+    } else if (updateMirror(reader, mirror, &header) == 0) {
+        return 0;
+    } else {
+        tiles = mirror->tiles;
+    }
+    int width = snprintf(NULL, 0, " %d", (boardsize * boardsize) - 1);
+    width = (width < 3) ? 3 : width;
+    printBorder(boardsize, width);
+    for (int i = 0; i < boardsize; i++) {
+        printRow(tiles + (i * boardsize), boardsize, width);
+    }
+    printBorder(boardsize, width);
+    printf("Moves made: %d, tiles out of place: %d, distance to solved: %d\n", header.moveCount,
+           header.misplacedTiles, header.manhattanDistance);
+    return 1;
+}
+
+/*
+ * Turns a line typed by the user into batch entries, tile values or U/D/L/R separated by spaces.
+ * @param line: the text to parse, tokenized in place.
+ * @param batch: receives the entries and their count.
+ * @return: 1 if every token was understood and there were at most MAX_BATCH_MOVES of them, 0 otherwise.
+ */
+int parseBatch(char *line, struct batchMoveRequest *batch) {
+    batch->count = 0;
+    for (char *token = strtok(line, " \t"); token != NULL; token = strtok(NULL, " \t")) {
+        int entry = 0;
+        if (batch->count == MAX_BATCH_MOVES) {
+            return 0;
+        }
+        if (strlen(token) == 1 && (token[0] == 'U' || token[0] == 'u')) {
+            entry = moveUp;
+        } else if (strlen(token) == 1 && (token[0] == 'D' || token[0] == 'd')) {
+            entry = moveDown;
+        } else if (strlen(token) == 1 && (token[0] == 'L' || token[0] == 'l')) {
+            entry = moveLeft;
+        } else if (strlen(token) == 1 && (token[0] == 'R' || token[0] == 'r')) {
+            entry = moveRight;
+        } else if (sscanf(token, "%d", &entry) != 1 || entry < 1) {
+            return 0;
+        }
+        batch->moves[batch->count] = entry;
+        batch->count++;
+    }
+    return 1;
+}
+
+/*
+ * Acts as middleman for user and server until the user quits, over any pair of descriptors.
+ * The pipe client passes its two pipe ends, the socket client passes the same socket twice.
+ * With a shared channel replies are read from it instead, and the board is printed straight from it without
+ * asking the server, so printing sends no request and gets no status word.
+ * Input that is not a command never reaches the server, the frames keep both sides in step without it.
+ * @param commandFd: requests go out here.
+ * @param dataFd: replies come in here.
+ * @param channel: shared mapping the server publishes to, NULL to read replies from dataFd.
  */
-void clientFunction(int *command, int *data) {
-    int commandPipe[2];
-    commandPipe[0] = *command;
-    commandPipe[1] = *(command + 1);
-    int dataPipe[2];
-    dataPipe[0] = *data;
-    dataPipe[1] = *(data + 1);
-    close(commandPipe[0]);
-    close(dataPipe[1]);
+void clientSession(int commandFd, int dataFd, struct sharedChannel *channel) {
+    int commandPipe[2] = {-1, commandFd};//only the ends this side uses
+    struct replyReader reader = {.fd = dataFd, .channel = channel, .server = getppid()};
+    struct boardMirror mirror = {.tiles = NULL, .boardSize = 0, .game = -1, .boardVersion = 0};
+    uint32_t requestId = 0;
+    int statusPending = 0;//the server speaks only when asked
+    int isConnected = 1;
     enum menuOptions menuCommand;
     char userInput;
     int isWon = 0;
-    int boardsize;
-    char fileName[99];
+    char fileName[FILE_NAME_LENGTH];
     int success = 0;
-    int newSize;
+    int32_t newSize;
+    struct batchMoveRequest batch;
+    struct batchMoveReply batchReply;
+    char batchLine[2048];
+    struct solveReply solveResult;
+    struct hintReply hintResult;
+    struct statsReply statsResult;
+    const char *commandNames[STATS_COMMANDS] = {"print", "save", "load", "new", "move", "batch", "solve", "undo", "redo", "stats", "hint"};
 
-    while (1) {
-        read(dataPipe[0], &isWon, sizeof(int));
+    while (isConnected) {
+        if (statusPending == 0) {
+            isWon = 0;//nothing was asked of the server, so nothing has changed
+        } else if (readReply(&reader, &isWon, sizeof(int)) == 0) {
+            isConnected = 0;
+            break;
+        }
+        statusPending = 1;
         if (isWon == 1) {
             printf("YOU WON THE GAME!!!\n");
             printf("Starting a new game of default size...\n");
         }
-        printf("Menu: [p]rint, [q]uit, [s]ave, [l]oad, [n]ew, [m]ove\n");
+        printf("Menu: [p]rint, [q]uit, [s]ave, [l]oad, [n]ew, [m]ove, [b]atch move, [u]ndo, [r]edo, s[o]lve, [h]int, s[t]ats\n");
         fflush(stdin);//clear out anything left over
         scanf("%c", &userInput);
         if (userInput == 'p') {
             menuCommand = print;
-            write(commandPipe[1], &menuCommand, sizeof(menuCommand));
-            read(dataPipe[0], &boardsize, sizeof(boardsize));//need to find out the board size from server
-            for (int i = 0; i < (boardsize * 4) + 1; i++) { //Top boundary that scales. (nice little touch for U.I.)
-                printf("-");
-            }
-            printf("\n");
-            for (int i = 0; i < boardsize; i++) {
-                printf("|");
-                for (int j = 0; j < boardsize; j++) {
-                    int currentTileValue;
-                    read(dataPipe[0], &currentTileValue, sizeof(int));//read over each character, synced up perfectly
-                    if (currentTileValue == -1) {//no printing empty tile value
-                        printf("%3c|", ' ');
-                    } else {
-                        printf("%3d|", currentTileValue);
-                    }
+            if (channel != NULL && __atomic_load_n(&channel->boardSequence, __ATOMIC_ACQUIRE) != 0) {
+                statusPending = 0;//read from the channel, the server is never asked
+            } else if (channel != NULL) {
+                if (askServer(commandPipe[1], &reader, &requestId, noAction, NULL, 0) == 0) {
+                    isConnected = 0;//nothing published before the first reply, a request that does nothing brings it
+                    break;
                 }
-                printf("\n");
+            } else if (requestBoard(commandPipe[1], &reader, &requestId, &mirror) == 0) {
+                isConnected = 0;
+                break;
             }
-            for (int i = 0; i < (boardsize * 4) + 1; i++) {//Matching bottom boundary.
-                printf("-");
+            if (printBoard(&reader, channel, &mirror) == 0) {
+                printf("Failed to read the board from the server\n");
+                break;//the rest of the reply cannot be found in the stream any more
             }
-            printf("\n");
         } else if (userInput == 'q') {
             printf("Quitting the game...\n");//don't need menu command for quite, not sending it over
-            close(commandPipe[1]);//rely on closing pipe to notify server of quitting
-            close(dataPipe[0]);
-            break;
-        } else if (userInput == 's') {
-            menuCommand = save;
-            write(commandPipe[1], &menuCommand, sizeof(menuCommand));
-            printf("Enter file name to save..\n");
-            scanf("%s", fileName);
-            write(commandPipe[1], &fileName, sizeof(fileName));
-            read(dataPipe[0], &success, sizeof(success));
-            if (success == 1) {
-                printf("File [%s] saved successfully\n", fileName);
-            } else {
-                printf("Failed to save file [%s]\n", fileName);
-            }
-        } else if (userInput == 'l') {
-            menuCommand = load;
-            write(commandPipe[1], &menuCommand, sizeof(menuCommand));
-            printf("Enter file name to load..\n");
-            scanf("%s", fileName);
-            write(commandPipe[1], &fileName, sizeof(fileName));
-            read(dataPipe[0], &success, sizeof(success));
+            break;//the caller closes the connection, which is what tells the server
+        } else if (userInput == 's' || userInput == 'l') {
+            menuCommand = (userInput == 's') ? save : load;
+            printf((menuCommand == save) ? "Enter file name to save..\n" : "Enter file name to load..\n");
+            memset(fileName, 0, sizeof(fileName));
+            scanf("%98s", fileName);
+            if (askServer(commandPipe[1], &reader, &requestId, menuCommand, fileName, sizeof(fileName)) == 0
+                || readReply(&reader, &success, sizeof(success)) == 0) {
+                isConnected = 0;
+                break;
+            }
             if (success == 1) {
-                printf("File [%s] loaded successfully\n", fileName);
+                printf((menuCommand == save) ? "File [%s] saved successfully\n" : "File [%s] loaded successfully\n",
+                       fileName);
             } else {
-                printf("Failed to load file [%s]\n", fileName);
+                printf((menuCommand == save) ? "Failed to save file [%s]\n" : "Failed to load file [%s]\n", fileName);
             }
         } else if (userInput == 'n') {
             menuCommand = new;
-            write(commandPipe[1], &menuCommand, sizeof(menuCommand));
             printf("Enter a size for a new board...\n");
             scanf("%d", &newSize);
-            write(commandPipe[1], &newSize, sizeof(newSize));
-            read(dataPipe[0], &success, sizeof(success));
+            if (askServer(commandPipe[1], &reader, &requestId, menuCommand, &newSize, sizeof(newSize)) == 0
+                || readReply(&reader, &success, sizeof(success)) == 0) {
+                isConnected = 0;
+                break;
+            }
             if (success == 1) {
                 printf("New game of size [%d] was successful\n", newSize);
             } else {
@@ -113,21 +295,135 @@ void clientFunction(int *command, int *data) {
             }
         } else if (userInput == 'm') {
             menuCommand = move;
-            write(commandPipe[1], &menuCommand, sizeof(menuCommand));
             printf("Enter a tile value to move...\n");
-            int tileToMove = 0;
+            int32_t tileToMove = 0;
             scanf("%d", &tileToMove);
-            write(commandPipe[1], &tileToMove, sizeof(tileToMove));
-            read(dataPipe[0], &success, sizeof(success));
+            if (askServer(commandPipe[1], &reader, &requestId, menuCommand, &tileToMove, sizeof(tileToMove)) == 0
+                || readReply(&reader, &success, sizeof(success)) == 0) {
+                isConnected = 0;
+                break;
+            }
             if (success == 1) {
                 printf("Tile [%d] has been moved\n", tileToMove);
             } else {
                 printf("Failed to move tile [%d]\n", tileToMove);
             }
+        } else if (userInput == 'b') {
+            printf("Enter tile values or U/D/L/R directions separated by spaces...\n");
+            scanf(" %2047[^\n]", batchLine);
+            if (parseBatch(batchLine, &batch) == 0) {
+                statusPending = 0;//nothing goes to the server for a line we cannot parse
+                printf("Failed to read moves, at most %d tile values or U/D/L/R allowed\n", MAX_BATCH_MOVES);
+                continue;
+            }
+            menuCommand = moveBatch;
+            size_t batchLength = sizeof(batch.count) + (batch.count * sizeof(int32_t));
+            if (askServer(commandPipe[1], &reader, &requestId, menuCommand, &batch, batchLength) == 0
+                || readReply(&reader, &batchReply, sizeof(batchReply)) == 0) {
+                isConnected = 0;
+                break;
+            }
+            int applied = 0;
+            for (int i = 0; i < batchReply.processed; i++) {
+                if (batchReply.movedBitmap[i / 8] & (1 << (i % 8))) {
+                    applied++;
+                } else {
+                    printf("Move %d of the batch was rejected\n", i + 1);
+                }
+            }
+            printf("Applied %d of %d moves\n", applied, batch.count);
+            if (batchReply.isWon == 1 && batchReply.processed < batch.count) {
+                printf("Board solved after move %d, the rest of the batch was skipped\n", batchReply.processed);
+            }
+        } else if (userInput == 'o') {
+            menuCommand = solve;
+            printf("Searching for the shortest solution...\n");
+            if (askServer(commandPipe[1], &reader, &requestId, menuCommand, NULL, 0) == 0
+                || readReply(&reader, &solveResult, sizeof(solveResult)) == 0) {
+                isConnected = 0;
+                break;
+            }
+            if (solveResult.status == 1) {
+                printf("Solvable in %d moves:", solveResult.length);
+                for (int i = 0; i < solveResult.length; i++) {
+                    printf(" %d", solveResult.moves[i]);
+                }
+                printf("\n");
+            } else if (solveResult.status == 0) {
+                printf("This board cannot be won\n");
+            } else {
+                printf("Gave up searching, this board is too hard to solve\n");
+            }
+            printf("Expanded %lld nodes in %.3f seconds (%lld nodes/s)\n", (long long) solveResult.nodesExpanded,
+                   solveResult.elapsedMicros / 1e6, (long long) solveResult.nodesPerSecond);
+        } else if (userInput == 'h') {
+            menuCommand = hint;
+            if (askServer(commandPipe[1], &reader, &requestId, menuCommand, NULL, 0) == 0
+                || readReply(&reader, &hintResult, sizeof(hintResult)) == 0) {
+                isConnected = 0;
+                break;
+            }
+            if (hintResult.status == 1 && hintResult.distance == 0) {
+                printf("The board is already solved\n");
+            } else if (hintResult.status == 1) {
+                printf("Move tile [%d], the board is then %d moves from solved%s\n", hintResult.tile,
+                       hintResult.distance - 1, hintResult.fromCache ? " (remembered)" : "");
+            } else if (hintResult.status == 0) {
+                printf("This board cannot be won\n");
+            } else {
+                printf("No hint, this board is too hard to solve\n");
+            }
+        } else if (userInput == 'u' || userInput == 'r') {
+            menuCommand = (userInput == 'u') ? undo : redo;
+            if (askServer(commandPipe[1], &reader, &requestId, menuCommand, NULL, 0) == 0
+                || readReply(&reader, &success, sizeof(success)) == 0) {
+                isConnected = 0;
+                break;
+            }
+            if (success == 1) {
+                printf((menuCommand == undo) ? "Last move taken back\n" : "Move made again\n");
+            } else {
+                printf((menuCommand == undo) ? "No move to take back\n" : "No move to make again\n");
+            }
+        } else if (userInput == 't') {
+            menuCommand = stats;
+            if (askServer(commandPipe[1], &reader, &requestId, menuCommand, NULL, 0) == 0
+                || readReply(&reader, &statsResult, sizeof(statsResult)) == 0) {
+                isConnected = 0;
+                break;
+            }
+            printf("%-8s %10s %12s %12s %12s\n", "command", "count", "p50 (us)", "p99 (us)", "max (us)");
+            for (int i = 0; i < STATS_COMMANDS; i++) {
+                const struct latencySummary *summary = &statsResult.latency[i];
+                printf("%-8s %10llu %12.1f %12.1f %12.1f\n", commandNames[i], (unsigned long long) summary->count,
+                       summary->p50 / 1e3, summary->p99 / 1e3, summary->max / 1e3);
+            }
+            printf("Moves %llu, rejected %llu, games started %llu, bytes received %llu, sent %llu\n",
+                   (unsigned long long) statsResult.moves, (unsigned long long) statsResult.rejectedMoves,
+                   (unsigned long long) statsResult.gamesStarted, (unsigned long long) statsResult.bytesReceived,
+                   (unsigned long long) statsResult.bytesSent);
         } else {
-            menuCommand = noAction; //keep pipes in sync when given bad input
-            write(commandPipe[1], &menuCommand, sizeof(menuCommand));
+            statusPending = 0;//bad input is never sent, nothing comes back for it
             printf("Enter a valid command...\n");
         }
     }
-}
\ No newline at end of file
+    if (isConnected == 0) {
+        printf("Lost the connection to the server\n");
+    }
+    free(mirror.tiles);
+}
+
+/*
+ * Client function acts as middleman for user and server, process user inputs and return results
+ * Straightforward design pattern any reasonable developer should know
+ * @param: command is the command pipe created in main function, accessible to both client and server
+ * @param: data is the data pipe created in main function, accessible to both client and server
+ * @param channel: shared mapping created in main function that replies come from instead of the data pipe, or NULL.
+ */
+void clientFunction(int *command, int *data, struct sharedChannel *channel) {
+    close(command[0]);
+    close(data[1]);
+    clientSession(command[1], data[0], channel);
+    close(command[1]);//rely on closing pipe to notify server of quitting
+    close(data[0]);
+}
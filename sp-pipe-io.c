@@ -0,0 +1,27 @@
+/*
+ * Representing the pipe helpers shared by client and server side of "sliding puzzle" game
+ * Uses C99 standard
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#include <unistd.h>
+#include "sp-pipe-io.h"
+
+/*
+ * Keeps reading until the full amount asked for has arrived, larger or variable length messages may come in pieces.
+ * @param fd: the read end of a pipe.
+ * @param buffer: receives exactly length bytes.
+ * @param length: number of bytes the message is known to have.
+ * @return: 1 when all bytes were read, 0 if the pipe closed first.
+ */
+int readFully(int fd, void *buffer, size_t length) {
+    size_t received = 0;
+    while (received < length) {
+        ssize_t count = read(fd, (char *) buffer + received, length - received);
+        if (count <= 0) {
+            return 0;
+        }
+        received += count;
+    }
+    return 1;
+}
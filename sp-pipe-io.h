@@ -0,0 +1,14 @@
+/*
+ * Representing the pipe helpers shared by client and server side of "sliding puzzle" game
+ * Uses C99 standard
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#ifndef SP_PIPE_IO_H
+#define SP_PIPE_IO_H
+
+#include <stddef.h>
+
+int readFully(int fd, void *buffer, size_t length);
+
+#endif
@@ -6,367 +6,117 @@
  * @author Jesse Clegg
  * @version 3.0
  */
+#include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
-#include <time.h>
-#include <math.h>
-
-enum menuOptions {
-    print, save, load, new, move, noAction
-};
-
-const int emptyTileValue = -1;
-int **board = NULL;
-int boardSize;
-int rows;
-int cols;
-int maxTileValue;
-int randomPool[99];
-int gamesPlayed = 0;
-int isLoadingGame = 0;
-int location[2];//stores i and j location of a desired value found with searchBoard() at indices [0] and [1] respectively.
-
-/*
- * A function to save a current game board into a file, creates new or overwrites to avoid conflicts with existing files
- * saved in %2d, as a valid board will never have 3 digit tile value, delimited by spaces for readability/testing.
- * @param fileName: this will be the name of your save file created if successful.
- * @return: 0 if the file fails to save, 1 if successful.
- */
-int saveGame(char *fileName) {
-    int wasSuccessful = 0;
-    FILE *filePtr;
-    filePtr = fopen(fileName, "w");
-    if (filePtr == NULL) {
-        wasSuccessful = 0;
-        return wasSuccessful;
-    } else {
-        wasSuccessful = 1;
-        int currentTileValue;
-        for (int i = 0; i < boardSize; i++) {
-            for (int j = 0; j < boardSize; j++) {
-                currentTileValue = (board[i])[j];
-                fprintf(filePtr, "%2d ", currentTileValue);
-            }
+#include "sp-protocol.h"
+#include "sp-game.h"
+#include "sp-journal.h"
+#include "sp-session.h"
+#include "sp-shared.h"
+#include "sp-stats.h"
+
+#define PIPE_CHUNK_BYTES 65536//requests are read and replies written up to this many bytes at a time
+
+/*
+ * Sends a reply down the data pipe, the tiles of a print streamed between its two parts, see struct tileStream.
+ * The pipe gets PIPE_CHUNK_BYTES at a time, the client prints what it has while the server waits to send more.
+ * With a shared channel the reply is published there together with the board, the tiles of a print are the
+ * published ones and do not travel with the reply. The reply before it has to be read first, a client with
+ * several requests on the way is answered as fast as it reads.
+ * @param tiles: NULL or the tiles processRequest() left out of the reply.
+ * @return: bytes sent.
+ */
+size_t sendReply(int fd, struct sharedChannel *channel, const struct game *game, const uint8_t *reply, size_t length,
+                 struct tileStream *tiles) {
+    uint8_t chunk[PIPE_CHUNK_BYTES];
+    if (channel != NULL) {
+        if (awaitConsumed(channel, fd) == 0) {
+            return 0;
         }
-        fclose(filePtr);
-        return wasSuccessful;
-    }
-}
-
-/*
- * Populates a global array 'randomPool' filled with each tile value required for the new board being constructed.
- * The [0] index is always the empty tile value, each value is the same as its index location,
- * because of this empty tile offset.
- * Given a fixed upper bound of tiles, and the way the pool will be accessed, there is no need to wipe any old values
- * that are greater than the upper bounds of the new board being currently constructed.
- * To do so would be computationally wasteful
- */
-void fillRandomPool() {
-    srand(time(NULL));
-    randomPool[0] = -1;
-    for (int i = 1; i < (maxTileValue + 1); i++) {
-        randomPool[i] = i;
+        publishBoard(channel, game);
+        publishReply(channel, reply, length);
+        return length;
     }
-}
-
-/*
- * A random index location in the global array is selected and returned.
- * Using '% (maxTileValue + 1)' forces this index location to fall within the bounds of possible tile values for the current board.
- * Once an index has been selected and the value read, that index is set to 0 to prevent duplicate values being returned.
- * @return the integer value stored at the random index in global array 'randomPool'.
- */
-int retrieveRandomValue() {
-    int valueFound;
-    int index = ((rand()) % (maxTileValue + 1));
-    valueFound = randomPool[index];
-    if (valueFound == 0) {
-        return valueFound;
-    } else {
-        randomPool[index] = 0;
-        return valueFound;
+    if (tiles == NULL || tiles->cellCount == 0) {
+        ssize_t sent = write(fd, reply, length);
+        return (sent > 0) ? sent : 0;
     }
-}
-
-/*
- * Allows for direct access of a single tile on the board, makes for cleaner access when swapping.
- * @param i: the i location of this element to be changed.
- * @param j: the j location of this element to be changed.
- * @param value: this is the value that tile located at i,j will be changed to.
- */
-void setOneTile(int i, int j, int value) {
-    (board[i])[j] = value;
-}
-
-/*
- * Randomly assigns appropriate values to a game board scaled by global variable 'boardSize'.
- * Walks each "index" of this board and at every location, a call is made to retrieveRandomValue(), which returns
- * a random value, or 0. 0's are rejected, and the call is repeated until a nonzero value is returned.
- * That nonzero value is then assigned to the current index i,j.
- * This must be done to prevent repeat values.
- * Then we advance to the next index and repeat until all indices are filled.
- */
-void setAllTiles() {
-    fillRandomPool();
-    int candidate = 1;
-    for (int i = 0; i < boardSize; i++) {
-        for (int j = 0; j < boardSize; j++) {
-            do {
-                candidate = retrieveRandomValue();
-            } while (candidate == 0);
-            (board[i])[j] = candidate;
+    size_t tail = length - tiles->offset;//the status word
+    size_t used = tiles->offset;
+    int isDone = 0;
+    int wasSent = 1;
+    memcpy(chunk, reply, used);
+    while (wasSent && isDone == 0) {//a small board goes out in one write(), head, tiles and status word together
+        used += streamTiles(game, tiles, chunk + used, sizeof(chunk) - used);
+        if (tiles->nextCell == tiles->cellCount && used + tail <= sizeof(chunk)) {
+            memcpy(chunk + used, reply + tiles->offset, tail);
+            used += tail;
+            isDone = 1;
         }
+        wasSent = write(fd, chunk, used) == (ssize_t) used;
+        used = 0;
     }
+    return wasSent ? length + streamLength(tiles) : 0;
 }
 
 /*
- * Sets and scales dimensions for the board in relation to a newSize passed in.
- * Necessary to allow all other functions to operate with the scale of this new size.
- * @param newSize: this is the size of the new board that all values will be set in relation to.
- */
-void setBoardSizeAndValues(int newSize) {
-    boardSize = newSize;
-    rows = boardSize;
-    cols = boardSize;
-    maxTileValue = (boardSize * boardSize) - 1;
-}
-
-/*
- * Frees all memory of the current board.
- * Must walk the outer array of pointers in order to free each pointer contained inside.
- */
-void freeBoardMemory() {
-    for (int i = 0; i < rows; i++) {
-        free(*(board + i));
-    }
-    free(board);
-}
-
-/*
- * Ends the current game, informs the user.
- * Must call freeBoardMemory() in order to free up dynamically allocated memory allotted to the game we are ending.
+ * Sends the replies collected so far in one write(), once every move they answer is in the journal.
+ * @return: bytes sent.
  */
-void tearDown() {
-    freeBoardMemory();
-}
-
-/*
- * Dynamically allocates memory for a board in relation to global 'boardSize'.
- * Must be dynamically allocated to scale in demand of unknown board sizes.
- * Here we do the hard work up front with the allocation of an array of pointers, this provides easier access later on.
- */
-void allocateMemory() {
-    board = (int **) malloc(rows * sizeof(int *));
-    for (int i = 0; i < rows; i++) {
-        *(board + i) = (int *) malloc(cols * sizeof(int));
-    }
-}
-
-/*
- * Starts a new game of size specified by input param.
- * Reject boards greater than 9, or less than 3, "between 2-10" interpreted as 2-10 non-inclusive.
- * Frees up previously allocated memory if applicable, and offers a different prompt whether call is for:
- *  -The first game played for this session
- *  -New game being created
- *  -Loading an existing game
- * Global board dimensions are established in relation to this new board, memory is allocated,
- * and appropriate values are assigned whether loading or randomizing a new game.
- * Decisions made within the function allow reuse of the same initialization() function in all applicable situations.
- * @param sizeOfNewBoard: this is the size of the new board that all above operations will be in relation to.
- */
-int initialize(int sizeOfNewBoard) {
-    if (sizeOfNewBoard > 9 || sizeOfNewBoard < 3) {
+size_t sendReplies(int fd, struct journal *journal, const uint8_t *replies, size_t length) {
+    if (length == 0) {
         return 0;
     }
-    tearDown();
-    setBoardSizeAndValues(sizeOfNewBoard);
-    allocateMemory();
-    if (isLoadingGame != 1) {
-        setAllTiles();
-    }
-    isLoadingGame = 0;
-    gamesPlayed++;
-    return 1;
-}
-
-/*
- * A function to determine the number of tiles in a board to be loaded.
- * This information is needed to see if we reject a board to load or not.
- * Capable of reading any reasonable AND COMPATIBLE board file because of dynamic allocation.
- * @param fileName: This file name will be looked for in the current directory, then loaded if possible.
- * @return: 0 if the file is not present, else return the number of tiles in this file.
- */
-int loadBoardSize(char *fileName) {
-    int sizeTracker = 0;
-    char *tempArray;
-    tempArray = malloc(999 * sizeof(int));
-    FILE *filePtr = fopen(fileName, "r");
-    if (filePtr == NULL) {
-        sizeTracker = -1;
-        fclose(filePtr);
-        free(tempArray);
-        return sizeTracker;
-    } else {
-        while (!feof(filePtr)) {
-            fscanf(filePtr, "%s", tempArray);
-            sizeTracker++;
-        }
-        fclose(filePtr);
-        free(tempArray);//Releases memory after closing the file.
-        sizeTracker--; //SizeTracker result is one bigger than the actual number, so we decrement.
-        return sizeTracker;
-    }
-}
-
-/*
- * Evaluate a given fileName to see if compatible.
- * Must check if the game is a valid size.
- * If file is valid, initialize a new game with the board size needed, then load all values into board.
- * Must set global flag isLoadingGame to true, so we do not fill with random values.
- * Resumes current game if loadGame() fails.
- * @return: 1 for successful loading, 0 if error.
- */
-int loadGame(char *fileName) {
-    int wasSuccessful = 0;
-    int size = loadBoardSize(fileName);
-    if (size == -1) {
-        wasSuccessful = 0;
-        return wasSuccessful;
-    } else {
-        wasSuccessful = 1;
-        FILE *filePtr;
-        filePtr = fopen(fileName, "r");
-        size = (int) sqrt(size);
-        isLoadingGame = 1;
-        initialize(size);
-        for (int i = 0; i < boardSize; i++) {
-            for (int j = 0; j < boardSize; j++) {
-                fscanf(filePtr, "%3d", &(board[i])[j]);
-            }
-        }
-        fclose(filePtr);
-        return wasSuccessful;
-    }
-}
-
-/*
- * Function that walks each tile in the board and compares that tile to a desired value.
- * If value is found, the i and j locations are stored in global location array, indices [0] and [1] respectively.
- * @param desiredValue: every tile on board will be checked against this value.
- */
-void searchBoard(int desiredValue) {
-    int currentTile = 0;
-    for (int i = 0; i < boardSize; i++) {
-        for (int j = 0; j < boardSize; j++) {
-            currentTile = (board[i])[j];
-            if (currentTile == desiredValue) {
-                location[0] = i;
-                location[1] = j;
-                return;
-            }
-        }
-    }
-}
-
-/*
- * Evaluates if a given tile can be moved based its location in relation to the empty tile.
- * Limits possible tiles to evaluate based on the tile values currently present on the board.
- * searchBoard() is critical to retrieve the i and j location of tile values, as movement is determined by the tile.
- * position represented by those i and j values which are stored in the global array 'location' after each search.
- * Only need two checks: up/down and left/right, this is more efficient than checking all 4 directions separately.
- * Does not follow a typical cartesian plane, but the i and j could be understood as x and y if that aids in reading:
- *  - i = y coordinate
- *  - j = x coordinate
- * @param tileToCheck: this value will be located if on the board, and checked if it is located next to the empty tile.
- * @return: 1 if the tile to check is eligible to move, 0 if the move is not valid.
- */
-int isMoveValid(int tileToCheck) {
-    int valid = 0;
-    if (tileToCheck < 1 || tileToCheck > maxTileValue) {
-        return valid;
+    flushJournal(journal);//a move the client has seen is a move that is recorded
+    ssize_t sent = write(fd, replies, length);
+    return (sent > 0) ? sent : 0;
+}
+
+/*
+ * Names the journal file of this player's game in SP_JOURNAL_DIR, sp-game-<session>.spj, so games played side by
+ * side never share one and a restarted game only ever picks up its own.
+ * The session is SP_SESSION when it is set, otherwise the user and the terminal the game runs in, so starting the
+ * game again in the same terminal carries on the game that died there. Without a terminal the process id is used,
+ * such a journal still keeps every move safe but is not looked for again.
+ * Anything but letters, digits, '-' and '_' in the session becomes '_'.
+ */
+void nameJournal(char *fileName, size_t capacity, const char *directory) {
+    char session[256];
+    const char *terminal = ttyname(STDIN_FILENO);
+    if (getenv("SP_SESSION") != NULL) {
+        snprintf(session, sizeof(session), "%s", getenv("SP_SESSION"));
+    } else if (terminal != NULL) {
+        snprintf(session, sizeof(session), "uid%u%s", (unsigned) getuid(), terminal);
     } else {
-        searchBoard(tileToCheck);
-        int tileToMoveI = location[0];
-        int tileToMoveJ = location[1];
-        searchBoard(emptyTileValue);
-        int emptyTileI = location[0];
-        int emptyTileJ = location[1];
-        if ((tileToMoveI == (emptyTileI + 1) || tileToMoveI == (emptyTileI - 1)) &&
-            emptyTileJ == tileToMoveJ) {//Tile is above or below
-            valid = 1;
-            return valid;
-        }
-        if ((tileToMoveJ == (emptyTileJ + 1) || tileToMoveJ == (emptyTileJ - 1)) &&
-            emptyTileI == tileToMoveI) {//Tile is left or right
-            valid = 1;
-            return valid;
-        } else {
-            valid = 0;
-            return valid;
-        }
+        snprintf(session, sizeof(session), "pid%ld", (long) getpid());
     }
-}
-
-/*
- * Prompts for a tile to move
- * Must make use of isMoveValid() to determine whether to perform a swap, no internal evaluation.
- * Rejects bad moves and continues game, performs valid moves by swapping the tile values.
- * Relies on setOneTile() for the actual swap as there is no internal swapping functionality.
- * No explicit need for a success flag 'wasMoved', but one is included for future iterations/versions.
- * @return: 1 on success, 0 on a rejected move.
- */
-int moveTile(int desiredValue) {
-    int wasMoved = 0;
-    if (isMoveValid(desiredValue)) {
-        int temp[2];
-        searchBoard(desiredValue);
-        temp[0] = location[0];
-        temp[1] = location[1];
-        searchBoard(emptyTileValue);
-        setOneTile(location[0], location[1], desiredValue);
-        setOneTile(temp[0], temp[1], emptyTileValue);
-        wasMoved = 1;
-        return wasMoved;
-    } else {
-        return wasMoved;
+    for (char *c = session; *c != '\0'; c++) {
+        int isKept = (*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || (*c >= '0' && *c <= '9') || *c == '-';
+        *c = isKept ? *c : '_';
     }
-}
-
-
-/*
- * Starts with index of 0,0 and walks board in appropriate order.
- * As long as next tile is one greater than current.
- * or next tile is the empty tile, game is won.
- * Needs to consider empty tile in any possible location, so we use the logical || when walking board.
- * @return: 1 on a winning board, else return 0.
- */
-int isWon() {
-    int index = 0;
-    int currentTileValue;
-    int expectedValue = (boardSize * boardSize) - 1;
-    for (int i = 0; i < boardSize; i++) {
-        for (int j = 0; j < boardSize; j++) {
-            currentTileValue = (board[i])[j];
-            index++;
-            if (currentTileValue == expectedValue || currentTileValue == -1) {// -1 is empty tile representation
-                if (currentTileValue != -1) {
-                    expectedValue--;
-                }
-            } else {
-                return 0;
-            }
-        }
-    }
-    return 1;
+    snprintf(fileName, capacity, "%s/sp-game-%s.spj", directory, session);
 }
 
 /*
  * Server side receives commands from client, performs all computations and returns the results via pipes
  * Straightforward design pattern any reasonable developer should know
+ * Takes in whatever the client has sent so far and answers every complete request in it, see requestLength(),
+ * leaving their meaning to processRequest(). The replies go back together in one write(), so a client that keeps
+ * many requests on the way costs one read() and one write() per batch of them rather than per request.
+ * A frame too long to be a request is answered by rejectRequest() and ends the game like a client that quits.
+ * Statistics are written out when the client goes away, see dumpStats().
+ * With SP_JOURNAL_DIR set every move is journaled to a file there named for the session, see nameJournal(), and a
+ * server started after one that died picks up its game from that journal. A client that quits ends the game for
+ * good and the journal goes with it. While the client is quiet the server waits no longer than it takes for the
+ * last moves to be due for a sync, see journalSyncDelay().
  * @param: command is the command pipe created in main function, accessible to both client and server
  * @param: data is the data pipe created in main function, accessible to both client and server
+ * @param channel: shared mapping created in main function that replies go to instead of the data pipe, or NULL.
  */
-void serverFunction(int *command, int *data) {
+void serverFunction(int *command, int *data, struct sharedChannel *channel) {
     int commandPipe[2];
     commandPipe[0] = *command;
     commandPipe[1] = *(command + 1);
@@ -375,56 +125,69 @@ void serverFunction(int *command, int *data) {
     dataPipe[1] = *(data + 1);
     close(commandPipe[1]);
     close(dataPipe[0]);
-    enum menuOptions recieved;
-    int winningGame;
-    int hasQuit;
-    int successful;
-    int tileToMove;
-    int newSize;
-    char fileName[99];
-
-    initialize(4);
-    while (1) {
-        winningGame = isWon();
-        write(dataPipe[1], &winningGame, sizeof(int));
-        if (winningGame == 1) {
-            initialize(4);
+    struct game game = {0};
+    struct journal journal;
+    char journalName[4096];
+    const char *journalDirectory = getenv("SP_JOURNAL_DIR");
+    uint8_t input[PIPE_CHUNK_BYTES];
+    uint8_t output[PIPE_CHUNK_BYTES];
+    size_t inputLength = 0;
+    size_t outputLength = 0;
+    struct tileStream tiles;
+    long needed = 0;
+
+    if (journalDirectory != NULL) {
+        nameJournal(journalName, sizeof(journalName), journalDirectory);
+    }
+    if (openJournal(&journal, (journalDirectory != NULL) ? journalName : NULL, &game) == 0) {
+        initialize(&game, DEFAULT_BOARD_SIZE);
+        checkpointJournal(&journal, &game);
+    }
+    game.journal = &journal;
+    countGames(1);
+    while (needed != -1) {
+        struct pollfd waiting = {.fd = commandPipe[0], .events = POLLIN};
+        if (poll(&waiting, 1, journalSyncDelay(&journal)) == 0) {
+            flushJournal(&journal);
+            continue;
         }
-        hasQuit = read(commandPipe[0], &recieved, sizeof(recieved));
-        if (hasQuit == 0) {
-            break;
+        ssize_t count = read(commandPipe[0], input + inputLength, sizeof(input) - inputLength);
+        if (count <= 0) {
+            break;//client quit
         }
-        if (recieved == print) {
-            write(dataPipe[1], &boardSize, sizeof(boardSize));
-            for (int i = 0; i < boardSize; i++) {
-                for (int j = 0; j < boardSize; j++) {
-                    int currentTileValue;
-                    currentTileValue = (board[i])[j];
-                    write(dataPipe[1], &currentTileValue,
-                          sizeof(int));//write each element over to client, perfectly synced
-                }
+        inputLength += count;
+        size_t used = 0;
+        while ((needed = requestLength(input + used, inputLength - used)) != -1
+               && (size_t) needed <= inputLength - used) {
+            if (sizeof(output) - outputLength < MAX_REPLY_LENGTH) {
+                countTraffic(0, sendReplies(dataPipe[1], &journal, output, outputLength));
+                outputLength = 0;
             }
-        } else if (recieved == save) {
-            read(commandPipe[0], &fileName, sizeof(fileName));
-            successful = saveGame(fileName);
-            write(dataPipe[1], &successful, sizeof(successful));
-        } else if (recieved == load) {
-            read(commandPipe[0], &fileName, sizeof(fileName));
-            successful = loadGame(fileName);
-            write(dataPipe[1], &successful, sizeof(successful));
-        } else if (recieved == new) {
-            read(commandPipe[0], &newSize, sizeof(newSize));
-            successful = initialize(newSize);;
-            write(dataPipe[1], &successful, sizeof(successful));
-        } else if (recieved == move) {
-            read(commandPipe[0], &tileToMove, sizeof(tileToMove));
-            successful = moveTile(tileToMove);
-            write(dataPipe[1], &successful, sizeof(successful));
-        } else if (recieved == noAction) {
-            continue;
+            uint8_t *reply = output + outputLength;
+            size_t length = processRequest(&game, input + used, reply, &tiles);
+            countTraffic(needed, 0);
+            used += needed;
+            if (channel == NULL && tiles.cellCount == 0) {
+                outputLength += length;
+                continue;
+            }
+            countTraffic(0, sendReplies(dataPipe[1], &journal, output, outputLength));//everything before this one
+            flushJournal(&journal);
+            countTraffic(0, sendReply(dataPipe[1], channel, &game, reply, length, &tiles));
+            outputLength = 0;
         }
+        countTraffic(0, sendReplies(dataPipe[1], &journal, output, outputLength));
+        outputLength = 0;
+        if (needed == -1) {
+            size_t length = rejectRequest(input + used, output);
+            countTraffic(0, sendReply(dataPipe[1], channel, &game, output, length, NULL));
+        }
+        inputLength -= used;
+        memmove(input, input + used, inputLength);//the start of a request that is still coming in
     }
-    tearDown();
+    dumpStats();
+    closeJournal(&journal, 0);
+    tearDown(&game);
     close(commandPipe[0]);
     close(dataPipe[1]);
-}
\ No newline at end of file
+}
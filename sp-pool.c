@@ -0,0 +1,58 @@
+/*
+ * Representing the puzzle pools of "sliding puzzle" game
+ * Uses C99 standard
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sp-pool.h"
+#include "sp-save.h"
+
+struct archive puzzlePools[MAX_PACKED_BOARD_SIZE + 1];//count 0 for a size without a pool
+
+/*
+ * Maps every pool found for the sizes the solver can grade, named sp-pool-<size>.spar.
+ * They are looked for in the directory named by SP_POOL_DIR, and only when it is set, sizes without a pool are dealt
+ * as usual. Called before the servers fork, every server process then draws from the same read-only mapping.
+ */
+void mapPuzzlePools() {
+    char fileName[4096];
+    const char *directory = getenv("SP_POOL_DIR");
+    if (directory == NULL) {
+        return;
+    }
+    for (int size = MIN_BOARD_SIZE; size <= MAX_PACKED_BOARD_SIZE; size++) {
+        snprintf(fileName, sizeof(fileName), "%s/sp-pool-%d.spar", directory, size);
+        if (openArchive(&puzzlePools[size], fileName) == 0) {
+            memset(&puzzlePools[size], 0, sizeof(puzzlePools[size]));
+        }
+    }
+}
+
+/*
+ * Puts a board drawn at random from the pool of the game's size on the game's board, in place of dealing one.
+ * The board is loaded aside first, a damaged record or one of another size leaves the game's board untouched.
+ * @return: 1 if the board came from the pool, 0 if there is no pool for this size or the draw was no good.
+ */
+int dealPooledBoard(struct game *game) {
+    int size = game->boardSize;
+    struct game pooled;
+    if (size > MAX_PACKED_BOARD_SIZE || puzzlePools[size].count == 0) {
+        return 0;
+    }
+    uint64_t count = puzzlePools[size].count;
+    uint32_t index = randomBelow(game, (count > UINT32_MAX) ? UINT32_MAX : (uint32_t) count);
+    memset(&pooled, 0, sizeof(pooled));
+    if (loadArchivedGame(&puzzlePools[size], index, &pooled) == 0 || pooled.boardSize != size) {
+        tearDown(&pooled);
+        return 0;
+    }
+    for (int cell = 0; cell <= game->maxTileValue; cell++) {
+        setOneTile(game, cell, tileAt(&pooled, cell));
+    }
+    measureBoard(game);
+    tearDown(&pooled);
+    return 1;
+}
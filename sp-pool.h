@@ -0,0 +1,19 @@
+/*
+ * Representing the puzzle pools of "sliding puzzle" game
+ * Uses C99 standard
+ * A pool is an archive of boards made ahead of time by sp-generate, all of one size and in one band of optimal
+ * solution lengths. Once mapped, a new game of that size is drawn from the pool at random instead of dealt by
+ * setAllTiles(), so players get boards of a known difficulty and the request path does no solving.
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#ifndef SP_POOL_H
+#define SP_POOL_H
+
+#include "sp-game.h"
+
+void mapPuzzlePools();
+
+int dealPooledBoard(struct game *game);
+
+#endif
@@ -0,0 +1,144 @@
+/*
+ * Representing the messages shared by client and server side of "sliding puzzle" game
+ * Uses C99 standard
+ * Both sides must agree on every layout here, so anything sent over the pipes is declared once in this header.
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#ifndef SP_PROTOCOL_H
+#define SP_PROTOCOL_H
+
+#include <stdint.h>
+
+enum menuOptions {
+    print, save, load, new, move, moveBatch, solve, undo, redo, stats, hint, noAction
+};
+
+/*
+ * Every request and every reply travels in a frame, this header followed by 'length' bytes.
+ * A request is the menu command and its arguments, a reply is the answer and the status word, see sp-session.h.
+ * Replies come back in the order the requests went out, each with the id of its request, so a client may have
+ * any number of requests on the way before it reads the first reply. A request the server does not understand,
+ * or whose length does not fit its command, is answered with the status word alone: as long as the frames are
+ * right the two sides stay in step, whatever is in them. A frame longer than any request cannot be followed, it is
+ * answered with the status word REQUEST_REJECTED alone and the server hangs up.
+ */
+struct frameHeader {
+    uint32_t length;//bytes after the header
+    uint32_t id;//picked by the client, the reply carries the same one
+};
+
+#define REQUEST_REJECTED -1//status word of the last reply a client gets, for a frame too long to be a request
+
+#define MIN_BOARD_SIZE 3
+#define MAX_BOARD_SIZE 1000
+#define MAX_PACKED_BOARD_SIZE 9//games, snapshots, the solver and board sets keep one byte per tile up to here
+#define EMPTY_TILE 0//tiles are 1..maxTileValue and this for the empty tile
+#define FILE_NAME_LENGTH 99//save and load send the file name as a fixed block of this many chars
+
+#define SNAPSHOT_VERSION 6
+#define TILE_WIDTH(boardSize) (((boardSize) <= MAX_PACKED_BOARD_SIZE) ? 1 : 4)//bytes a tile takes, see snapshotHeader
+
+/*
+ * Leads every board snapshot, tells the client how many tiles follow and which format they are in.
+ * Fixed width fields so the layout does not depend on the compiler of either side.
+ * A print carries the game and boardVersion of the board the client already holds, an int32_t and an int64_t
+ * after the command, game -1 when it holds none. It is answered with this header, then the tiles, then the status
+ * word like any reply. When the client's board is of the same game and recent enough, the tiles are only the
+ * cells changed since, 'changes' pairs of board index and tile. Otherwise 'changes' is -1 and all
+ * boardSize * boardSize tiles follow in row-major order, as after every new or load.
+ * Tiles and board indices are TILE_WIDTH(boardSize) bytes each, a byte on boards up to MAX_PACKED_BOARD_SIZE and a
+ * uint32_t above, the same as the server keeps them. EMPTY_TILE stands for the empty tile either way. The server
+ * streams the tiles straight from the game, a large board would not fit any reply buffer.
+ */
+struct snapshotHeader {
+    int32_t boardSize;
+    int32_t version;
+    int32_t emptyIndex;
+    int32_t moveCount;
+    int32_t misplacedTiles;//tiles not yet on a winning cell
+    int32_t manhattanDistance;//moves the tiles need at least, each on its own, to reach their winning cells
+    int32_t game;//counts every board the server's game dealt or loaded, tells the client whether it has this one
+    int32_t changes;//index and tile pairs that follow, -1 when the whole board follows instead
+    int64_t boardVersion;//moves made on this board, the client sends it back with its next print
+};
+
+#define MAX_BATCH_MOVES 256
+
+/*
+ * Besides a tile value, a batch entry may name the direction a tile slides into the empty tile.
+ * Negative so they can never be mistaken for a tile, and below -1 so they are not the empty tile either.
+ */
+enum moveDirection {
+    moveUp = -2, moveDown = -3, moveLeft = -4, moveRight = -5
+};
+
+/*
+ * A whole move sequence applied by the server in one round trip.
+ * Sent as the count followed by exactly count entries, the unused tail of the array never goes on the pipe.
+ */
+struct batchMoveRequest {
+    int32_t count;
+    int32_t moves[MAX_BATCH_MOVES];
+};
+
+/*
+ * Answer to a batch, bit i of movedBitmap is set when entry i was applied.
+ * The server stops at the first move that wins the game, entries after it are left unapplied.
+ */
+struct batchMoveReply {
+    int32_t processed;
+    int32_t isWon;
+    uint8_t movedBitmap[MAX_BATCH_MOVES / 8];
+};
+
+#define MAX_SOLUTION_MOVES 256
+
+/*
+ * Answer to a solve, the board itself is left as it was, moves are the tile values to move in order.
+ * Fixed size like the snapshot so it goes out in one write() and comes in with one read().
+ */
+struct solveReply {
+    int32_t status;//1 solved, 0 the board cannot be won, -1 the search gave up before finding a solution
+    int32_t length;
+    int64_t nodesExpanded;
+    int64_t nodesPerSecond;
+    int64_t elapsedMicros;
+    int32_t moves[MAX_SOLUTION_MOVES];
+};
+
+/*
+ * Answer to a hint, the best next move for the board in progress.
+ */
+struct hintReply {
+    int32_t status;//1 found, 0 the board cannot be won, -1 the search gave up before finding a solution
+    int32_t tile;//the tile to move next
+    int32_t distance;//moves left to the win, tile included, when every move is the best one
+    int32_t fromCache;//1 if the position was solved before and nothing had to be searched
+};
+
+#define STATS_COMMANDS noAction//latency is kept for every command before noAction
+
+/*
+ * Latency of one command in nanoseconds, percentiles are the upper edge of their histogram bucket, within 1/16.
+ */
+struct latencySummary {
+    uint64_t count;
+    uint64_t p50;
+    uint64_t p99;
+    uint64_t max;
+};
+
+/*
+ * Answer to stats, everything the server counted since it started, over all of its games.
+ */
+struct statsReply {
+    struct latencySummary latency[STATS_COMMANDS];//indexed by menuOptions
+    uint64_t moves;
+    uint64_t rejectedMoves;
+    uint64_t gamesStarted;
+    uint64_t bytesReceived;//request bytes read from the command pipes or sockets
+    uint64_t bytesSent;//reply bytes written to the data pipes or sockets
+};
+
+#endif
@@ -0,0 +1,521 @@
+/*
+ * Representing the save format and game archives of "sliding puzzle" game
+ * Uses C99 standard
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "sp-save.h"
+
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+
+/*
+ * 32 bit FNV-1a, cheap enough to run on every save and load and enough to catch a damaged or truncated file.
+ */
+uint32_t checksumBytes(uint32_t hash, const uint8_t *bytes, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+    return hash;
+}
+
+/*
+ * Bytes a tile takes in a record: the fewest of 1, 2 or 4 that hold the largest tile, so the boards people play
+ * still save at a byte a tile and the largest ones at four.
+ */
+int tileWidth(int boardSize) {
+    int maxTileValue = (boardSize * boardSize) - 1;
+    return (maxTileValue <= UINT8_MAX) ? 1 : (maxTileValue <= UINT16_MAX) ? 2 : 4;
+}
+
+/*
+ * @return: bytes in the record of a board of the given size, 0 if no board has that size.
+ */
+uint64_t recordLength(int boardSize) {
+    if (boardSize < MIN_BOARD_SIZE || boardSize > MAX_BOARD_SIZE) {
+        return 0;
+    }
+    return sizeof(struct saveHeader) + ((uint64_t) boardSize * boardSize * tileWidth(boardSize));
+}
+
+/*
+ * Writes 'count' tiles of a game, board index 'first' onwards, at the width of a record.
+ * A packed board is already at the width of its record, a byte a tile.
+ */
+void packTiles(const struct game *game, int first, int count, int width, uint8_t *packed) {
+    if (game->board != NULL) {
+        memcpy(packed, game->board + first, count);
+        return;
+    }
+    const uint32_t *tiles = game->wideBoard + first;
+    if (width == 4) {
+        memcpy(packed, tiles, count * sizeof(uint32_t));
+    } else if (width == 2) {
+        for (int i = 0; i < count; i++) {
+            uint16_t value = tiles[i];
+            memcpy(packed + (i * sizeof(value)), &value, sizeof(value));
+        }
+    } else {
+        for (int i = 0; i < count; i++) {
+            packed[i] = tiles[i];
+        }
+    }
+}
+
+/*
+ * Puts tiles read from a record down on a board being loaded, cell 'first' onwards, see placeTile().
+ * @return: 0 as soon as one of them would leave the board invalid.
+ */
+int unpackTiles(struct game *loaded, int first, const uint8_t *packed, int count, int width) {
+    for (int i = 0; i < count; i++) {
+        uint32_t value = packed[i];
+        if (width == 2) {
+            uint16_t wide;
+            memcpy(&wide, packed + (i * sizeof(wide)), sizeof(wide));
+            value = wide;
+        } else if (width == 4) {
+            memcpy(&value, packed + (i * sizeof(value)), sizeof(value));
+        }
+        if (value > (uint32_t) loaded->maxTileValue || placeTile(loaded, first + i, value) == 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Header of the record of the game in progress, with its checksum still 0.
+ */
+void fillHeader(const struct game *game, struct saveHeader *header) {
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, SAVE_MAGIC, sizeof(header->magic));
+    header->version = SAVE_VERSION;
+    header->tileWidth = tileWidth(game->boardSize);
+    header->headerLength = sizeof(*header);
+    header->boardSize = game->boardSize;
+    header->emptyIndex = game->emptyIndex;
+    header->moveCount = game->moveCount;
+}
+
+/*
+ * Checks a header against the length of the record it leads, all but the checksum and the tiles.
+ * @return: 1 if the header may lead a valid record of exactly 'length' bytes.
+ */
+int checkHeader(const struct saveHeader *header, uint64_t length) {
+    uint64_t expected = recordLength(header->boardSize);
+    return memcmp(header->magic, SAVE_MAGIC, sizeof(header->magic)) == 0 && header->version == SAVE_VERSION
+           && header->headerLength == sizeof(*header) && expected != 0 && length == expected
+           && header->tileWidth == tileWidth(header->boardSize) && header->emptyIndex >= 0
+           && header->emptyIndex < header->boardSize * header->boardSize && header->moveCount >= 0;
+}
+
+/*
+ * Reads the header a record starts with into a saveHeader, a version 1 header is widened to the current one.
+ * @param length: bytes available at 'record'.
+ * @return: bytes the header takes in the record, 0 if there is no header of a known version at 'record'.
+ */
+size_t readHeader(const uint8_t *record, size_t length, struct saveHeader *header) {
+    struct saveHeaderVersion1 old;
+    if (length < sizeof(old)) {
+        return 0;
+    }
+    memcpy(&old, record, sizeof(old));
+    if (old.version != SAVE_VERSION_1) {
+        if (length < sizeof(*header)) {
+            return 0;
+        }
+        memcpy(header, record, sizeof(*header));
+        return sizeof(*header);
+    }
+    if (old.headerLength != sizeof(old) || old.boardSize > MAX_PACKED_BOARD_SIZE) {
+        return 0;
+    }
+    memcpy(header->magic, old.magic, sizeof(header->magic));
+    header->version = SAVE_VERSION;
+    header->tileWidth = 1;
+    header->headerLength = sizeof(*header);
+    header->boardSize = old.boardSize;
+    header->emptyIndex = old.emptyIndex;
+    header->moveCount = old.moveCount;
+    header->checksum = old.checksum;
+    return sizeof(old);
+}
+
+/*
+ * Checksum of a whole record, the checksum field of its header counted as 0.
+ * Both header versions end with their checksum, so it is the header's last four bytes that are left out.
+ * @param record: a header of 'headerBytes' followed by its tiles, 'length' bytes in all.
+ */
+uint32_t checksumRecord(const uint8_t *record, size_t length, size_t headerBytes) {
+    uint8_t header[sizeof(struct saveHeader)];
+    memcpy(header, record, headerBytes);
+    memset(header + headerBytes - sizeof(uint32_t), 0, sizeof(uint32_t));
+    uint32_t hash = checksumBytes(FNV_OFFSET_BASIS, header, headerBytes);
+    return checksumBytes(hash, record + headerBytes, length - headerBytes);
+}
+
+/*
+ * Starts the board a record describes in a game of its own, the game in progress stays as it is until
+ * finishLoad() hands the board over.
+ * @return: 0 if there is no memory for the board.
+ */
+int beginLoad(struct game *loaded, const struct saveHeader *header) {
+    memset(loaded, 0, sizeof(*loaded));
+    loaded->isLoadingGame = 1;
+    return initialize(loaded, header->boardSize);
+}
+
+/*
+ * Replaces the board of the game in progress with a loaded one, if every tile made it onto the loaded board and
+ * the empty tile is where the header says. The loaded game is released either way.
+ * @return: 1 if the game now has the loaded board, 0 if it was left as it was.
+ */
+int finishLoad(struct game *game, struct game *loaded, const struct saveHeader *header, int isValid) {
+    isValid = isValid && loaded->emptyIndex == header->emptyIndex;
+    if (isValid) {
+        measureBoard(loaded);
+        loaded->moveCount = header->moveCount;
+        adoptBoard(game, loaded);
+    }
+    tearDown(loaded);
+    return isValid;
+}
+
+/*
+ * Writes the game in progress as one record.
+ * @param record: at least recordLength(game->boardSize) bytes.
+ * @return: length of the record.
+ */
+size_t packGame(const struct game *game, uint8_t *record) {
+    struct saveHeader header;
+    int cellCount = game->boardSize * game->boardSize;
+    fillHeader(game, &header);
+    memcpy(record, &header, sizeof(header));
+    packTiles(game, 0, cellCount, header.tileWidth, record + sizeof(header));
+    size_t length = sizeof(header) + ((size_t) cellCount * header.tileWidth);
+    header.checksum = checksumRecord(record, length, sizeof(header));
+    memcpy(record, &header, sizeof(header));
+    return length;
+}
+
+/*
+ * Replaces the game in progress with the one in a record, of either header version.
+ * Everything is checked before the game is touched: the header and the checksum first, then the tiles go onto a
+ * board of their own through placeTile(), which turns down any value twice or out of range, and that board only
+ * replaces the one in progress once it is complete. A record that fails leaves the game in progress as it was.
+ * @param length: bytes available at 'record', must be exactly the record.
+ * @return: 1 if the game was loaded, 0 if the record is not a valid save.
+ */
+int unpackGame(struct game *game, const uint8_t *record, size_t length) {
+    struct saveHeader header;
+    struct game loaded;
+    size_t headerBytes = readHeader(record, length, &header);
+    if (headerBytes == 0 || checkHeader(&header, length + sizeof(header) - headerBytes) == 0
+        || header.checksum != checksumRecord(record, length, headerBytes) || beginLoad(&loaded, &header) == 0) {
+        return 0;
+    }
+    int isValid = unpackTiles(&loaded, 0, record + headerBytes, header.boardSize * header.boardSize,
+                              header.tileWidth);
+    return finishLoad(game, &loaded, &header, isValid);
+}
+
+int writeAll(int fd, const uint8_t *bytes, size_t length) {
+    while (length > 0) {
+        ssize_t count = write(fd, bytes, length);
+        if (count <= 0) {
+            return 0;
+        }
+        bytes += count;
+        length -= count;
+    }
+    return 1;
+}
+
+int readAll(int fd, uint8_t *bytes, size_t length) {
+    while (length > 0) {
+        ssize_t count = read(fd, bytes, length);
+        if (count <= 0) {
+            return 0;
+        }
+        bytes += count;
+        length -= count;
+    }
+    return 1;
+}
+
+/*
+ * Writes the record of the game in progress where the file is, SAVE_CHUNK_BYTES at a time.
+ * The checksum goes in the header in front of the tiles, so the tiles are packed twice, once to sum them up and
+ * once to write them, which costs less than holding a large board's record in memory. A small board fits one
+ * chunk together with its header and goes out with a single write().
+ * @return: 1 if the record was written, 0 if a write failed.
+ */
+int writeRecord(int fd, const struct game *game) {
+    uint8_t chunk[SAVE_CHUNK_BYTES];
+    struct saveHeader header;
+    int cellCount = game->boardSize * game->boardSize;
+    fillHeader(game, &header);
+    uint32_t hash = checksumBytes(FNV_OFFSET_BASIS, (const uint8_t *) &header, sizeof(header));
+    for (int pass = 0; pass < 2; pass++) {
+        size_t used = 0;
+        if (pass == 1) {
+            header.checksum = hash;
+            memcpy(chunk, &header, sizeof(header));
+            used = sizeof(header);
+        }
+        for (int cell = 0; cell < cellCount;) {
+            int count = (int) ((sizeof(chunk) - used) / header.tileWidth);
+            count = (count < cellCount - cell) ? count : cellCount - cell;
+            packTiles(game, cell, count, header.tileWidth, chunk + used);
+            used += (size_t) count * header.tileWidth;
+            cell += count;
+            if (pass == 0) {
+                hash = checksumBytes(hash, chunk, used);
+            } else if (writeAll(fd, chunk, used) == 0) {
+                return 0;
+            }
+            used = 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * A function to save a current game board into a file, creates new or overwrites to avoid conflicts with existing files
+ * The file is a single record, see writeRecord().
+ * @param fileName: this will be the name of your save file created if successful.
+ * @return: 0 if the file fails to save, 1 if successful.
+ */
+int saveGame(struct game *game, char *fileName) {
+    int fd = open(fileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        return 0;
+    }
+    int wasSuccessful = writeRecord(fd, game);
+    if (close(fd) != 0) {
+        wasSuccessful = 0;
+    }
+    return wasSuccessful;
+}
+
+/*
+ * Loads a file written by saveGame(), starting with a single read() of SAVE_CHUNK_BYTES.
+ * A file shorter than that is the whole record of a small board and goes to unpackGame() as it is. A longer one
+ * is checked against its header and streamed onto the board a chunk at a time, see unpackGame() for the checks.
+ * Resumes current game if loadGame() fails.
+ * @return: 1 for successful loading, 0 if error.
+ */
+int loadGame(struct game *game, char *fileName) {
+    uint8_t chunk[SAVE_CHUNK_BYTES];
+    struct saveHeader header;
+    struct stat fileStat;
+    struct game loaded;
+    int fd = open(fileName, O_RDONLY);
+    if (fd == -1) {
+        return 0;
+    }
+    ssize_t length = read(fd, chunk, sizeof(chunk));
+    if (length < (ssize_t) sizeof(chunk)) {
+        close(fd);
+        return length > 0 && unpackGame(game, chunk, length);
+    }
+    memcpy(&header, chunk, sizeof(header));
+    if (fstat(fd, &fileStat) == -1 || checkHeader(&header, fileStat.st_size) == 0
+        || beginLoad(&loaded, &header) == 0) {
+        close(fd);
+        return 0;
+    }
+    uint32_t checksum = header.checksum;
+    header.checksum = 0;
+    uint32_t hash = checksumBytes(FNV_OFFSET_BASIS, (const uint8_t *) &header, sizeof(header));
+    int cellCount = header.boardSize * header.boardSize;
+    int isValid = 1;
+    size_t used = sizeof(header);
+    for (int cell = 0; isValid;) {
+        int count = (int) ((length - used) / header.tileWidth);
+        hash = checksumBytes(hash, chunk + used, length - used);
+        isValid = unpackTiles(&loaded, cell, chunk + used, count, header.tileWidth);
+        cell += count;
+        if (cell == cellCount) {
+            break;
+        }
+        length = ((size_t) (cellCount - cell) * header.tileWidth < sizeof(chunk))
+                 ? (size_t) (cellCount - cell) * header.tileWidth : sizeof(chunk);
+        used = 0;
+        isValid = isValid && readAll(fd, chunk, length);
+    }
+    close(fd);
+    return finishLoad(game, &loaded, &header, isValid && hash == checksum);
+}
+
+/*
+ * Starts a new archive, replacing any file of that name.
+ * The header goes out with no index, an archive whose writer never got to finishArchive() is refused by openArchive().
+ * @return: 1 if the archive is ready for records, 0 if the file cannot be created.
+ */
+int createArchive(struct archiveWriter *writer, const char *fileName) {
+    struct archiveHeader header;
+    memset(writer, 0, sizeof(*writer));
+    writer->file = fopen(fileName, "wb");
+    if (writer->file == NULL) {
+        return 0;
+    }
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ARCHIVE_MAGIC, sizeof(header.magic));
+    header.version = ARCHIVE_VERSION;
+    if (fwrite(&header, sizeof(header), 1, writer->file) != 1) {
+        fclose(writer->file);
+        writer->file = NULL;
+        return 0;
+    }
+    writer->position = sizeof(header);
+    return 1;
+}
+
+/*
+ * Adds a record made by packGame() to the archive.
+ * @return: 1 if added, 0 if out of memory or the write failed.
+ */
+int appendRecord(struct archiveWriter *writer, const uint8_t *record, size_t length) {
+    if (writer->count == writer->capacity) {
+        uint64_t capacity = (writer->capacity == 0) ? 1024 : writer->capacity * 2;
+        uint64_t *offsets = realloc(writer->offsets, capacity * sizeof(uint64_t));
+        if (offsets == NULL) {
+            return 0;
+        }
+        writer->offsets = offsets;
+        writer->capacity = capacity;
+    }
+    if (fwrite(record, 1, length, writer->file) != length) {
+        return 0;
+    }
+    writer->offsets[writer->count++] = writer->position;
+    writer->position += length;
+    return 1;
+}
+
+/*
+ * Adds the game in progress to the archive.
+ * @return: 1 if added, 0 otherwise.
+ */
+int appendGame(struct archiveWriter *writer, const struct game *game) {
+    uint8_t buffer[SAVE_CHUNK_BYTES];
+    uint64_t length = recordLength(game->boardSize);
+    uint8_t *record = (length <= sizeof(buffer)) ? buffer : malloc(length);
+    if (record == NULL) {
+        return 0;
+    }
+    int wasSuccessful = appendRecord(writer, record, packGame(game, record));
+    if (record != buffer) {
+        free(record);
+    }
+    return wasSuccessful;
+}
+
+/*
+ * Writes the index after the last record, aligned so the mapped archive can use it in place, and only then fills in
+ * the header, and closes the file.
+ * The writer is released either way.
+ * @return: 1 if the archive is complete, 0 if anything failed to write.
+ */
+int finishArchive(struct archiveWriter *writer) {
+    struct archiveHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ARCHIVE_MAGIC, sizeof(header.magic));
+    header.version = ARCHIVE_VERSION;
+    header.count = writer->count;
+    header.indexOffset = (writer->position + sizeof(uint64_t) - 1) & ~(uint64_t) (sizeof(uint64_t) - 1);
+    static const uint8_t padding[sizeof(uint64_t)] = {0};
+    int wasSuccessful = fwrite(padding, 1, header.indexOffset - writer->position, writer->file)
+                        == header.indexOffset - writer->position
+                        && fwrite(writer->offsets, sizeof(uint64_t), writer->count, writer->file) == writer->count
+                        && fseek(writer->file, 0, SEEK_SET) == 0
+                        && fwrite(&header, sizeof(header), 1, writer->file) == 1;
+    if (fclose(writer->file) != 0) {
+        wasSuccessful = 0;
+    }
+    free(writer->offsets);
+    memset(writer, 0, sizeof(*writer));
+    return wasSuccessful;
+}
+
+/*
+ * Maps an archive read-only, records are then read in place straight from the page cache.
+ * The header and the index are checked against the file size, records themselves only when loaded.
+ * @return: 1 if the archive is open, 0 if the file is missing, unfinished or not an archive.
+ */
+int openArchive(struct archive *archive, const char *fileName) {
+    struct stat fileStat;
+    struct archiveHeader header;
+    memset(archive, 0, sizeof(*archive));
+    int fd = open(fileName, O_RDONLY);
+    if (fd == -1) {
+        return 0;
+    }
+    if (fstat(fd, &fileStat) == -1 || (size_t) fileStat.st_size < sizeof(header)) {
+        close(fd);
+        return 0;
+    }
+    const uint8_t *base = mmap(NULL, fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);//the mapping keeps the file open
+    if (base == MAP_FAILED) {
+        return 0;
+    }
+    memcpy(&header, base, sizeof(header));
+    uint64_t length = fileStat.st_size;
+    if (memcmp(header.magic, ARCHIVE_MAGIC, sizeof(header.magic)) != 0 || header.version != ARCHIVE_VERSION
+        || header.indexOffset < sizeof(header) || header.indexOffset > length
+        || header.count > (length - header.indexOffset) / sizeof(uint64_t)
+        || header.indexOffset % sizeof(uint64_t) != 0) {
+        munmap((void *) base, fileStat.st_size);
+        return 0;
+    }
+    madvise((void *) base, fileStat.st_size, MADV_RANDOM);
+    archive->base = base;
+    archive->length = fileStat.st_size;
+    archive->count = header.count;
+    archive->offsets = (const uint64_t *) (base + header.indexOffset);
+    return 1;
+}
+
+/*
+ * Replaces the game in progress with one game of an open archive.
+ * @param index: position of the game in the archive, 0 for the first one added.
+ * @return: 1 if the game was loaded, 0 if there is no such game or its record is damaged.
+ */
+int loadArchivedGame(const struct archive *archive, uint64_t index, struct game *game) {
+    if (index >= archive->count) {
+        return 0;
+    }
+    uint64_t offset = archive->offsets[index];
+    if (offset < sizeof(struct archiveHeader) || offset + sizeof(struct saveHeader) > archive->length) {
+        return 0;
+    }
+    const uint8_t *record = archive->base + offset;
+    struct saveHeader header;
+    size_t headerBytes = readHeader(record, archive->length - offset, &header);
+    if (headerBytes == 0 || recordLength(header.boardSize) == 0) {
+        return 0;
+    }
+    uint64_t length = recordLength(header.boardSize) + headerBytes - sizeof(header);
+    if (offset + length > archive->length) {
+        return 0;
+    }
+    return unpackGame(game, record, length);
+}
+
+/*
+ * Unmaps an archive opened by openArchive().
+ */
+void closeArchive(struct archive *archive) {
+    if (archive->base != NULL) {
+        munmap((void *) archive->base, archive->length);
+    }
+    memset(archive, 0, sizeof(*archive));
+}
@@ -0,0 +1,113 @@
+/*
+ * Representing the save format and game archives of "sliding puzzle" game
+ * Uses C99 standard
+ * A saved game is one record: a fixed header followed by the packed tiles. Records of small boards are read and
+ * written in one go, records of large ones a chunk at a time, never as one buffer of the whole board.
+ * An archive is many records back to back behind an archive header, with an index of their offsets at the end
+ * so any game in it can be reached without reading the ones before.
+ * Fields are written in the byte order of the machine, saves move between machines of the same kind only.
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#ifndef SP_SAVE_H
+#define SP_SAVE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "sp-game.h"
+
+#define SAVE_MAGIC "SPSV"
+#define SAVE_VERSION 2
+#define SAVE_VERSION_1 1//boards of up to MAX_PACKED_BOARD_SIZE at a byte a tile, still loaded, see saveHeaderVersion1
+#define ARCHIVE_MAGIC "SPAR"
+#define ARCHIVE_VERSION 1
+
+#define SAVE_CHUNK_BYTES 65536//tiles go through files this many bytes at a time, a multiple of every tile width
+
+/*
+ * Leads every record, tileWidth bytes per tile follow in row-major order, see tileWidth().
+ */
+struct saveHeader {
+    char magic[4];
+    uint16_t version;
+    uint8_t tileWidth;
+    uint8_t headerLength;//sizeof(struct saveHeader) when written, the tiles start right after it
+    int32_t boardSize;
+    int32_t emptyIndex;
+    int32_t moveCount;
+    uint32_t checksum;//FNV-1a over the whole record, this field counted as 0
+};
+
+/*
+ * Leads the records written before boards grew past MAX_PACKED_BOARD_SIZE, one byte per tile follows.
+ * Loading reads it into a saveHeader, see readHeader() in sp-save.c, saves are only ever written at SAVE_VERSION.
+ */
+struct saveHeaderVersion1 {
+    char magic[4];
+    uint16_t version;
+    uint8_t boardSize;
+    uint8_t headerLength;//sizeof(struct saveHeaderVersion1)
+    int32_t emptyIndex;
+    int32_t moveCount;
+    uint32_t checksum;//FNV-1a over the whole record, this field counted as 0
+};
+
+struct archiveHeader {
+    char magic[4];
+    uint16_t version;
+    uint16_t reserved;
+    uint64_t count;
+    uint64_t indexOffset;//count uint64_t record offsets start here, 0 while the archive is still being written
+};
+
+/*
+ * An archive being written, records go out through stdio and only their offsets are kept in memory.
+ */
+struct archiveWriter {
+    FILE *file;
+    uint64_t position;//where the next record goes
+    uint64_t count;
+    uint64_t capacity;
+    uint64_t *offsets;
+};
+
+/*
+ * An archive mapped read-only, see openArchive().
+ */
+struct archive {
+    const uint8_t *base;
+    size_t length;
+    uint64_t count;
+    const uint64_t *offsets;
+};
+
+int tileWidth(int boardSize);
+
+uint64_t recordLength(int boardSize);
+
+size_t packGame(const struct game *game, uint8_t *record);
+
+int unpackGame(struct game *game, const uint8_t *record, size_t length);
+
+int writeRecord(int fd, const struct game *game);
+
+int saveGame(struct game *game, char *fileName);
+
+int loadGame(struct game *game, char *fileName);
+
+int createArchive(struct archiveWriter *writer, const char *fileName);
+
+int appendRecord(struct archiveWriter *writer, const uint8_t *record, size_t length);
+
+int appendGame(struct archiveWriter *writer, const struct game *game);
+
+int finishArchive(struct archiveWriter *writer);
+
+int openArchive(struct archive *archive, const char *fileName);
+
+int loadArchivedGame(const struct archive *archive, uint64_t index, struct game *game);
+
+void closeArchive(struct archive *archive);
+
+#endif
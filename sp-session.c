@@ -0,0 +1,301 @@
+/*
+ * Representing the request handling shared by every server of "sliding puzzle" game
+ * Uses C99 standard
+ * Servers only move bytes, what a request means is decided here once for all of them.
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sp-hint.h"
+#include "sp-journal.h"
+#include "sp-save.h"
+#include "sp-session.h"
+#include "sp-stats.h"
+
+/*
+ * Works out how long a request is from the part of it that has arrived so far.
+ * Only the frame header has to be in for that, keep reading until at least the returned number of bytes is there.
+ * @param request: bytes received so far, starting with the frame header.
+ * @param received: number of bytes received.
+ * @return: bytes the request needs, -1 if no request is that long and the stream cannot be ours.
+ */
+long requestLength(const uint8_t *request, size_t received) {
+    struct frameHeader frame;
+    if (received < sizeof(frame)) {
+        return sizeof(frame);
+    }
+    memcpy(&frame, request, sizeof(frame));
+    if (frame.length > MAX_REQUEST_LENGTH - sizeof(frame)) {
+        return -1;
+    }
+    return sizeof(frame) + frame.length;
+}
+
+/*
+ * Answers a frame requestLength() turned down, the last reply of the session, and says why the session ends.
+ * @param request: at least the frame header of the request.
+ * @param reply: at least MAX_REPLY_LENGTH bytes, receives the frame with the id of the request and the status word
+ * REQUEST_REJECTED.
+ * @return: number of bytes written to reply.
+ */
+size_t rejectRequest(const uint8_t *request, uint8_t *reply) {
+    struct frameHeader frame;
+    int32_t status = REQUEST_REJECTED;
+    memcpy(&frame, request, sizeof(frame));
+    fprintf(stderr, "closing session: request %u says it is %u bytes long, no request is longer than %zu\n",
+            frame.id, frame.length, MAX_REQUEST_LENGTH - sizeof(frame));
+    frame.length = sizeof(status);
+    memcpy(reply, &frame, sizeof(frame));
+    memcpy(reply + sizeof(frame), &status, sizeof(status));
+    return sizeof(frame) + sizeof(status);
+}
+
+/*
+ * Works out how long the body of a request has to be for its command.
+ * @param body: the menu command and its arguments.
+ * @param length: bytes in the body, all of them have arrived.
+ * @return: bytes the command needs, -1 if it is not a command the server understands.
+ */
+long commandLength(const uint8_t *body, size_t length) {
+    int32_t command;
+    int32_t count;
+    if (length < sizeof(command)) {
+        return -1;
+    }
+    memcpy(&command, body, sizeof(command));
+    if (command == print) {
+        return sizeof(command) + sizeof(int32_t) + sizeof(int64_t);//the game and boardVersion the client holds
+    } else if (command == solve || command == undo || command == redo || command == stats || command == hint
+        || command == noAction) {
+        return sizeof(command);
+    } else if (command == save || command == load) {
+        return sizeof(command) + FILE_NAME_LENGTH;
+    } else if (command == new || command == move) {
+        return sizeof(command) + sizeof(int32_t);
+    } else if (command == moveBatch) {
+        if (length < sizeof(command) + sizeof(count)) {
+            return -1;
+        }
+        memcpy(&count, body + sizeof(command), sizeof(count));
+        if (count < 0 || count > MAX_BATCH_MOVES) {
+            return -1;
+        }
+        return sizeof(command) + sizeof(count) + (count * sizeof(int32_t));
+    }
+    return -1;
+}
+
+/*
+ * Writes the word every reply ends with: 1 if the game was won.
+ * A won game is replaced by a new one of the default size right away, the client only announces it.
+ * @param reply: receives the status word.
+ * @return: number of bytes written to reply.
+ */
+size_t reportStatus(struct game *game, uint8_t *reply) {
+    int32_t winningGame = isWon(game);
+    memcpy(reply, &winningGame, sizeof(winningGame));
+    if (winningGame == 1) {
+        initialize(game, DEFAULT_BOARD_SIZE);
+    }
+    return sizeof(winningGame);
+}
+
+int compareCells(const void *first, const void *second) {
+    uint32_t a = *(const uint32_t *) first;
+    uint32_t b = *(const uint32_t *) second;
+    return (a > b) - (a < b);
+}
+
+/*
+ * Sets up the tiles of a print, only the cells changed since the board the client holds when that is cheaper.
+ * A pair costs two tiles, so a delta is only sent while it is smaller than the board, and never across a new or
+ * loaded game, or further back than the change log reaches.
+ * @param request: the game and boardVersion of the client's board, after the command.
+ * @param header: the snapshot header of the reply, 'changes' is set here.
+ */
+void prepareTiles(const struct game *game, const uint8_t *request, struct snapshotHeader *header,
+                  struct tileStream *tiles) {
+    int32_t mirrorGame;
+    int64_t mirrorVersion;
+    memcpy(&mirrorGame, request, sizeof(mirrorGame));
+    memcpy(&mirrorVersion, request + sizeof(mirrorGame), sizeof(mirrorVersion));
+    tiles->nextCell = 0;
+    tiles->isChanges = 0;
+    tiles->tileWidth = TILE_WIDTH(game->boardSize);
+    tiles->cellCount = game->boardSize * game->boardSize;
+    if (mirrorGame != game->gamesPlayed || mirrorVersion < 0) {
+        return;
+    }
+    int count = changedCells(game, mirrorVersion, tiles->changed);
+    if (count == -1) {
+        return;
+    }
+    qsort(tiles->changed, count, sizeof(uint32_t), compareCells);
+    int distinct = 0;
+    for (int i = 0; i < count; i++) {//consecutive moves share the empty cell, it goes out once
+        if (distinct == 0 || tiles->changed[distinct - 1] != tiles->changed[i]) {
+            tiles->changed[distinct++] = tiles->changed[i];
+        }
+    }
+    if (2 * distinct < tiles->cellCount) {
+        header->changes = distinct;
+        tiles->cellCount = distinct;
+        tiles->isChanges = 1;
+    }
+}
+
+/*
+ * Turns the file name a save or load request carries into the file it uses, in the directory named by SP_SAVE_DIR,
+ * or the current directory when it is not set. A client of the socket server may be anyone who can reach the socket,
+ * so it only ever names a file in that directory: a name with a '/', and "." or "..", is turned down.
+ * @param path: receives the file, capacity bytes.
+ * @return: 1 if path was filled in, 0 if the name is turned down or too long.
+ */
+int saveFilePath(const char *fileName, char *path, size_t capacity) {
+    const char *directory = getenv("SP_SAVE_DIR");
+    if (fileName[0] == '\0' || strchr(fileName, '/') != NULL || strcmp(fileName, ".") == 0
+        || strcmp(fileName, "..") == 0) {
+        return 0;
+    }
+    int length = snprintf(path, capacity, "%s/%s", (directory != NULL) ? directory : ".", fileName);
+    return length > 0 && (size_t) length < capacity;
+}
+
+/*
+ * Carries out one complete request against a game, see requestLength() for when a request is complete.
+ * Every request is timed into the latency histogram of its command, and its moves and new games are counted.
+ * A game with a journal gets a checkpoint whenever a new game takes the place of the old one.
+ * A print only puts the snapshot header in the reply, the tiles that go after it are left to the server to stream
+ * from the game, a large board would not fit any reply buffer. See prepareTiles() for which tiles.
+ * The status word of a print is settled first, so a game that is already won, as one recovered from its journal can
+ * be, is replaced before the header and the streamed tiles are taken from it and both describe the new board.
+ * Save and load only reach files in the save directory, see saveFilePath().
+ * A request whose body does not fit its command is taken for noAction and answered with the status word alone.
+ * @param request: the frame holding the menu command and its arguments.
+ * @param reply: at least MAX_REPLY_LENGTH bytes, receives the frame of the answer followed by the status word, the
+ * frame counts the streamed tiles too.
+ * @param tiles: receives where in the reply the tiles of a print go, cellCount 0 for every other request.
+ * @return: number of bytes written to reply.
+ */
+size_t processRequest(struct game *game, const uint8_t *request, uint8_t *reply, struct tileStream *tiles) {
+    int32_t command;
+    int32_t argument;
+    int32_t successful;
+    char fileName[FILE_NAME_LENGTH];
+    char path[4096];
+    struct batchMoveRequest batch;
+    struct frameHeader frame;
+    size_t length = sizeof(frame);
+    uint64_t start = statsClock();
+    int gamesPlayed = game->gamesPlayed;
+    memcpy(&frame, request, sizeof(frame));
+    request += sizeof(frame);
+    command = noAction;
+    if (commandLength(request, frame.length) == (long) frame.length) {
+        memcpy(&command, request, sizeof(command));
+    }
+    request += sizeof(command);
+    tiles->cellCount = 0;
+    if (command == print) {
+        struct snapshotHeader header;
+        tiles->offset = length + sizeof(header);
+        length = tiles->offset + reportStatus(game, reply + tiles->offset);//a won game is replaced before it is taken
+        fillSnapshotHeader(game, &header);
+        prepareTiles(game, request, &header, tiles);
+        memcpy(reply + sizeof(frame), &header, sizeof(header));
+    } else if (command == save || command == load) {
+        memcpy(fileName, request, sizeof(fileName));
+        fileName[sizeof(fileName) - 1] = '\0';//never trust the client to terminate it
+        successful = saveFilePath(fileName, path, sizeof(path)) ? ((command == save) ? saveGame(game, path)
+                                                                                    : loadGame(game, path)) : 0;
+        memcpy(reply + length, &successful, sizeof(successful));
+        length += sizeof(successful);
+    } else if (command == new || command == move) {
+        memcpy(&argument, request, sizeof(argument));
+        successful = (command == new) ? initialize(game, argument) : moveTile(game, argument);
+        if (command == move) {
+            countMoves(successful, 1 - successful);
+        }
+        memcpy(reply + length, &successful, sizeof(successful));
+        length += sizeof(successful);
+    } else if (command == moveBatch) {
+        struct batchMoveReply batchReply;
+        memcpy(&batch.count, request, sizeof(batch.count));
+        memcpy(batch.moves, request + sizeof(batch.count), batch.count * sizeof(int32_t));
+        moveTiles(game, batch.moves, batch.count, &batchReply);
+        int moved = 0;
+        for (int i = 0; i < batchReply.processed; i++) {
+            moved += (batchReply.movedBitmap[i / 8] >> (i % 8)) & 1;
+        }
+        countMoves(moved, batchReply.processed - moved);
+        memcpy(reply + length, &batchReply, sizeof(batchReply));
+        length += sizeof(batchReply);
+    } else if (command == solve) {
+        struct solveReply solveResult;
+        solveGame(game, &solveResult);
+        memcpy(reply + length, &solveResult, sizeof(solveResult));
+        length += sizeof(solveResult);
+    } else if (command == hint) {
+        struct hintReply hintResult;
+        hintGame(game, &hintResult);
+        memcpy(reply + length, &hintResult, sizeof(hintResult));
+        length += sizeof(hintResult);
+    } else if (command == undo || command == redo) {
+        successful = (command == undo) ? undoMove(game) : redoMove(game);
+        memcpy(reply + length, &successful, sizeof(successful));
+        length += sizeof(successful);
+    } else if (command == stats) {
+        struct statsReply statsResult;
+        summarizeStats(&statsResult);
+        memcpy(reply + length, &statsResult, sizeof(statsResult));
+        length += sizeof(statsResult);
+    }
+    if (command != print) {
+        length += reportStatus(game, reply + length);
+    }
+    if (game->gamesPlayed != gamesPlayed && game->journal != NULL) {
+        checkpointJournal(game->journal, game);//new, loaded or won and restarted, the journal starts over
+    }
+    countGames(game->gamesPlayed - gamesPlayed);
+    frame.length = (length - sizeof(frame)) + streamLength(tiles);
+    memcpy(reply, &frame, sizeof(frame));
+    recordLatency(command, statsClock() - start);
+    return length;
+}
+
+/*
+ * Bytes the tiles of a reply take on the wire, 0 when it carries none.
+ */
+size_t streamLength(const struct tileStream *tiles) {
+    return (size_t) tiles->cellCount * (tiles->isChanges ? 2 : 1) * tiles->tileWidth;
+}
+
+/*
+ * Hands out the next tiles of a print as they go on the wire, as many as fit the buffer.
+ * @param capacity: bytes available at 'buffer', at least one tile, or one pair when only changes go out.
+ * @return: bytes written to buffer, 0 once every tile has been handed out.
+ */
+size_t streamTiles(const struct game *game, struct tileStream *tiles, uint8_t *buffer, size_t capacity) {
+    size_t cellBytes = (tiles->isChanges ? 2 : 1) * tiles->tileWidth;
+    size_t count = tiles->cellCount - tiles->nextCell;
+    if (count > capacity / cellBytes) {
+        count = capacity / cellBytes;
+    }
+    if (tiles->isChanges == 0) {
+        copyTiles(game, tiles->nextCell, count, buffer);
+    }
+    for (size_t i = 0; tiles->isChanges && i < count; i++) {
+        uint32_t index = tiles->changed[tiles->nextCell + i];
+        uint32_t pair[2] = {index, tileAt(game, index)};
+        if (tiles->tileWidth == 1) {
+            buffer[2 * i] = (uint8_t) pair[0];
+            buffer[(2 * i) + 1] = (uint8_t) pair[1];
+        } else {
+            memcpy(buffer + (i * sizeof(pair)), pair, sizeof(pair));
+        }
+    }
+    tiles->nextCell += count;
+    return count * cellBytes;
+}
@@ -0,0 +1,60 @@
+/*
+ * Representing the request handling shared by every server of "sliding puzzle" game
+ * Uses C99 standard
+ * A request is a frame holding the menu command followed by its arguments, exactly as the client writes them.
+ * Every reply is a frame holding the answer followed by a status word telling whether the game was won, see
+ * struct frameHeader.
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#ifndef SP_SESSION_H
+#define SP_SESSION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sp-game.h"
+#include "sp-protocol.h"
+
+/*
+ * Every reply a request can get, only used to size buffers.
+ */
+union replyBody {
+    int32_t successful;
+    struct snapshotHeader snapshot;
+    struct batchMoveReply batch;
+    struct solveReply solve;
+    struct hintReply hint;
+    struct statsReply stats;
+};
+
+#define MAX_REQUEST_LENGTH (sizeof(struct frameHeader) + sizeof(int32_t) + sizeof(struct batchMoveRequest))
+#define MAX_REPLY_LENGTH (sizeof(struct frameHeader) + sizeof(union replyBody) + sizeof(int32_t))
+
+/*
+ * Tiles a reply carries that are not in the reply buffer, see processRequest().
+ * The server sends the first 'offset' bytes of the reply, then the tiles as streamTiles() hands them out, then the
+ * rest of the reply, and takes no other request of the same client in between, so the board cannot change under it.
+ * A print the client holds most of the board for only streams the cells in 'changed', as board index and tile.
+ */
+struct tileStream {
+    size_t offset;
+    int nextCell;
+    int cellCount;//0 when the reply carries no tiles
+    int isChanges;//1 when the cells in 'changed' go out as pairs, 0 when the whole board goes out in order
+    int tileWidth;//bytes of every tile and board index on the wire, TILE_WIDTH() of the board
+    uint32_t changed[2 * CHANGE_LOG_MOVES];//board indices in increasing order, each at most once
+};
+
+long requestLength(const uint8_t *request, size_t received);
+
+size_t rejectRequest(const uint8_t *request, uint8_t *reply);
+
+int saveFilePath(const char *fileName, char *path, size_t capacity);
+
+size_t processRequest(struct game *game, const uint8_t *request, uint8_t *reply, struct tileStream *tiles);
+
+size_t streamLength(const struct tileStream *tiles);
+
+size_t streamTiles(const struct game *game, struct tileStream *tiles, uint8_t *buffer, size_t capacity);
+
+#endif
@@ -0,0 +1,163 @@
+/*
+ * Representing the shared memory transport between client and server side of "sliding puzzle" game
+ * Uses C99 standard
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "sp-pipe-io.h"
+#include "sp-shared.h"
+
+/*
+ * Maps the channel, call before fork() so client and server share it.
+ * @return: the channel, NULL if it cannot be mapped, the game then runs over pipes alone.
+ */
+struct sharedChannel *createSharedChannel(void) {
+    struct sharedChannel *channel = mmap(NULL, sizeof(struct sharedChannel), PROT_READ | PROT_WRITE,
+                                         MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    return (channel == MAP_FAILED) ? NULL : channel;
+}
+
+/*
+ * Makes the board of the game the one the client sees, only the server may call it.
+ * The same board as last time only has the cells its moves since then changed copied over, a board the client
+ * has not seen yet goes over whole.
+ * Readers that catch it half written see an odd sequence, or a different one afterwards, and read again.
+ */
+void publishBoard(struct sharedChannel *channel, const struct game *game) {
+    uint32_t cells[2 * CHANGE_LOG_MOVES];
+    uint32_t sequence = channel->boardSequence;
+    int count = -1;
+    if (game->gamesPlayed == channel->publishedGame) {
+        count = changedCells(game, channel->publishedVersion, cells);
+    }
+    __atomic_store_n(&channel->boardSequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    fillSnapshotHeader(game, &channel->board);
+    if (count == -1 && game->board == NULL) {
+        memcpy(channel->tiles, game->wideBoard, (size_t) game->boardSize * game->boardSize * sizeof(uint32_t));
+    }
+    for (int cell = 0; count == -1 && game->board != NULL && cell < game->boardSize * game->boardSize; cell++) {
+        channel->tiles[cell] = game->board[cell];
+    }
+    for (int i = 0; i < count; i++) {
+        channel->tiles[cells[i]] = tileAt(game, cells[i]);
+    }
+    channel->publishedGame = game->gamesPlayed;
+    channel->publishedVersion = game->boardVersion;
+    __atomic_store_n(&channel->boardSequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+/*
+ * Sleeps until the client has read every reply published so far, so the next one can take the reply's place.
+ * The same handshake as awaitReply() the other way round.
+ * @param dataFd: the server's end of the data pipe, the client closing its end means it is gone.
+ * @return: 0 if the client went away instead.
+ */
+int awaitConsumed(struct sharedChannel *channel, int dataFd) {
+    uint32_t published = channel->replySequence;
+    uint32_t consumed;
+    while ((consumed = __atomic_load_n(&channel->replyConsumed, __ATOMIC_ACQUIRE)) != published) {
+        struct timespec timeout = {SHARED_WAIT_MILLIS / 1000, (SHARED_WAIT_MILLIS % 1000) * 1000000L};
+        struct pollfd client = {.fd = dataFd, .events = 0};
+        __atomic_store_n(&channel->serverWaiting, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&channel->replyConsumed, __ATOMIC_SEQ_CST) == consumed) {
+            long woken = syscall(SYS_futex, &channel->replyConsumed, FUTEX_WAIT, consumed, &timeout, NULL, 0);
+            if (woken == -1 && errno == ETIMEDOUT && poll(&client, 1, 0) == 1 && (client.revents & POLLERR)) {
+                __atomic_store_n(&channel->serverWaiting, 0, __ATOMIC_RELAXED);
+                return 0;
+            }
+        }
+        __atomic_store_n(&channel->serverWaiting, 0, __ATOMIC_RELAXED);
+    }
+    return 1;
+}
+
+/*
+ * Hands a reply to the client, waking it only if it went to sleep waiting for one.
+ * The client has read the previous reply completely, see awaitConsumed().
+ */
+void publishReply(struct sharedChannel *channel, const uint8_t *reply, size_t length) {
+    memcpy(channel->reply, reply, length);
+    channel->replyLength = length;
+    __atomic_fetch_add(&channel->replySequence, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&channel->clientWaiting, __ATOMIC_SEQ_CST)) {
+        syscall(SYS_futex, &channel->replySequence, FUTEX_WAKE, 1, NULL, NULL, 0);
+    }
+}
+
+/*
+ * Copies out the header of the board as last published, never one half way through an update.
+ * The server only publishes while answering a request, so between requests the client may read channel->tiles
+ * in place, row by row, for as long as it likes.
+ */
+void readBoardHeader(const struct sharedChannel *channel, struct snapshotHeader *header) {
+    uint32_t before;
+    uint32_t after;
+    do {
+        before = __atomic_load_n(&channel->boardSequence, __ATOMIC_ACQUIRE);
+        memcpy(header, &channel->board, sizeof(*header));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        after = __atomic_load_n(&channel->boardSequence, __ATOMIC_RELAXED);
+    } while ((before & 1) || before != after);
+}
+
+/*
+ * Sleeps until the server has published the reply after the last one read.
+ * Flags itself as waiting before the last look at the sequence, and the server bumps the sequence before it looks
+ * at the flag, so at least one of them sees the other and no wake-up is lost. The futex itself refuses to sleep
+ * if the sequence has already moved on.
+ * @return: 0 if the server went away instead.
+ */
+int awaitReply(struct replyReader *reader) {
+    struct sharedChannel *channel = reader->channel;
+    uint32_t last = reader->sequence;
+    while (__atomic_load_n(&channel->replySequence, __ATOMIC_ACQUIRE) == last) {
+        struct timespec timeout = {SHARED_WAIT_MILLIS / 1000, (SHARED_WAIT_MILLIS % 1000) * 1000000L};
+        __atomic_store_n(&channel->clientWaiting, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&channel->replySequence, __ATOMIC_SEQ_CST) == last) {
+            long woken = syscall(SYS_futex, &channel->replySequence, FUTEX_WAIT, last, &timeout, NULL, 0);
+            if (woken == -1 && errno == ETIMEDOUT && kill(reader->server, 0) == -1 && errno == ESRCH) {
+                __atomic_store_n(&channel->clientWaiting, 0, __ATOMIC_RELAXED);
+                return 0;
+            }
+        }
+        __atomic_store_n(&channel->clientWaiting, 0, __ATOMIC_RELAXED);
+    }
+    return 1;
+}
+
+/*
+ * Takes in the next length bytes the server sent, the same way whatever the transport.
+ * @return: 1 when all bytes were read, 0 if the server went away first.
+ */
+int readReply(struct replyReader *reader, void *buffer, size_t length) {
+    if (reader->channel == NULL) {
+        return readFully(reader->fd, buffer, length);
+    }
+    if (reader->offset == 0 && awaitReply(reader) == 0) {
+        return 0;
+    }
+    if (reader->offset + length > reader->channel->replyLength) {
+        return 0;//asked for more than the reply holds, the two sides disagree about the protocol
+    }
+    memcpy(buffer, reader->channel->reply + reader->offset, length);
+    reader->offset += length;
+    if (reader->offset == reader->channel->replyLength) {
+        reader->sequence++;
+        reader->offset = 0;
+        __atomic_store_n(&reader->channel->replyConsumed, reader->sequence, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&reader->channel->serverWaiting, __ATOMIC_SEQ_CST)) {
+            syscall(SYS_futex, &reader->channel->replyConsumed, FUTEX_WAKE, 1, NULL, NULL, 0);
+        }
+    }
+    return 1;
+}
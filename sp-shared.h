@@ -0,0 +1,65 @@
+/*
+ * Representing the shared memory transport between client and server side of "sliding puzzle" game
+ * Uses C99 standard
+ * Requests still go to the server over the command pipe, everything coming back is placed in one shared mapping
+ * created before the fork: the board as of the last request, published under a seqlock, and the reply itself.
+ * The client sleeps on a futex until a reply is there and reads the board whenever it likes, printing the board
+ * takes no request, no system call and no copy through the kernel. There is room for one reply only, so a client
+ * with several requests on the way has the server wait for each reply to be read before the next is published,
+ * and reads the board in place only while it has none on the way.
+ * The mapping has room for the largest board, but the kernel only backs the pages a board has reached, and after
+ * a move only the cells the move changed are published again, see changedCells().
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#ifndef SP_SHARED_H
+#define SP_SHARED_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "sp-game.h"
+#include "sp-protocol.h"
+#include "sp-session.h"
+
+#define SHARED_WAIT_MILLIS 1000//how often a waiting client checks the server is still there
+
+struct sharedChannel {
+    uint32_t boardSequence;//seqlock of board, odd while the server is writing it
+    uint32_t replySequence;//replies published so far, also the futex word the client waits on
+    uint32_t replyLength;
+    uint32_t clientWaiting;//1 while the client sleeps on the futex, the server only wakes it then
+    uint32_t replyConsumed;//replies the client has read completely, the futex word the server waits on
+    uint32_t serverWaiting;//1 while the server sleeps until the last reply is read
+    int publishedGame;//gamesPlayed of the board in tiles, 0 before the first, only the server looks at it
+    uint64_t publishedVersion;//boardVersion of the board in tiles
+    struct snapshotHeader board;
+    uint8_t reply[MAX_REPLY_LENGTH];
+    uint32_t tiles[MAX_BOARD_SIZE * MAX_BOARD_SIZE];//the board described by 'board', a uint32_t a tile on any size
+};
+
+/*
+ * Where the client is in the stream of replies, over a pipe or socket when channel is NULL, otherwise in the
+ * shared mapping, where a reply may be taken in over several calls just like from a pipe.
+ */
+struct replyReader {
+    int fd;
+    struct sharedChannel *channel;
+    pid_t server;
+    uint32_t sequence;//replies read completely
+    size_t offset;//bytes of the current reply read so far
+};
+
+struct sharedChannel *createSharedChannel(void);
+
+void publishBoard(struct sharedChannel *channel, const struct game *game);
+
+int awaitConsumed(struct sharedChannel *channel, int dataFd);
+
+void publishReply(struct sharedChannel *channel, const uint8_t *reply, size_t length);
+
+void readBoardHeader(const struct sharedChannel *channel, struct snapshotHeader *header);
+
+int readReply(struct replyReader *reader, void *buffer, size_t length);
+
+#endif
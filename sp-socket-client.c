@@ -0,0 +1,42 @@
+/*
+ * Representing the client of the multi-session server of "sliding puzzle" game
+ * Uses C99 standard
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+struct sharedChannel;
+
+void clientSession(int commandFd, int dataFd, struct sharedChannel *channel);
+
+/*
+ * Connects to a running socket server and plays there, the one socket carries both requests and replies.
+ * @param socketPath: file name the server listens on.
+ * @return: 0 after the user quits, 1 if the server could not be reached.
+ */
+int socketClientFunction(const char *socketPath) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(socketPath) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "socket path [%s] is too long\n", socketPath);
+        return 1;
+    }
+    strcpy(address.sun_path, socketPath);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1 || connect(fd, (struct sockaddr *) &address, sizeof(address)) == -1) {
+        perror("cannot connect to the server");
+        if (fd != -1) {
+            close(fd);
+        }
+        return 1;
+    }
+    clientSession(fd, fd, NULL);
+    close(fd);//rely on closing the socket to notify server of quitting
+    return 0;
+}
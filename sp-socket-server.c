@@ -0,0 +1,454 @@
+/*
+ * Representing the multi-session server of "sliding puzzle" game
+ * Uses C99 standard
+ * One process serves every player over a Unix domain socket, each connection is a session with a game of its own.
+ * A single thread waits on epoll for any session with bytes to read or a backlog to write, so an idle player
+ * costs a few kilobytes and no process, and nothing ever blocks on one slow client.
+ * Solve and hint can search for seconds, so they go to a small pool of workers instead. The session is parked, out
+ * of epoll, until its worker hands it back through an eventfd the loop watches like any socket.
+ * Sessions speak exactly the pipe protocol, see sp-session.h, so the same client works over either.
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#define _GNU_SOURCE//accept4()
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "sp-game.h"
+#include "sp-journal.h"
+#include "sp-session.h"
+#include "sp-stats.h"
+
+#define MAX_EVENTS 256
+#define OUTPUT_REPLIES 4//replies a session may have waiting before it is read from again
+#define SEARCH_WORKERS 4//a solve spreads over every core already, more workers only keep one from waiting on another
+
+/*
+ * One connected player.
+ * Requests are collected in 'input' until requestLength() says one is complete, replies wait in 'output'
+ * until the socket takes them. While replies are waiting the session is not read from, so a client that
+ * sends without ever reading holds at most OUTPUT_REPLIES replies of server memory.
+ * The tiles of a print are fed into 'output' as the socket drains it, whatever the size of the board.
+ */
+struct session {
+    int fd;
+    uint32_t events;//what epoll currently watches for on fd
+    struct game game;
+    struct journal journal;//kept in memory only for undo and redo, a session cannot be resumed after a restart
+    uint8_t input[MAX_REQUEST_LENGTH];
+    size_t inputLength;
+    uint8_t output[OUTPUT_REPLIES * MAX_REPLY_LENGTH];
+    size_t outputLength;
+    size_t outputSent;
+    int isParked;//a worker has the game and the request at the front of 'input', the loop leaves both alone
+    uint8_t searched[MAX_REPLY_LENGTH];//the worker's reply, queued once the session is handed back
+    size_t searchedLength;
+    struct session *nextParked;//in the worker queue or the finished list
+    struct session *previousLive;
+    struct session *nextLive;//every session the loop has, so a shutdown can close them
+    struct tileStream tiles;//of the print being sent, no other request is answered until it is done
+    uint8_t tail[sizeof(int32_t)];//the status word that goes after those tiles
+    size_t tailLength;
+};
+
+/*
+ * Sessions waiting for a worker, first come first served, and those a worker is done with, in any order.
+ * The loop is told about finished ones by a count added to 'wakeFd'.
+ */
+struct searchPool {
+    pthread_mutex_t lock;//guards everything below but wakeFd
+    pthread_cond_t queued;
+    struct session *first;
+    struct session *last;
+    struct session *finished;
+    int wakeFd;
+};
+
+struct searchPool searchPool = {.lock = PTHREAD_MUTEX_INITIALIZER, .queued = PTHREAD_COND_INITIALIZER, .wakeFd = -1};
+
+struct session *liveSessions = NULL;
+
+volatile sig_atomic_t stopRequested = 0;
+
+void requestStop(int signalNumber) {
+    (void) signalNumber;
+    stopRequested = 1;
+}
+
+/*
+ * Takes parked sessions off the queue one at a time and answers their solve or hint.
+ * The reply is written aside, the loop may still be sending the session's earlier replies out of 'output'.
+ */
+void *searchWorker(void *argument) {
+    struct searchPool *pool = argument;
+    struct tileStream tiles;//never used by a solve or a hint, processRequest() only clears it
+    uint64_t one = 1;
+    while (1) {
+        pthread_mutex_lock(&pool->lock);
+        while (pool->first == NULL) {
+            pthread_cond_wait(&pool->queued, &pool->lock);
+        }
+        struct session *session = pool->first;
+        pool->first = session->nextParked;
+        pthread_mutex_unlock(&pool->lock);
+        session->searchedLength = processRequest(&session->game, session->input, session->searched, &tiles);
+        pthread_mutex_lock(&pool->lock);
+        session->nextParked = pool->finished;
+        pool->finished = session;
+        pthread_mutex_unlock(&pool->lock);
+        if (write(pool->wakeFd, &one, sizeof(one)) == -1) {
+            perror("cannot wake the server");
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Starts the workers with SIGINT and SIGTERM blocked, so a stop always interrupts the loop's epoll_wait().
+ * @return: 1 if the pool is ready, 0 if the eventfd or every worker could not be made.
+ */
+int startSearchPool(struct searchPool *pool) {
+    sigset_t stopSignals;
+    sigset_t previous;
+    pthread_t thread;
+    int started = 0;
+    pool->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (pool->wakeFd == -1) {
+        return 0;
+    }
+    sigemptyset(&stopSignals);
+    sigaddset(&stopSignals, SIGINT);
+    sigaddset(&stopSignals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &stopSignals, &previous);
+    for (int i = 0; i < SEARCH_WORKERS; i++) {
+        if (pthread_create(&thread, NULL, searchWorker, pool) == 0) {
+            pthread_detach(thread);
+            started++;
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &previous, NULL);
+    return started > 0;
+}
+
+/*
+ * Hands the request at the front of the input to a worker, the session stays parked until it is finished.
+ */
+void parkSession(struct searchPool *pool, struct session *session) {
+    session->isParked = 1;
+    session->nextParked = NULL;
+    pthread_mutex_lock(&pool->lock);
+    if (pool->first == NULL) {
+        pool->first = session;
+    } else {
+        pool->last->nextParked = session;
+    }
+    pool->last = session;
+    pthread_cond_signal(&pool->queued);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+/*
+ * Tops the output up with tiles of the print being sent, and its status word once every tile is in.
+ */
+void streamOutput(struct session *session) {
+    if (session->tiles.cellCount == 0) {
+        return;
+    }
+    session->outputLength += streamTiles(&session->game, &session->tiles, session->output + session->outputLength,
+                                         sizeof(session->output) - session->outputLength);
+    if (session->tiles.nextCell == session->tiles.cellCount
+        && sizeof(session->output) - session->outputLength >= session->tailLength) {
+        memcpy(session->output + session->outputLength, session->tail, session->tailLength);
+        session->outputLength += session->tailLength;
+        session->tiles.cellCount = 0;
+    }
+}
+
+/*
+ * Sends as much of the waiting output as the socket takes without blocking.
+ * @return: 0 if the connection is broken, 1 otherwise.
+ */
+int flushOutput(struct session *session) {
+    streamOutput(session);
+    while (session->outputSent < session->outputLength) {
+        ssize_t count = send(session->fd, session->output + session->outputSent,
+                             session->outputLength - session->outputSent, MSG_NOSIGNAL);
+        if (count == -1 && errno == EAGAIN) {
+            return 1;
+        }
+        if (count <= 0) {
+            return 0;
+        }
+        session->outputSent += count;
+        countTraffic(0, count);
+        if (session->outputSent == session->outputLength) {
+            session->outputLength = 0;
+            session->outputSent = 0;
+            streamOutput(session);
+        }
+    }
+    session->outputLength = 0;
+    session->outputSent = 0;
+    return 1;
+}
+
+/*
+ * Handles every complete request waiting in the input, as long as there is room for the reply.
+ * A solve or a hint parks the session instead, see parkSession(), and nothing after it is handled until it is back.
+ * @return: 0 if the client sent something that is not a request, its last reply is then queued, 1 otherwise.
+ */
+int processInput(struct session *session) {
+    while (sizeof(session->output) - session->outputLength >= MAX_REPLY_LENGTH && session->tiles.cellCount == 0
+           && session->isParked == 0) {
+        long needed = requestLength(session->input, session->inputLength);
+        int32_t command = noAction;
+        if (needed == -1) {
+            session->outputLength += rejectRequest(session->input, session->output + session->outputLength);
+            return 0;
+        }
+        if ((long) session->inputLength < needed) {
+            return 1;
+        }
+        if (needed >= (long) (sizeof(struct frameHeader) + sizeof(command))) {
+            memcpy(&command, session->input + sizeof(struct frameHeader), sizeof(command));
+        }
+        if (command == solve || command == hint) {
+            parkSession(&searchPool, session);
+            return 1;
+        }
+        uint8_t *reply = session->output + session->outputLength;
+        size_t length = processRequest(&session->game, session->input, reply, &session->tiles);
+        if (session->tiles.cellCount > 0) {
+            session->tailLength = length - session->tiles.offset;
+            memcpy(session->tail, reply + session->tiles.offset, session->tailLength);
+            length = session->tiles.offset;
+        }
+        session->outputLength += length;
+        session->inputLength -= needed;
+        memmove(session->input, session->input + needed, session->inputLength);
+    }
+    return 1;
+}
+
+/*
+ * Points epoll at what the session is waiting for: the socket to drain while replies are queued, requests otherwise.
+ * A parked session is taken out of epoll altogether, a hang up while a worker has its game must not free it, the
+ * next read finds it once the session is back. Replies it could not send before it was parked wait until then.
+ * @return: 0 if epoll refused, 1 otherwise.
+ */
+int watchSession(int pollFd, struct session *session) {
+    uint32_t events = session->isParked ? 0 : (session->outputLength > 0) ? EPOLLOUT : EPOLLIN;
+    if (events == session->events) {
+        return 1;
+    }
+    struct epoll_event event = {.events = events, .data.ptr = session};
+    int operation = (events == 0) ? EPOLL_CTL_DEL : (session->events == 0) ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+    session->events = events;
+    return epoll_ctl(pollFd, operation, session->fd, &event) == 0;
+}
+
+void closeSession(int pollFd, struct session *session) {
+    if (session->previousLive != NULL) {
+        session->previousLive->nextLive = session->nextLive;
+    } else {
+        liveSessions = session->nextLive;
+    }
+    if (session->nextLive != NULL) {
+        session->nextLive->previousLive = session->previousLive;
+    }
+    if (session->events != 0) {
+        epoll_ctl(pollFd, EPOLL_CTL_DEL, session->fd, NULL);
+    }
+    close(session->fd);
+    closeJournal(&session->journal, 0);
+    tearDown(&session->game);
+    free(session);
+}
+
+/*
+ * Takes in every connection waiting on the listening socket, each gets a new game.
+ * A connection there is no memory for is closed right away, the client sees the server hang up.
+ */
+void acceptSessions(int pollFd, int listenFd) {
+    while (1) {
+        int fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1) {
+            if (errno != EAGAIN && errno != EINTR && errno != ECONNABORTED) {
+                perror("accept failed");
+            }
+            return;
+        }
+        struct session *session = calloc(1, sizeof(struct session));
+        if (session == NULL) {
+            close(fd);
+            continue;
+        }
+        session->fd = fd;
+        session->events = EPOLLIN;
+        if (initialize(&session->game, DEFAULT_BOARD_SIZE) == 0) {
+            close(fd);
+            free(session);
+            continue;
+        }
+        openJournal(&session->journal, NULL, &session->game);
+        session->game.journal = &session->journal;
+        countGames(1);
+        struct epoll_event event = {.events = EPOLLIN, .data.ptr = session};
+        if (epoll_ctl(pollFd, EPOLL_CTL_ADD, fd, &event) == -1) {
+            close(fd);
+            closeJournal(&session->journal, 0);
+            tearDown(&session->game);
+            free(session);
+            continue;
+        }
+        session->nextLive = liveSessions;
+        if (liveSessions != NULL) {
+            liveSessions->previousLive = session;
+        }
+        liveSessions = session;
+    }
+}
+
+/*
+ * Serves one readiness event of a session: reads what arrived, answers every complete request and writes back
+ * what the socket takes.
+ * @return: 0 once the session is over, because the client left or broke the protocol, 1 otherwise.
+ */
+int serveSession(int pollFd, struct session *session, uint32_t events) {
+    if (events & (EPOLLERR | EPOLLHUP)) {
+        return 0;
+    }
+    if (events & EPOLLIN) {
+        ssize_t count = read(session->fd, session->input + session->inputLength,
+                             sizeof(session->input) - session->inputLength);
+        if (count == 0 || (count == -1 && errno != EAGAIN && errno != EINTR)) {
+            return 0;//client quit, same as the pipe closing
+        }
+        session->inputLength += (count > 0) ? count : 0;
+        countTraffic((count > 0) ? count : 0, 0);
+    }
+    if (flushOutput(session) == 0) {
+        return 0;
+    }
+    while (session->outputLength == 0 && session->isParked == 0) {//and requests left over from a backed up output
+        size_t waiting = session->inputLength;
+        if (processInput(session) == 0) {
+            flushOutput(session);//as much as the socket takes right away, the session is not kept for the rest
+            return 0;
+        }
+        if (flushOutput(session) == 0 && session->isParked == 0) {
+            return 0;//a parked session is only let go of once it is back, the broken socket is found again then
+        }
+        if (session->inputLength == waiting) {
+            break;//nothing complete left to answer
+        }
+    }
+    return watchSession(pollFd, session);
+}
+
+/*
+ * Hands back every session a worker is done with: its reply is queued behind whatever it had waiting, and it is
+ * served as if its socket had just become ready, which answers the requests that came in behind the search.
+ */
+void resumeSessions(int pollFd, struct searchPool *pool) {
+    uint64_t count;
+    if (read(pool->wakeFd, &count, sizeof(count)) == -1 && errno != EAGAIN) {
+        perror("cannot read the worker count");
+    }
+    pthread_mutex_lock(&pool->lock);
+    struct session *session = pool->finished;
+    pool->finished = NULL;
+    pthread_mutex_unlock(&pool->lock);
+    while (session != NULL) {
+        struct session *next = session->nextParked;
+        long needed = requestLength(session->input, session->inputLength);
+        memcpy(session->output + session->outputLength, session->searched, session->searchedLength);
+        session->outputLength += session->searchedLength;
+        session->inputLength -= needed;
+        memmove(session->input, session->input + needed, session->inputLength);
+        session->isParked = 0;
+        if (serveSession(pollFd, session, 0) == 0) {
+            closeSession(pollFd, session);
+        }
+        session = next;
+    }
+}
+
+/*
+ * Runs the multi-session server on a Unix domain socket until interrupted.
+ * @param socketPath: file name of the socket, an old socket of the same name is replaced.
+ * @return: 0 on a clean shutdown, 1 if the socket could not be set up.
+ */
+int socketServerFunction(const char *socketPath) {
+    struct sockaddr_un address;
+    struct epoll_event events[MAX_EVENTS];
+    struct sigaction action;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(socketPath) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "socket path [%s] is too long\n", socketPath);
+        return 1;
+    }
+    strcpy(address.sun_path, socketPath);
+    int listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd == -1) {
+        perror("socket failed");
+        return 1;
+    }
+    unlink(socketPath);
+    if (bind(listenFd, (struct sockaddr *) &address, sizeof(address)) == -1 || listen(listenFd, SOMAXCONN) == -1) {
+        perror("cannot listen on socket");
+        close(listenFd);
+        return 1;
+    }
+    int pollFd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event listenEvent = {.events = EPOLLIN, .data.ptr = NULL};//NULL marks the listening socket
+    struct epoll_event wakeEvent = {.events = EPOLLIN, .data.ptr = &searchPool};//and the pool its eventfd
+    if (pollFd == -1 || epoll_ctl(pollFd, EPOLL_CTL_ADD, listenFd, &listenEvent) == -1
+        || startSearchPool(&searchPool) == 0 || epoll_ctl(pollFd, EPOLL_CTL_ADD, searchPool.wakeFd, &wakeEvent) == -1) {
+        perror("epoll failed");
+        close(listenFd);
+        unlink(socketPath);
+        return 1;
+    }
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = requestStop;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    printf("Serving games on [%s]\n", socketPath);
+    fflush(stdout);
+    while (stopRequested == 0) {
+        int ready = epoll_wait(pollFd, events, MAX_EVENTS, -1);
+        for (int i = 0; i < ready; i++) {
+            struct session *session = events[i].data.ptr;
+            if (session == NULL) {
+                acceptSessions(pollFd, listenFd);
+            } else if (events[i].data.ptr == &searchPool) {
+                resumeSessions(pollFd, &searchPool);
+            } else if (serveSession(pollFd, session, events[i].events) == 0) {
+                closeSession(pollFd, session);
+            }
+        }
+    }
+    close(listenFd);
+    struct session *session = liveSessions;
+    while (session != NULL) {//a session a worker still has is left to the exit, its game is in use
+        struct session *next = session->nextLive;
+        if (session->isParked == 0) {
+            closeSession(pollFd, session);
+        }
+        session = next;
+    }
+    close(pollFd);
+    unlink(socketPath);
+    dumpStats();
+    return 0;
+}
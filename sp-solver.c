@@ -0,0 +1,1006 @@
+/*
+ * Representing the optimal solver of "sliding puzzle" game
+ * Uses C99 standard
+ * IDA* over the board, guided by Manhattan distance plus linear conflicts, both updated move by move.
+ * A board is won when the tiles read in descending order with the empty tile anywhere, see isWon(),
+ * so there is one winning board per cell the empty tile may finish in. An estimate is kept towards each of them
+ * and the heuristic is the smallest, which never overestimates the distance to the nearest winning board,
+ * so the search is optimal against the real win condition rather than one fixed goal.
+ * When a pattern database is mapped for the board size, its additive distance towards each goal is used wherever
+ * it beats the Manhattan based estimate of that goal.
+ * Hard boards are searched by several threads: each pass is expanded breadth first to a shallow frontier whose
+ * subtrees are dealt out to per thread queues, a thread that runs dry steals from the others. The threads are
+ * started once per solve and wait between passes, each keeping its own copy of the board.
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "sp-solver.h"
+#include "sp-pdb.h"
+
+#define SOLVER_MAX_CELLS (MAX_PACKED_BOARD_SIZE * MAX_PACKED_BOARD_SIZE)
+#define SOLVER_MAX_LINES (2 * MAX_PACKED_BOARD_SIZE)
+#define TABLE_MAX_SIZE 4//largest board whose line conflicts are looked up instead of counted, lines fit 16 bit keys
+#define SOLVER_CHECK_INTERVAL 4096//nodes a thread counts on its own before settling with the shared budget, power of 2
+#define PARALLEL_PASS_NODES 100000//a pass is split between threads once the previous one expanded this many nodes
+#define FRONTIER_PER_THREAD 64//subtrees per thread, enough for stealing to even out their very different sizes
+#define FRONTIER_CAPACITY 32768
+#define FRONTIER_MAX_DEPTH 32
+
+/*
+ * One level of the explicit search stack, enough to step into a child and back out again without recomputing.
+ * Conflict counts are handled by pointer: 'oldConflicts' is what the two changed lines pointed at before the move,
+ * 'scratch' holds freshly counted values for boards too large for the lookup tables.
+ */
+struct searchFrame {
+    uint8_t blank;//empty tile position when this node was entered
+    uint8_t parentBlank;//where the empty tile was one move ago, moving it straight back is never tried
+    uint8_t nextNeighbor;//next neighbour of the empty tile still to be tried
+    uint8_t changedLine[2];//lines whose conflicts were recounted on the way into this node
+    const uint8_t *oldConflicts[2];
+    const uint8_t *oldPatternDistances;//distances of the moved tile's pattern before the move
+    uint8_t scratch[2][SOLVER_MAX_CELLS];
+};
+
+/*
+ * Line conflicts of every possible line content for one small board size, built once per process.
+ * entries[line][key] indexes pool, key packs the line's tiles 4 bits each, 0 means the line has no conflicts.
+ */
+struct conflictTable {
+    int built;
+    uint32_t *entries[2 * TABLE_MAX_SIZE];
+    uint8_t *pool;//cellCount bytes per entry, one count per goal
+};
+
+/*
+ * Everything one search needs lives in here, the search itself never allocates.
+ * The board is kept as bytes, tile values 1..maxTileValue and 0 for the empty tile.
+ * There is one winning board for every cell the empty tile can end up in, 'goal' below always means one of those.
+ * Lines are numbered rows first, 0..size-1, then columns, size..(2 * size)-1.
+ */
+struct solverContext {
+    int size;
+    int cellCount;
+    int maxTileValue;
+    uint8_t cells[SOLVER_MAX_CELLS];
+    int blank;
+    int estimate[SOLVER_MAX_CELLS];//[goal], Manhattan distance plus linear conflicts towards that winning board
+    const uint8_t *lineConflict[SOLVER_MAX_LINES];//[line] then [goal], NULL while the line has no conflict at all
+    uint8_t startConflicts[SOLVER_MAX_LINES][SOLVER_MAX_CELLS];//backing store for the counts of the starting board
+    const struct conflictTable *table;//NULL on boards too large for lookup
+    uint8_t distanceBefore[SOLVER_MAX_CELLS][SOLVER_MAX_CELLS];//[tile][cell], to its goal cell with the empty tile after it
+    uint8_t distanceAfter[SOLVER_MAX_CELLS][SOLVER_MAX_CELLS];//[tile][cell], to its goal cell with the empty tile before it
+    uint8_t reaches[SOLVER_MAX_LINES][SOLVER_MAX_CELLS];//[line][tile], 1 if some goal puts the tile in the line
+    uint8_t lineCells[SOLVER_MAX_LINES][MAX_PACKED_BOARD_SIZE];
+    uint8_t rowOf[SOLVER_MAX_CELLS];
+    uint8_t colOf[SOLVER_MAX_CELLS];
+    uint8_t neighbors[SOLVER_MAX_CELLS][4];
+    uint8_t neighborCount[SOLVER_MAX_CELLS];
+    uint8_t position[SOLVER_MAX_CELLS];//[tile], cell it sits in
+    const struct patternDatabase *database;//NULL when no database is mapped for this size
+    const uint8_t *patternEntries[PDB_MAX_PATTERNS];
+    const uint8_t *patternDistances[PDB_MAX_PATTERNS];//[pattern] then [segment], entries of the current placement
+    uint8_t patternOf[SOLVER_MAX_CELLS];//[tile]
+    uint8_t segmentOf[PDB_MAX_PATTERNS][SOLVER_MAX_CELLS];//[pattern][goal]
+    struct searchFrame stack[SOLVER_MAX_MOVES + 1];
+    uint8_t path[SOLVER_MAX_MOVES];//tile moved to reach each depth
+    uint64_t nodesExpanded;
+    uint64_t nodesSettled;//part of nodesExpanded already added to the shared budget
+    struct sharedSearch *search;
+};
+
+/*
+ * A node of the parallel frontier, given by the cells the empty tile moved to on the way from the start.
+ */
+struct frontierNode {
+    uint8_t from[FRONTIER_MAX_DEPTH];
+};
+
+/*
+ * Frontier nodes one thread still has to search, indices head..tail-1.
+ * The owner takes from the tail, thieves take from the head, so they only meet over the last node.
+ */
+struct workQueue {
+    pthread_mutex_t lock;
+    int head;
+    int tail;
+};
+
+/*
+ * State shared by every thread of one solve, a single threaded solve only uses the node budget.
+ */
+struct sharedSearch {
+    atomic_ullong nodesExpanded;//settled every SOLVER_CHECK_INTERVAL nodes by each thread
+    uint64_t nodeLimit;
+    atomic_int stop;//set once a solution is found or the node limit runs out, every thread then winds down
+    int threadCount;
+    int bound;//of the pass in progress
+    int rootDepth;//depth of every frontier node
+    int frontierCount;
+    struct frontierNode *frontier;
+    struct frontierNode *spare;//next level while the frontier is being expanded
+    struct workQueue queues[SOLVER_MAX_THREADS];
+    pthread_mutex_t lock;//guards everything below
+    pthread_cond_t passStarted;//a new pass is dealt out, or the solve is over
+    pthread_cond_t passFinished;//the last of the other threads is done with the pass
+    int pass;//counts the passes dealt out
+    int busyThreads;//threads other than the caller's still searching the pass
+    int isOver;//the solve is over, every thread returns
+    int nextBound;
+    int length;//-1 until a thread finds a solution
+    uint8_t path[SOLVER_MAX_MOVES];
+};
+
+/*
+ * One search thread with its own copy of the board, worker 0 is the thread that called solveBoard().
+ * The copy lives as long as the solve, every pass starts from the board it was left at by rewindPath().
+ */
+struct searchWorker {
+    struct sharedSearch *search;
+    struct solverContext *context;
+    int id;
+    pthread_t thread;
+};
+
+struct conflictTable conflictTables[TABLE_MAX_SIZE + 1];
+pthread_mutex_t conflictTableLock = PTHREAD_MUTEX_INITIALIZER;//solves may run side by side, the tables are built once
+int solverThreads = 0;//0 means SP_SOLVER_THREADS, or one thread per online processor when that is not set
+
+/*
+ * Decides whether any winning board can be reached from the given one.
+ * A move of the empty tile left or right never changes the order the tiles read in, a move up or down jumps
+ * one tile over size - 1 others. On odd sizes that is an even number of swaps, so the inversion parity of the
+ * tiles can never change and must already match the descending goal order.
+ * On even sizes each vertical move flips that parity together with the row of the empty tile, and since a won
+ * board may have the empty tile in any row, both parities have a goal to reach: every even sized board is solvable.
+ * @param tiles: board in server form, one byte per tile, EMPTY_TILE for the empty tile.
+ * @param size: board size.
+ * @return: 1 if the board can be won, 0 if not.
+ */
+int isSolvable(const uint8_t *tiles, int size) {
+    if (size % 2 == 0) {
+        return 1;
+    }
+    int cellCount = size * size;
+    int maxTileValue = cellCount - 1;
+    long inversions = 0;
+    for (int i = 0; i < cellCount; i++) {
+        for (int j = i + 1; j < cellCount && tiles[i] != EMPTY_TILE; j++) {
+            if (tiles[j] != EMPTY_TILE && tiles[i] > tiles[j]) {
+                inversions++;
+            }
+        }
+    }
+    long goalInversions = ((long) maxTileValue * (maxTileValue - 1)) / 2;//descending order inverts every pair
+    return (inversions % 2) == (goalInversions % 2);
+}
+
+/*
+ * Linear conflict of one line towards one goal: tiles whose goal cell is in this line but that sit in the wrong
+ * order relative to each other. The tiles that can stay are the longest run already in goal order, every other one
+ * has to step out of the line and back in, costing two moves on top of its Manhattan distance.
+ * @param tiles: tiles of the line in order, empty tile left out.
+ * @param count: number of tiles.
+ * @param goal: cell the empty tile ends up in.
+ * @return: the extra moves this line needs.
+ */
+static int lineConflictsFor(const struct solverContext *context, int line, const uint8_t *tiles, int count, int goal) {
+    uint8_t order[MAX_PACKED_BOARD_SIZE];
+    uint8_t longest[MAX_PACKED_BOARD_SIZE];
+    int inLine = 0;
+    int best = 0;
+    for (int i = 0; i < count; i++) {
+        int goalCell = context->maxTileValue - tiles[i];
+        if (goalCell >= goal) {
+            goalCell++;
+        }
+        if (line < context->size && context->rowOf[goalCell] == line) {
+            order[inLine] = context->colOf[goalCell];
+            inLine++;
+        } else if (line >= context->size && context->colOf[goalCell] == line - context->size) {
+            order[inLine] = context->rowOf[goalCell];
+            inLine++;
+        }
+    }
+    for (int i = 0; i < inLine; i++) {
+        longest[i] = 1;
+        for (int j = 0; j < i; j++) {
+            if (order[j] < order[i] && longest[j] + 1 > longest[i]) {
+                longest[i] = longest[j] + 1;
+            }
+        }
+        if (longest[i] > best) {
+            best = longest[i];
+        }
+    }
+    return 2 * (inLine - best);
+}
+
+/*
+ * Linear conflicts of one line towards every goal at once.
+ * Only tiles that some goal puts in this line can take part, with fewer than two of them there is nothing to count.
+ * A tile only switches goal cell when the goal empty tile passes its own goal cell, so between those few
+ * switch points the count cannot change, it is worked out once per stretch and copied across it.
+ * @param lineTiles: the line's cells in order, 0 for the empty tile.
+ * @param conflicts: receives the count for each goal, left untouched when the line turns out idle.
+ * @return: 1 if conflicts was filled in, 0 if the line has no conflict towards any goal.
+ */
+static int lineConflicts(const struct solverContext *context, int line, const uint8_t *lineTiles, uint8_t *conflicts) {
+    uint8_t tiles[MAX_PACKED_BOARD_SIZE];
+    int switches[MAX_PACKED_BOARD_SIZE + 1];
+    int count = 0;
+    int switchCount = 0;
+    int busy = 0;
+    for (int i = 0; i < context->size; i++) {
+        uint8_t tile = lineTiles[i];
+        if (tile != 0 && context->reaches[line][tile]) {
+            tiles[count] = tile;
+            count++;
+            int at = context->maxTileValue - tile + 1;//first goal with the empty tile after this tile
+            int j = switchCount;
+            while (j > 0 && switches[j - 1] > at) {
+                switches[j] = switches[j - 1];
+                j--;
+            }
+            switches[j] = at;
+            switchCount++;
+        }
+    }
+    if (count < 2) {
+        return 0;
+    }
+    switches[switchCount] = context->cellCount;
+    int start = 0;
+    for (int i = 0; i <= switchCount; i++) {
+        if (switches[i] > start) {
+            int value = lineConflictsFor(context, line, tiles, count, start);
+            for (int goal = start; goal < switches[i]; goal++) {
+                conflicts[goal] = value;
+            }
+            busy |= value;
+            start = switches[i];
+        }
+    }
+    return busy != 0;
+}
+
+/*
+ * Counts the conflicts of every content each line of a small board can hold, so the search only has to look them up.
+ * 3x3 and 4x4 lines fit a 16 bit key, about half a million lines in all, a fraction of one search on a hard board.
+ * Content that cannot occur, like a tile twice, is counted anyway, it is cheaper than filtering it out.
+ * @return: 1 if the table was built, 0 if memory ran out, the table is then left unbuilt for a later solve to retry.
+ */
+static int buildConflictTable(const struct solverContext *context, struct conflictTable *table) {
+    int keyCount = 1 << (4 * context->size);
+    size_t poolCount = 1;//entry 0 stands for an idle line and is never read
+    size_t poolCapacity = 1024;
+    uint8_t lineTiles[TABLE_MAX_SIZE];
+    int wasBuilt = 1;
+    table->pool = malloc(poolCapacity * context->cellCount);
+    for (int line = 0; line < 2 * context->size && wasBuilt; line++) {
+        table->entries[line] = malloc(keyCount * sizeof(uint32_t));
+        wasBuilt = table->pool != NULL && table->entries[line] != NULL;
+        for (int key = 0; key < keyCount && wasBuilt; key++) {
+            for (int i = 0; i < context->size; i++) {
+                lineTiles[i] = (key >> (4 * i)) & 0xf;
+            }
+            if (poolCount == poolCapacity) {
+                uint8_t *grown = realloc(table->pool, 2 * poolCapacity * context->cellCount);
+                if (grown == NULL) {
+                    wasBuilt = 0;
+                    break;
+                }
+                table->pool = grown;
+                poolCapacity *= 2;
+            }
+            if (lineConflicts(context, line, lineTiles, table->pool + (poolCount * context->cellCount))) {
+                table->entries[line][key] = poolCount;
+                poolCount++;
+            } else {
+                table->entries[line][key] = 0;
+            }
+        }
+    }
+    if (wasBuilt == 0) {
+        for (int line = 0; line < 2 * context->size; line++) {
+            free(table->entries[line]);
+            table->entries[line] = NULL;
+        }
+        free(table->pool);
+        table->pool = NULL;
+        return 0;
+    }
+    table->built = 1;
+    return 1;
+}
+
+/*
+ * Current conflicts of one line, from the lookup table when there is one, counted into 'scratch' otherwise.
+ * @return: the count for every goal, NULL when the line has no conflict at all.
+ */
+static const uint8_t *conflictsOf(const struct solverContext *context, int line, uint8_t *scratch) {
+    uint8_t lineTiles[MAX_PACKED_BOARD_SIZE];
+    if (context->table != NULL) {
+        int key = 0;
+        for (int i = context->size - 1; i >= 0; i--) {
+            key = (key << 4) | context->cells[context->lineCells[line][i]];
+        }
+        uint32_t entry = context->table->entries[line][key];
+        return (entry == 0) ? NULL : context->table->pool + (entry * context->cellCount);
+    }
+    for (int i = 0; i < context->size; i++) {
+        lineTiles[i] = context->cells[context->lineCells[line][i]];
+    }
+    return lineConflicts(context, line, lineTiles, scratch) ? scratch : NULL;
+}
+
+/*
+ * Looks up the distances of one pattern's current placement, one per segment.
+ */
+static const uint8_t *patternDistancesOf(const struct solverContext *context, int pattern) {
+    const struct pdbPattern *record = &context->database->patterns[pattern];
+    uint8_t positions[PDB_MAX_PATTERN_TILES];
+    for (uint32_t i = 0; i < record->tileCount; i++) {
+        positions[i] = context->position[context->maxTileValue - record->slots[i]];
+    }
+    uint64_t rank = rankPattern(positions, record->tileCount, context->cellCount);
+    return context->patternEntries[pattern] + (rank * (record->tileCount + 1));
+}
+
+/*
+ * Hooks the mapped database for this board size, if there is one, into the context.
+ * For every goal each pattern reads the segment matching how many of its tiles come before the empty tile.
+ */
+static void preparePatterns(struct solverContext *context) {
+    context->database = patternDatabases[context->size];
+    for (int p = 0; context->database != NULL && p < context->database->patternCount; p++) {
+        const struct pdbPattern *record = &context->database->patterns[p];
+        context->patternEntries[p] = context->database->base + record->offset;
+        for (uint32_t i = 0; i < record->tileCount; i++) {
+            context->patternOf[context->maxTileValue - record->slots[i]] = p;
+        }
+        for (int goal = 0; goal < context->cellCount; goal++) {
+            context->segmentOf[p][goal] = 0;
+            for (uint32_t i = 0; i < record->tileCount; i++) {
+                context->segmentOf[p][goal] += record->slots[i] < goal;
+            }
+        }
+        context->patternDistances[p] = patternDistancesOf(context, p);
+    }
+}
+
+/*
+ * Builds the lookup tables for a board size and loads the board in, computing every estimate from scratch once.
+ * @param tiles: board in server form, one byte per tile, EMPTY_TILE for the empty tile.
+ * @return: 1 if the context is ready, 0 if the conflict table could not be built.
+ */
+static int prepareContext(struct solverContext *context, const uint8_t *tiles, int size, struct sharedSearch *search) {
+    int cellCount = size * size;
+    int maxTileValue = cellCount - 1;
+    context->size = size;
+    context->cellCount = cellCount;
+    context->maxTileValue = maxTileValue;
+    context->nodesExpanded = 0;
+    context->nodesSettled = 0;
+    context->search = search;
+    for (int cell = 0; cell < cellCount; cell++) {
+        int row = cell / size;
+        int col = cell % size;
+        context->rowOf[cell] = row;
+        context->colOf[cell] = col;
+        context->lineCells[row][col] = cell;
+        context->lineCells[size + col][row] = cell;
+        context->neighborCount[cell] = 0;
+        if (row > 0) {
+            context->neighbors[cell][context->neighborCount[cell]++] = cell - size;
+        }
+        if (row < size - 1) {
+            context->neighbors[cell][context->neighborCount[cell]++] = cell + size;
+        }
+        if (col > 0) {
+            context->neighbors[cell][context->neighborCount[cell]++] = cell - 1;
+        }
+        if (col < size - 1) {
+            context->neighbors[cell][context->neighborCount[cell]++] = cell + 1;
+        }
+    }
+    for (int tile = 1; tile <= maxTileValue; tile++) {
+        int goalBefore = maxTileValue - tile;
+        int goalAfter = goalBefore + 1;
+        for (int line = 0; line < 2 * size; line++) {
+            context->reaches[line][tile] = (line < size) ? (goalBefore / size == line || goalAfter / size == line)
+                                                         : (goalBefore % size == line - size || goalAfter % size == line - size);
+        }
+        for (int cell = 0; cell < cellCount; cell++) {
+            context->distanceBefore[tile][cell] = abs(cell / size - goalBefore / size) + abs(cell % size - goalBefore % size);
+            context->distanceAfter[tile][cell] = abs(cell / size - goalAfter / size) + abs(cell % size - goalAfter % size);
+        }
+    }
+    context->table = NULL;
+    if (size <= TABLE_MAX_SIZE) {
+        pthread_mutex_lock(&conflictTableLock);
+        int isBuilt = conflictTables[size].built || buildConflictTable(context, &conflictTables[size]);
+        pthread_mutex_unlock(&conflictTableLock);
+        if (isBuilt == 0) {
+            return 0;
+        }
+        context->table = &conflictTables[size];
+    }
+    for (int cell = 0; cell < cellCount; cell++) {
+        context->cells[cell] = tiles[cell];//the packed board already uses 0 for the empty tile
+        context->position[context->cells[cell]] = cell;
+        if (tiles[cell] == EMPTY_TILE) {
+            context->blank = cell;
+        }
+    }
+    preparePatterns(context);
+    for (int goal = 0; goal < cellCount; goal++) {
+        context->estimate[goal] = 0;
+        for (int cell = 0; cell < cellCount; cell++) {
+            int tile = context->cells[cell];
+            if (tile != 0) {
+                context->estimate[goal] += (maxTileValue - tile < goal) ? context->distanceBefore[tile][cell]
+                                                                        : context->distanceAfter[tile][cell];
+            }
+        }
+    }
+    for (int line = 0; line < 2 * size; line++) {
+        context->lineConflict[line] = conflictsOf(context, line, context->startConflicts[line]);
+        for (int goal = 0; goal < cellCount && context->lineConflict[line] != NULL; goal++) {
+            context->estimate[goal] += context->lineConflict[line][goal];
+        }
+    }
+    return 1;
+}
+
+/*
+ * The heuristic itself: the closest of all winning boards by their own estimate.
+ * Each goal's estimate is the larger of its Manhattan based one and the sum of its pattern distances.
+ * The database lookup is a likely cache miss, so it is only made once the Manhattan based estimates fit the budget,
+ * a node they already cut off does not need a sharper estimate.
+ * @param budget: moves left under the bound, anything above it is as good as any other.
+ */
+static int bestEstimate(struct solverContext *context, int budget) {
+    int best = 0x7fffffff;
+    for (int goal = 0; goal < context->cellCount; goal++) {
+        if (context->estimate[goal] < best) {
+            best = context->estimate[goal];
+        }
+    }
+    if (context->database == NULL || best > budget) {
+        return best;
+    }
+    for (int p = 0; p < context->database->patternCount; p++) {
+        if (context->patternDistances[p] == NULL) {
+            context->patternDistances[p] = patternDistancesOf(context, p);
+        }
+    }
+    best = 0x7fffffff;
+    for (int goal = 0; goal < context->cellCount; goal++) {
+        int estimate = context->estimate[goal];
+        int patternSum = 0;
+        for (int p = 0; p < context->database->patternCount; p++) {
+            patternSum += context->patternDistances[p][context->segmentOf[p][goal]];
+        }
+        estimate = patternSum > estimate ? patternSum : estimate;
+        if (estimate < best) {
+            best = estimate;
+        }
+    }
+    return best;
+}
+
+/*
+ * Moves the Manhattan part of every estimate along with one tile.
+ * For goals up to the tile's own goal cell the empty tile comes before it and it aims one cell further on.
+ */
+static void shiftDistances(struct solverContext *context, int tile, int from, int to) {
+    int slot = context->maxTileValue - tile;
+    int changeAfter = context->distanceAfter[tile][to] - context->distanceAfter[tile][from];
+    int changeBefore = context->distanceBefore[tile][to] - context->distanceBefore[tile][from];
+    for (int goal = 0; goal <= slot; goal++) {
+        context->estimate[goal] += changeAfter;
+    }
+    for (int goal = slot + 1; goal < context->cellCount; goal++) {
+        context->estimate[goal] += changeBefore;
+    }
+}
+
+/*
+ * Swaps the conflict counts of one line for another in every estimate.
+ */
+static void replaceConflicts(struct solverContext *context, const uint8_t *old, const uint8_t *current) {
+    if (old == current) {
+        return;
+    }
+    for (int goal = 0; goal < context->cellCount && old != NULL; goal++) {
+        context->estimate[goal] -= old[goal];
+    }
+    for (int goal = 0; goal < context->cellCount && current != NULL; goal++) {
+        context->estimate[goal] += current[goal];
+    }
+}
+
+/*
+ * Slides the tile at 'from' into the empty tile, recording in 'frame' what is needed to slide it back.
+ * A move up or down keeps every tile of each column in the same order, so only the two rows the tile leaves and
+ * joins are recounted for conflicts. A sideways move is the same with rows and columns swapped.
+ */
+static void applyMove(struct solverContext *context, int from, struct searchFrame *frame) {
+    int to = context->blank;
+    uint8_t tile = context->cells[from];
+    context->cells[to] = tile;
+    context->cells[from] = 0;
+    context->blank = from;
+    context->position[tile] = to;
+    shiftDistances(context, tile, from, to);
+    if (context->database != NULL) {
+        frame->oldPatternDistances = context->patternDistances[context->patternOf[tile]];
+        context->patternDistances[context->patternOf[tile]] = NULL;//looked up by bestEstimate() when needed
+    }
+    if (context->rowOf[from] != context->rowOf[to]) {
+        frame->changedLine[0] = context->rowOf[from];
+        frame->changedLine[1] = context->rowOf[to];
+    } else {
+        frame->changedLine[0] = context->size + context->colOf[from];
+        frame->changedLine[1] = context->size + context->colOf[to];
+    }
+    for (int i = 0; i < 2; i++) {
+        int line = frame->changedLine[i];
+        frame->oldConflicts[i] = context->lineConflict[line];
+        context->lineConflict[line] = conflictsOf(context, line, frame->scratch[i]);
+        replaceConflicts(context, frame->oldConflicts[i], context->lineConflict[line]);
+    }
+}
+
+/*
+ * Exact reverse of applyMove(), the empty tile goes back to 'to' and the conflict counts are restored from 'frame'.
+ */
+static void undoMove(struct solverContext *context, int to, const struct searchFrame *frame) {
+    int from = context->blank;
+    uint8_t tile = context->cells[to];
+    context->cells[from] = tile;
+    context->cells[to] = 0;
+    context->blank = to;
+    context->position[tile] = from;
+    shiftDistances(context, tile, to, from);
+    if (context->database != NULL) {
+        context->patternDistances[context->patternOf[tile]] = frame->oldPatternDistances;
+    }
+    for (int i = 0; i < 2; i++) {
+        int line = frame->changedLine[i];
+        replaceConflicts(context, context->lineConflict[line], frame->oldConflicts[i]);
+        context->lineConflict[line] = frame->oldConflicts[i];
+    }
+}
+
+/*
+ * Adds the nodes this context counted since last time to the shared budget.
+ * @return: 1 if the search has to stop, because the node limit ran out or another thread found a solution.
+ */
+static int budgetSpent(struct solverContext *context) {
+    uint64_t unsettled = context->nodesExpanded - context->nodesSettled;
+    uint64_t total = atomic_fetch_add(&context->search->nodesExpanded, unsettled) + unsettled;
+    context->nodesSettled = context->nodesExpanded;
+    if (total >= context->search->nodeLimit) {
+        atomic_store(&context->search->stop, 1);
+    }
+    return atomic_load(&context->search->stop);
+}
+
+/*
+ * One depth first pass of IDA*, walking every node under the root whose estimated total stays within 'bound'.
+ * Uses the explicit stack in the context instead of recursion, so depth is only limited by SOLVER_MAX_MOVES.
+ * @param rootDepth: depth the context currently sits at, 0 for the start board, see replayPath().
+ * @param bound: largest g + h allowed this pass.
+ * @param nextBound: receives the smallest g + h that went over the bound, the bound of the next pass.
+ * @return: the solution length if one was found, -1 if not, -2 if the search has to stop, see budgetSpent().
+ */
+static int searchPass(struct solverContext *context, int rootDepth, int bound, int *nextBound) {
+    int depth = rootDepth;
+    *nextBound = 0x7fffffff;
+    context->stack[rootDepth].blank = context->blank;
+    context->stack[rootDepth].nextNeighbor = 0;
+    if (rootDepth == 0) {
+        context->stack[0].parentBlank = 0xff;
+        context->nodesExpanded++;
+    }
+    while (depth >= rootDepth) {
+        struct searchFrame *frame = &context->stack[depth];
+        if (frame->nextNeighbor == context->neighborCount[frame->blank]) {
+            if (depth > rootDepth) {
+                undoMove(context, context->stack[depth - 1].blank, frame);
+            }
+            depth--;
+            continue;
+        }
+        int from = context->neighbors[frame->blank][frame->nextNeighbor];
+        frame->nextNeighbor++;
+        if (from == frame->parentBlank) {
+            continue;
+        }
+        struct searchFrame *child = &context->stack[depth + 1];
+        uint8_t tile = context->cells[from];
+        applyMove(context, from, child);
+        int heuristic = bestEstimate(context, bound - depth - 1);
+        int estimate = depth + 1 + heuristic;
+        if (estimate > bound || depth + 1 >= SOLVER_MAX_MOVES) {
+            if (estimate < *nextBound) {
+                *nextBound = estimate;
+            }
+            undoMove(context, frame->blank, child);
+            continue;
+        }
+        context->path[depth] = tile;
+        context->nodesExpanded++;
+        if (heuristic == 0) {//some winning board is zero moves away
+            return depth + 1;
+        }
+        if ((context->nodesExpanded & (SOLVER_CHECK_INTERVAL - 1)) == 0 && budgetSpent(context)) {
+            return -2;
+        }
+        child->blank = from;
+        child->parentBlank = frame->blank;
+        child->nextNeighbor = 0;
+        depth++;
+    }
+    return -1;
+}
+
+/*
+ * Walks the context from the start board down to a frontier node, leaving the stack as searchPass() would.
+ * @param from: cells the empty tile moves to, one per level.
+ */
+static void replayPath(struct solverContext *context, const uint8_t *from, int depth) {
+    context->stack[0].blank = context->blank;
+    context->stack[0].parentBlank = 0xff;
+    for (int i = 0; i < depth; i++) {
+        context->path[i] = context->cells[from[i]];
+        applyMove(context, from[i], &context->stack[i + 1]);
+        context->stack[i + 1].blank = from[i];
+        context->stack[i + 1].parentBlank = context->stack[i].blank;
+    }
+}
+
+/*
+ * Exact reverse of replayPath(), back to the start board.
+ */
+static void rewindPath(struct solverContext *context, int depth) {
+    for (int i = depth; i > 0; i--) {
+        undoMove(context, context->stack[i - 1].blank, &context->stack[i]);
+    }
+}
+
+/*
+ * Expands the current pass breadth first until there are enough frontier nodes to keep every thread busy.
+ * Nodes over the bound are dropped on the way and a won board met on the way ends the pass.
+ * @param nextBound: receives the smallest g + h that went over the bound.
+ * @return: the solution length if one was found, -1 otherwise, the frontier is then in 'search'.
+ */
+static int expandFrontier(struct sharedSearch *search, struct solverContext *context, int *nextBound) {
+    int depth = 0;
+    int count = 1;
+    memset(&search->frontier[0], 0, sizeof(struct frontierNode));
+    *nextBound = 0x7fffffff;
+    while (count > 0 && count < search->threadCount * FRONTIER_PER_THREAD && count * 4 <= FRONTIER_CAPACITY
+           && depth < FRONTIER_MAX_DEPTH) {
+        int nextCount = 0;
+        for (int node = 0; node < count; node++) {
+            replayPath(context, search->frontier[node].from, depth);
+            struct searchFrame *frame = &context->stack[depth];
+            for (int n = 0; n < context->neighborCount[frame->blank]; n++) {
+                int from = context->neighbors[frame->blank][n];
+                if (from == frame->parentBlank) {
+                    continue;
+                }
+                uint8_t tile = context->cells[from];
+                applyMove(context, from, &context->stack[depth + 1]);
+                int heuristic = bestEstimate(context, search->bound - depth - 1);
+                int estimate = depth + 1 + heuristic;
+                if (estimate > search->bound) {
+                    if (estimate < *nextBound) {
+                        *nextBound = estimate;
+                    }
+                } else if (heuristic == 0) {
+                    context->path[depth] = tile;
+                    memcpy(search->path, context->path, depth + 1);
+                    return depth + 1;
+                } else {
+                    context->nodesExpanded++;
+                    search->spare[nextCount] = search->frontier[node];
+                    search->spare[nextCount].from[depth] = from;
+                    nextCount++;
+                }
+                undoMove(context, frame->blank, &context->stack[depth + 1]);
+            }
+            rewindPath(context, depth);
+        }
+        struct frontierNode *expanded = search->spare;
+        search->spare = search->frontier;
+        search->frontier = expanded;
+        count = nextCount;
+        depth++;
+    }
+    search->rootDepth = depth;
+    search->frontierCount = count;
+    return -1;
+}
+
+/*
+ * Takes the next frontier node for one thread, from its own queue first and then from the others in turn.
+ * @return: index into the frontier, -1 once every queue is empty.
+ */
+static int takeWork(struct sharedSearch *search, int id) {
+    for (int i = 0; i < search->threadCount; i++) {
+        struct workQueue *queue = &search->queues[(id + i) % search->threadCount];
+        int node = -1;
+        pthread_mutex_lock(&queue->lock);
+        if (queue->head < queue->tail) {
+            node = (i == 0) ? --queue->tail : queue->head++;
+        }
+        pthread_mutex_unlock(&queue->lock);
+        if (node >= 0) {
+            return node;
+        }
+    }
+    return -1;
+}
+
+/*
+ * One thread's part of a pass: searches frontier subtrees until they run out or the search has to stop.
+ */
+static void searchSubtrees(struct searchWorker *worker) {
+    struct sharedSearch *search = worker->search;
+    struct solverContext *context = worker->context;
+    int nextBound = 0x7fffffff;
+    int node;
+    while (atomic_load(&search->stop) == 0 && (node = takeWork(search, worker->id)) >= 0) {
+        int subtreeBound;
+        replayPath(context, search->frontier[node].from, search->rootDepth);
+        int length = searchPass(context, search->rootDepth, search->bound, &subtreeBound);
+        if (length >= 0) {
+            pthread_mutex_lock(&search->lock);
+            if (search->length == -1) {
+                search->length = length;
+                memcpy(search->path, context->path, length);
+            }
+            pthread_mutex_unlock(&search->lock);
+            atomic_store(&search->stop, 1);
+        }
+        if (length != -1) {
+            break;//the context is left deep in the subtree, it is not searched again
+        }
+        if (subtreeBound < nextBound) {
+            nextBound = subtreeBound;
+        }
+        rewindPath(context, search->rootDepth);
+    }
+    budgetSpent(context);
+    pthread_mutex_lock(&search->lock);
+    if (nextBound < search->nextBound) {
+        search->nextBound = nextBound;
+    }
+    pthread_mutex_unlock(&search->lock);
+}
+
+/*
+ * Body of every search thread but the caller's: waits for a pass, takes its part in it, and waits for the next,
+ * until the solve is over.
+ */
+static void *searchWorker(void *argument) {
+    struct searchWorker *worker = argument;
+    struct sharedSearch *search = worker->search;
+    int pass = 0;
+    pthread_mutex_lock(&search->lock);
+    while (1) {
+        while (search->pass == pass && search->isOver == 0) {
+            pthread_cond_wait(&search->passStarted, &search->lock);
+        }
+        if (search->isOver) {
+            break;
+        }
+        pass = search->pass;
+        pthread_mutex_unlock(&search->lock);
+        searchSubtrees(worker);
+        pthread_mutex_lock(&search->lock);
+        if (--search->busyThreads == 0) {
+            pthread_cond_signal(&search->passFinished);
+        }
+    }
+    pthread_mutex_unlock(&search->lock);
+    return NULL;
+}
+
+/*
+ * Ends the solve for every search thread but the caller's and waits for them to return.
+ * @param started: threads running, the caller's included.
+ */
+static void stopWorkers(struct sharedSearch *search, struct searchWorker *workers, int started) {
+    pthread_mutex_lock(&search->lock);
+    search->isOver = 1;
+    pthread_cond_broadcast(&search->passStarted);
+    pthread_mutex_unlock(&search->lock);
+    for (int id = 1; id < started; id++) {
+        pthread_join(workers[id].thread, NULL);
+    }
+}
+
+/*
+ * Starts every search thread but the caller's, they wait for the first pass.
+ * @return: 1 if they all run, 0 if one could not be started, the ones that were are then stopped again.
+ */
+static int startWorkers(struct sharedSearch *search, struct searchWorker *workers) {
+    for (int id = 1; id < search->threadCount; id++) {
+        if (pthread_create(&workers[id].thread, NULL, searchWorker, &workers[id]) != 0) {
+            stopWorkers(search, workers, id);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * One pass of IDA* split between every worker: worker 0 expands the frontier, deals it out in even blocks, wakes
+ * the others and then searches alongside them. A solution found by any thread at this bound is optimal, so the
+ * first one stops all of them. The pass is over once every thread is waiting again.
+ * @return: as searchPass(), the solution is in search->path.
+ */
+static int parallelPass(struct sharedSearch *search, struct searchWorker *workers, int bound, int *nextBound) {
+    search->bound = bound;
+    int length = expandFrontier(search, workers[0].context, nextBound);
+    if (length != -1 || search->frontierCount == 0) {
+        return length;
+    }
+    search->nextBound = *nextBound;
+    for (int id = 0; id < search->threadCount; id++) {
+        search->queues[id].head = (int) (((long) search->frontierCount * id) / search->threadCount);
+        search->queues[id].tail = (int) (((long) search->frontierCount * (id + 1)) / search->threadCount);
+    }
+    pthread_mutex_lock(&search->lock);
+    search->busyThreads = search->threadCount - 1;
+    search->pass++;
+    pthread_cond_broadcast(&search->passStarted);
+    pthread_mutex_unlock(&search->lock);
+    searchSubtrees(&workers[0]);
+    pthread_mutex_lock(&search->lock);
+    while (search->busyThreads > 0) {
+        pthread_cond_wait(&search->passFinished, &search->lock);
+    }
+    pthread_mutex_unlock(&search->lock);
+    *nextBound = search->nextBound;
+    if (search->length >= 0) {
+        return search->length;
+    }
+    return atomic_load(&search->stop) ? -2 : -1;
+}
+
+/*
+ * Sets how many threads later solves use.
+ * @param count: 1 for a single threaded search, 0 for SP_SOLVER_THREADS or else one per online processor.
+ */
+void setSolverThreads(int count) {
+    solverThreads = count;
+}
+
+static int solverThreadCount() {
+    int count = solverThreads;
+    const char *setting = getenv("SP_SOLVER_THREADS");
+    if (count <= 0 && setting != NULL) {
+        count = atoi(setting);
+    }
+    if (count <= 0) {
+        count = (int) sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    return (count < 1) ? 1 : (count > SOLVER_MAX_THREADS ? SOLVER_MAX_THREADS : count);
+}
+
+/*
+ * Finds a shortest move sequence that wins the given board.
+ * Runs IDA* passes with a growing bound until a pass reaches a won board, the first solution found is optimal
+ * because every shorter bound was already searched in full.
+ * @param tiles: board in server form, one byte per tile, EMPTY_TILE for the empty tile, left untouched.
+ * @param size: board size, MIN_BOARD_SIZE to MAX_PACKED_BOARD_SIZE.
+ * @param nodeLimit: give up after visiting this many nodes, large boards would otherwise never come back.
+ * @param result: receives the moves, their count and the search statistics.
+ * @return: 1 if a solution was found, 0 otherwise.
+ */
+int solveBoard(const uint8_t *tiles, int size, uint64_t nodeLimit, struct solverResult *result) {
+    struct timespec started;
+    struct timespec finished;
+    clock_gettime(CLOCK_MONOTONIC, &started);
+    result->found = 0;
+    result->length = -1;
+    result->nodesExpanded = 0;
+    result->seconds = 0;
+    if (size < MIN_BOARD_SIZE || size > MAX_PACKED_BOARD_SIZE || isSolvable(tiles, size) == 0) {
+        return 0;
+    }
+    struct sharedSearch *search = malloc(sizeof(struct sharedSearch));
+    struct searchWorker workers[SOLVER_MAX_THREADS];
+    if (search == NULL) {
+        return 0;
+    }
+    atomic_init(&search->nodesExpanded, 0);
+    atomic_init(&search->stop, 0);
+    search->nodeLimit = nodeLimit;
+    search->threadCount = solverThreadCount();
+    search->frontier = NULL;
+    search->spare = NULL;
+    search->length = -1;
+    search->pass = 0;
+    search->busyThreads = 0;
+    search->isOver = 0;
+    pthread_mutex_init(&search->lock, NULL);
+    pthread_cond_init(&search->passStarted, NULL);
+    pthread_cond_init(&search->passFinished, NULL);
+    for (int id = 0; id < search->threadCount; id++) {
+        pthread_mutex_init(&search->queues[id].lock, NULL);
+        workers[id].search = search;
+        workers[id].context = NULL;
+        workers[id].id = id;
+    }
+    workers[0].context = malloc(sizeof(struct solverContext));//too big for the stack of a thread
+    int isReady = workers[0].context != NULL && prepareContext(workers[0].context, tiles, size, search);
+    int bound = isReady ? bestEstimate(workers[0].context, SOLVER_MAX_MOVES) : SOLVER_MAX_MOVES;
+    int length = (bound == 0) ? 0 : -1;
+    uint64_t passNodes = 0;
+    int runningThreads = 1;
+    while (length == -1 && bound < SOLVER_MAX_MOVES) {
+        int nextBound;
+        uint64_t before = atomic_load(&search->nodesExpanded);
+        if (search->threadCount > 1 && passNodes >= PARALLEL_PASS_NODES) {
+            if (search->frontier == NULL) {
+                search->frontier = malloc(FRONTIER_CAPACITY * sizeof(struct frontierNode));
+                search->spare = malloc(FRONTIER_CAPACITY * sizeof(struct frontierNode));
+                isReady = search->frontier != NULL && search->spare != NULL;
+                for (int id = 1; id < search->threadCount; id++) {
+                    workers[id].context = malloc(sizeof(struct solverContext));
+                    isReady = isReady && workers[id].context != NULL
+                              && prepareContext(workers[id].context, tiles, size, search);
+                }
+                if (isReady == 0 || startWorkers(search, workers) == 0) {
+                    break;//out of memory or threads, the solve gives up as if the node limit had run out
+                }
+                runningThreads = search->threadCount;
+            }
+            length = parallelPass(search, workers, bound, &nextBound);
+        } else {
+            length = searchPass(workers[0].context, 0, bound, &nextBound);
+            if (length >= 0) {
+                memcpy(search->path, workers[0].context->path, length);
+            }
+        }
+        budgetSpent(workers[0].context);
+        passNodes = atomic_load(&search->nodesExpanded) - before;
+        bound = nextBound;
+    }
+    if (runningThreads > 1) {
+        stopWorkers(search, workers, runningThreads);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &finished);
+    result->nodesExpanded = atomic_load(&search->nodesExpanded);
+    result->seconds = (finished.tv_sec - started.tv_sec) + ((finished.tv_nsec - started.tv_nsec) / 1e9);
+    if (length >= 0) {
+        result->found = 1;
+        result->length = length;
+        for (int i = 0; i < length; i++) {
+            result->moves[i] = search->path[i];
+        }
+    }
+    for (int id = 0; id < search->threadCount; id++) {
+        free(workers[id].context);
+        pthread_mutex_destroy(&search->queues[id].lock);
+    }
+    pthread_mutex_destroy(&search->lock);
+    pthread_cond_destroy(&search->passStarted);
+    pthread_cond_destroy(&search->passFinished);
+    free(search->frontier);
+    free(search->spare);
+    free(search);
+    return result->found;
+}
@@ -0,0 +1,34 @@
+/*
+ * Representing the optimal solver of "sliding puzzle" game
+ * Uses C99 standard
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#ifndef SP_SOLVER_H
+#define SP_SOLVER_H
+
+#include <stdint.h>
+#include "sp-protocol.h"
+
+#define SOLVER_MAX_MOVES MAX_SOLUTION_MOVES
+#define SOLVER_NODE_LIMIT 50000000ULL//about ten seconds of one core, solve and hint answer a player who waits
+#define SOLVER_MAX_THREADS 64
+
+/*
+ * Outcome of one solve, moves are tile values in the order they have to be moved.
+ */
+struct solverResult {
+    int found;//1 if solved, 0 if the board cannot be solved or the node limit ran out
+    int length;
+    int32_t moves[SOLVER_MAX_MOVES];
+    uint64_t nodesExpanded;
+    double seconds;
+};
+
+int isSolvable(const uint8_t *tiles, int size);
+
+int solveBoard(const uint8_t *tiles, int size, uint64_t nodeLimit, struct solverResult *result);
+
+void setSolverThreads(int count);
+
+#endif
@@ -0,0 +1,154 @@
+/*
+ * Representing the server statistics of "sliding puzzle" game
+ * Uses C99 standard
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "sp-stats.h"
+
+const char *commandNames[STATS_COMMANDS] = {"print", "save", "load", "new", "move", "moveBatch", "solve", "undo", "redo", "stats", "hint"};
+
+struct latencyHistogram commandLatency[STATS_COMMANDS];
+uint64_t movesMade = 0;
+uint64_t movesRejected = 0;
+uint64_t gamesStarted = 0;
+uint64_t bytesReceived = 0;
+uint64_t bytesSent = 0;
+
+uint64_t statsClock(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t) now.tv_sec * 1000000000ULL) + now.tv_nsec;
+}
+
+/*
+ * Bucket of a value, see struct latencyHistogram.
+ */
+int bucketOf(uint64_t value) {
+    if (value < HISTOGRAM_SUB_BUCKETS) {
+        return value;
+    }
+    int exponent = 63 - __builtin_clzll(value);
+    int shift = exponent - HISTOGRAM_SUB_BITS;
+    return ((shift + 1) * HISTOGRAM_SUB_BUCKETS) + ((value >> shift) & (HISTOGRAM_SUB_BUCKETS - 1));
+}
+
+/*
+ * Largest value that lands in a bucket, reported for percentiles so they never understate the latency.
+ */
+uint64_t bucketLimit(int bucket) {
+    if (bucket < HISTOGRAM_SUB_BUCKETS) {
+        return bucket;
+    }
+    int shift = (bucket / HISTOGRAM_SUB_BUCKETS) - 1;
+    uint64_t first = (uint64_t) (HISTOGRAM_SUB_BUCKETS + (bucket % HISTOGRAM_SUB_BUCKETS)) << shift;
+    return first + ((1ULL << shift) - 1);
+}
+
+/*
+ * Adds one timed request to the histogram of its command.
+ * @param command: a menuOptions value, anything from noAction on is ignored.
+ */
+void recordLatency(int command, uint64_t nanoseconds) {
+    if (command < 0 || command >= STATS_COMMANDS) {
+        return;
+    }
+    struct latencyHistogram *histogram = &commandLatency[command];
+    __atomic_fetch_add(&histogram->buckets[bucketOf(nanoseconds)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&histogram->count, 1, __ATOMIC_RELAXED);
+    uint64_t max = __atomic_load_n(&histogram->max, __ATOMIC_RELAXED);
+    while (nanoseconds > max
+           && !__atomic_compare_exchange_n(&histogram->max, &max, nanoseconds, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+void countMoves(uint64_t moved, uint64_t rejected) {
+    __atomic_fetch_add(&movesMade, moved, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&movesRejected, rejected, __ATOMIC_RELAXED);
+}
+
+void countGames(uint64_t started) {
+    __atomic_fetch_add(&gamesStarted, started, __ATOMIC_RELAXED);
+}
+
+/*
+ * Counts what went over a connection, servers call it with what each read() and write() moved.
+ */
+void countTraffic(size_t received, size_t sent) {
+    __atomic_fetch_add(&bytesReceived, received, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&bytesSent, sent, __ATOMIC_RELAXED);
+}
+
+/*
+ * Smallest bucket limit at or below which the given share of the requests finished.
+ * @param share: 0.5 for p50, 0.99 for p99.
+ */
+uint64_t percentileOf(const struct latencyHistogram *histogram, uint64_t count, double share) {
+    uint64_t wanted = (uint64_t) (count * share);
+    wanted = (wanted < 1) ? 1 : wanted;
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < HISTOGRAM_BUCKETS; bucket++) {
+        seen += __atomic_load_n(&histogram->buckets[bucket], __ATOMIC_RELAXED);
+        if (seen >= wanted) {
+            return bucketLimit(bucket);
+        }
+    }
+    return __atomic_load_n(&histogram->max, __ATOMIC_RELAXED);
+}
+
+/*
+ * Reads everything counted so far, requests still being recorded may or may not be in it.
+ * @param reply: receives percentiles and counters.
+ */
+void summarizeStats(struct statsReply *reply) {
+    for (int command = 0; command < STATS_COMMANDS; command++) {
+        const struct latencyHistogram *histogram = &commandLatency[command];
+        struct latencySummary *summary = &reply->latency[command];
+        summary->count = __atomic_load_n(&histogram->count, __ATOMIC_RELAXED);
+        summary->max = __atomic_load_n(&histogram->max, __ATOMIC_RELAXED);
+        summary->p50 = (summary->count == 0) ? 0 : percentileOf(histogram, summary->count, 0.50);
+        summary->p99 = (summary->count == 0) ? 0 : percentileOf(histogram, summary->count, 0.99);
+        summary->p50 = (summary->p50 > summary->max) ? summary->max : summary->p50;
+        summary->p99 = (summary->p99 > summary->max) ? summary->max : summary->p99;
+    }
+    reply->moves = __atomic_load_n(&movesMade, __ATOMIC_RELAXED);
+    reply->rejectedMoves = __atomic_load_n(&movesRejected, __ATOMIC_RELAXED);
+    reply->gamesStarted = __atomic_load_n(&gamesStarted, __ATOMIC_RELAXED);
+    reply->bytesReceived = __atomic_load_n(&bytesReceived, __ATOMIC_RELAXED);
+    reply->bytesSent = __atomic_load_n(&bytesSent, __ATOMIC_RELAXED);
+}
+
+/*
+ * Writes the statistics as JSON to the file named by SP_STATS_FILE, servers call it as they shut down.
+ * Nothing is written when SP_STATS_FILE is not set, so an interactive game does not leave files behind.
+ */
+void dumpStats(void) {
+    const char *fileName = getenv("SP_STATS_FILE");
+    struct statsReply stats;
+    if (fileName == NULL || fileName[0] == '\0') {
+        return;
+    }
+    FILE *filePtr = fopen(fileName, "w");
+    if (filePtr == NULL) {
+        perror("cannot write statistics file");
+        return;
+    }
+    summarizeStats(&stats);
+    fprintf(filePtr, "{\n  \"latencyNanoseconds\": {\n");
+    for (int command = 0; command < STATS_COMMANDS; command++) {
+        const struct latencySummary *summary = &stats.latency[command];
+        fprintf(filePtr, "    \"%s\": {\"count\": %llu, \"p50\": %llu, \"p99\": %llu, \"max\": %llu}%s\n",
+                commandNames[command], (unsigned long long) summary->count, (unsigned long long) summary->p50,
+                (unsigned long long) summary->p99, (unsigned long long) summary->max,
+                (command == STATS_COMMANDS - 1) ? "" : ",");
+    }
+    fprintf(filePtr, "  },\n  \"moves\": %llu,\n  \"rejectedMoves\": %llu,\n  \"gamesStarted\": %llu,\n"
+                     "  \"bytesReceived\": %llu,\n  \"bytesSent\": %llu\n}\n",
+            (unsigned long long) stats.moves, (unsigned long long) stats.rejectedMoves,
+            (unsigned long long) stats.gamesStarted, (unsigned long long) stats.bytesReceived,
+            (unsigned long long) stats.bytesSent);
+    fclose(filePtr);
+}
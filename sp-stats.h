@@ -0,0 +1,46 @@
+/*
+ * Representing the server statistics of "sliding puzzle" game
+ * Uses C99 standard
+ * One set of statistics per server process, updated with relaxed atomic adds so recording never takes a lock
+ * and costs about as much as the two clock reads around each request.
+ * @author Jesse Clegg
+ * @version 3.0
+ */
+#ifndef SP_STATS_H
+#define SP_STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "sp-protocol.h"
+
+#define HISTOGRAM_SUB_BITS 4//16 buckets per power of two, so a bucket is at most 1/16 of its value wide
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS ((64 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_BUCKETS)
+
+/*
+ * HDR style log-linear histogram of nanoseconds: values below 16 get a bucket each, above that every power of two
+ * is split into 16 equal buckets, which covers any uint64_t in a fixed table.
+ */
+struct latencyHistogram {
+    uint64_t buckets[HISTOGRAM_BUCKETS];
+    uint64_t count;
+    uint64_t max;
+};
+
+extern const char *commandNames[STATS_COMMANDS];
+
+uint64_t statsClock(void);
+
+void recordLatency(int command, uint64_t nanoseconds);
+
+void countMoves(uint64_t moved, uint64_t rejected);
+
+void countGames(uint64_t started);
+
+void countTraffic(size_t received, size_t sent);
+
+void summarizeStats(struct statsReply *reply);
+
+void dumpStats(void);
+
+#endif